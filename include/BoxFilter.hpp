@@ -0,0 +1,245 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <utils.hpp>
+#include <Convolution.hpp>
+
+
+#ifndef BOX_FILTER_HPP
+#define BOX_FILTER_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Type of the integral image of a data type: integers are summed exactly in long long, floating point types in a wider type, so that the differences of large sums keep the precision of the direct algorithm
+template< typename T > struct ConvolutionIntegral {
+  typedef double type;
+};
+template< > struct ConvolutionIntegral< double > {
+  typedef long double type;
+};
+template< > struct ConvolutionIntegral< unsigned char > {
+  typedef long long int type;
+};
+template< > struct ConvolutionIntegral< signed char > {
+  typedef long long int type;
+};
+template< > struct ConvolutionIntegral< short > {
+  typedef long long int type;
+};
+template< > struct ConvolutionIntegral< unsigned short > {
+  typedef long long int type;
+};
+template< > struct ConvolutionIntegral< int > {
+  typedef long long int type;
+};
+
+// True if all the coefficients of filter are equal, and then coefficient is their value
+template< typename T > bool isBox(const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, T & coefficient);
+// Parallel box filter: every output is coefficient times the sum of its window, computed from the integral image of the input with four lookups
+template< typename T > void convolutionBox(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const T coefficient);
+// OpenCL box filter: every work-group builds the integral image of its tile, border included, in local memory, and every output is computed with four lookups.
+// The coefficient is the first element of the filter argument; sums are limited to a tile, so accumulatorType keeps the precision of the direct algorithm.
+std::string getConvolutionBoxOpenCL(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType, const std::string & accumulatorType);
+// OpenCL box filter, with the tunable parameters in conf; local memory is always used, and neither vectors nor boundary modes are supported
+std::string getConvolutionBoxOpenCL(const ConvolutionConf & conf, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType);
+
+// Implementations
+template< typename T > bool isBox(const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, T & coefficient) {
+  for ( unsigned int tap = 1; tap < filterWidth * filterHeight; tap++ ) {
+    if ( filter[tap] != filter[0] ) {
+      return false;
+    }
+  }
+  coefficient = filter[0];
+  return true;
+}
+
+template< typename T > void convolutionBox(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const T coefficient) {
+  const unsigned int inputWidth = width + (filterWidth - 1);
+  const unsigned int inputHeight = height + (filterHeight - 1);
+  const unsigned int inputStride = isa::utils::pad(inputWidth, padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+  // The integral image has a row and a column of zeros in front: element (y + 1, x + 1) is the sum of the input up to row y and column x
+  const unsigned int integralStride = inputWidth + 1;
+  const unsigned int nrColumnsPerBand = 64;
+  const int nrBands = (integralStride + nrColumnsPerBand - 1) / nrColumnsPerBand;
+  std::vector< typename ConvolutionIntegral< T >::type > integral = std::vector< typename ConvolutionIntegral< T >::type >(static_cast< long long unsigned int >(inputHeight + 1) * integralStride);
+
+  // Prefix sums of every row, the rows in parallel
+  #pragma omp parallel for schedule(static)
+  for ( int y = 0; y < static_cast< int >(inputHeight); y++ ) {
+    const T * inputRow = &(input[y * inputStride]);
+    typename ConvolutionIntegral< T >::type * integralRow = &(integral[static_cast< long long unsigned int >(y + 1) * integralStride]);
+    typename ConvolutionIntegral< T >::type sum = 0;
+
+    for ( unsigned int x = 0; x < inputWidth; x++ ) {
+      sum += static_cast< typename ConvolutionIntegral< T >::type >(inputRow[x]);
+      integralRow[x + 1] = sum;
+    }
+  }
+  // Prefix sums of every column; bands of columns in parallel, every band walks down the rows to stay in cache
+  #pragma omp parallel for schedule(static)
+  for ( int band = 0; band < nrBands; band++ ) {
+    const unsigned int bandX = band * nrColumnsPerBand;
+    const unsigned int bandWidth = std::min(nrColumnsPerBand, integralStride - bandX);
+
+    for ( unsigned int y = 1; y < inputHeight; y++ ) {
+      const typename ConvolutionIntegral< T >::type * previousRow = &(integral[(static_cast< long long unsigned int >(y) * integralStride) + bandX]);
+      typename ConvolutionIntegral< T >::type * integralRow = &(integral[(static_cast< long long unsigned int >(y + 1) * integralStride) + bandX]);
+
+      for ( unsigned int x = 0; x < bandWidth; x++ ) {
+        integralRow[x] += previousRow[x];
+      }
+    }
+  }
+  // Four lookups per output; the two differences along the rows are taken first, as they are the smallest
+  #pragma omp parallel for schedule(static)
+  for ( int y = 0; y < static_cast< int >(height); y++ ) {
+    const typename ConvolutionIntegral< T >::type * top = &(integral[static_cast< long long unsigned int >(y) * integralStride]);
+    const typename ConvolutionIntegral< T >::type * bottom = &(integral[static_cast< long long unsigned int >(y + filterHeight) * integralStride]);
+    T * outputRow = &(output[y * outputStride]);
+
+    for ( unsigned int x = 0; x < width; x++ ) {
+      const typename ConvolutionIntegral< T >::type sum = (bottom[x + filterWidth] - bottom[x]) - (top[x + filterWidth] - top[x]);
+
+      outputRow[x] = convolutionAverage< T >(static_cast< typename ConvolutionAccumulator< T >::type >(sum * coefficient), filterWidth * filterHeight);
+    }
+  }
+}
+
+std::string getConvolutionBoxOpenCL(const ConvolutionConf & conf, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType) {
+  if ( conf.getVectorWidth() != 1 ) {
+    throw std::invalid_argument("Vectors are not supported by the box filter.");
+  } else if ( conf.getBoundary() != VALID ) {
+    throw std::invalid_argument("Boundary modes are not supported by the box filter.");
+  }
+  const std::string accumulatorType = conf.getAccumulatorType().empty() ? getConvolutionAccumulatorType(dataType) : conf.getAccumulatorType();
+
+  return getConvolutionBoxOpenCL(padding, width, height, filterWidth, filterHeight, conf.getNrColumnsPerBlock(), conf.getNrRowsPerBlock(), conf.getNrColumnsPerThread(), conf.getNrRowsPerThread(), inputImageStride, outputImageStride, dataType, accumulatorType);
+}
+
+std::string getConvolutionBoxOpenCL(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType, const std::string & accumulatorType) {
+  // Size of the tile computed by a work-group, of its input with the border, and of the integral image of the input
+  const std::string tileWidth_s = isa::utils::toString(nrColumnsPerBlock * nrColumnsPerThread);
+  const std::string tileHeight_s = isa::utils::toString(nrRowsPerBlock * nrRowsPerThread);
+  const std::string inputTileWidth_s = isa::utils::toString((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1));
+  const std::string inputTileHeight_s = isa::utils::toString((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1));
+  const std::string integralStride_s = isa::utils::toString((nrColumnsPerBlock * nrColumnsPerThread) + filterWidth);
+  const std::string nrItems_s = isa::utils::toString(nrColumnsPerBlock * nrRowsPerBlock);
+  // When the tile does not divide the image the last work-group of a dimension is a tail: its reads are clamped to the input, and its stores skip the pixels outside the image
+  const bool tails = (width % (nrColumnsPerBlock * nrColumnsPerThread) != 0) || (height % (nrRowsPerBlock * nrRowsPerThread) != 0);
+  std::string inputRow_s = "(y + fY)";
+  std::string inputColumn_s = "(x + fX)";
+  if ( tails ) {
+    inputRow_s = "min(y + fY, " + isa::utils::toString(height + (filterHeight - 1) - 1) + "u)";
+    inputColumn_s = "min(x + fX, " + isa::utils::toString(width + (filterWidth - 1) - 1) + "u)";
+  }
+
+  // Begin kernel's templates
+  const std::string top_s = "(get_local_id(1) + <%YOFFSET%>) * " + integralStride_s;
+  const std::string bottom_s = "(get_local_id(1) + <%YOFFSET%> + " + isa::utils::toString(filterHeight) + ") * " + integralStride_s;
+  const std::string left_s = "get_local_id(0) + <%XOFFSET%>";
+  const std::string right_s = "get_local_id(0) + <%XOFFSET%> + " + isa::utils::toString(filterWidth);
+  const ConvolutionTemplate sums(accumulatorType + " sumX<%XNUM%>Y<%YNUM%> = ((localSums[(" + bottom_s + ") + (" + right_s + ")] - localSums[(" + bottom_s + ") + (" + left_s + ")]) - (localSums[(" + top_s + ") + (" + right_s + ")] - localSums[(" + top_s + ") + (" + left_s + ")])) * coefficient;\n");
+  const ConvolutionTemplate average(getConvolutionAverage("sumX<%XNUM%>Y<%YNUM%>", filterWidth * filterHeight, 1, accumulatorType));
+  const std::string outputIndex_s = "(image * " + isa::utils::toString(outputImageStride) + ") + ((y + get_local_id(1) + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width, padding)) + ") + (x + get_local_id(0) + <%XOFFSET%>)";
+  std::string store_s;
+  if ( tails ) {
+    store_s = getConvolutionTailStore("sumX<%XNUM%>Y<%YNUM%>", "output", outputIndex_s, "y + get_local_id(1) + <%YOFFSET%>", "x + get_local_id(0) + <%XOFFSET%>", width, height, 1, dataType, accumulatorType);
+  } else {
+    store_s = getConvolutionStore("sumX<%XNUM%>Y<%YNUM%>", "output", outputIndex_s, 1, dataType, accumulatorType);
+  }
+  const ConvolutionTemplate store(store_s);
+  // End kernel's templates
+
+  std::string code;
+  unsigned int values[ConvolutionTemplate::COEFFICIENT] = {0};
+
+  code += "__kernel void convolution(__global const " + dataType + " * const restrict input, __global " + dataType + " * const restrict output, __global const " + dataType + " * const restrict filter) {\n"
+    "const unsigned int x = (get_group_id(0) * " + tileWidth_s + ");\n"
+    "const unsigned int y = (get_group_id(1) * " + tileHeight_s + ");\n"
+    "const unsigned int image = get_group_id(2);\n"
+    "const unsigned int item = (get_local_id(1) * " + isa::utils::toString(nrColumnsPerBlock) + ") + get_local_id(0);\n"
+    "const " + accumulatorType + " coefficient = " + getConvolutionLoad("filter", "0", 1, dataType, accumulatorType) + ";\n"
+    "__local " + accumulatorType + " localSums[" + isa::utils::toString(((nrRowsPerBlock * nrRowsPerThread) + filterHeight) * ((nrColumnsPerBlock * nrColumnsPerThread) + filterWidth)) + "];\n"
+    // The first row and column of the integral image are zero
+    "for ( unsigned int fX = item; fX < " + integralStride_s + "; fX += " + nrItems_s + " ) {\n"
+    "localSums[fX] = 0;\n"
+    "}\n"
+    "for ( unsigned int fY = item; fY < " + inputTileHeight_s + "; fY += " + nrItems_s + " ) {\n"
+    "localSums[(fY + 1) * " + integralStride_s + "] = 0;\n"
+    "}\n"
+    "for ( unsigned int fY = get_local_id(1); fY < " + inputTileHeight_s + "; fY += " + isa::utils::toString(nrRowsPerBlock) + " ) {\n"
+    "for ( unsigned int fX = get_local_id(0); fX < " + inputTileWidth_s + "; fX += " + isa::utils::toString(nrColumnsPerBlock) + " ) {\n"
+    "localSums[((fY + 1) * " + integralStride_s + ") + (fX + 1)] = " + getConvolutionLoad("input", "(image * " + isa::utils::toString(inputImageStride) + ") + (" + inputRow_s + " * " + isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding)) + ") + " + inputColumn_s, 1, dataType, accumulatorType) + ";\n"
+    "}\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    // Prefix sums of the rows, and then of the columns, one row or column per work-item
+    "for ( unsigned int fY = item; fY < " + inputTileHeight_s + "; fY += " + nrItems_s + " ) {\n"
+    + accumulatorType + " sum = 0;\n"
+    "for ( unsigned int fX = 1; fX <= " + inputTileWidth_s + "; fX++ ) {\n"
+    "sum += localSums[((fY + 1) * " + integralStride_s + ") + fX];\n"
+    "localSums[((fY + 1) * " + integralStride_s + ") + fX] = sum;\n"
+    "}\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "for ( unsigned int fX = item; fX < " + inputTileWidth_s + "; fX += " + nrItems_s + " ) {\n"
+    + accumulatorType + " sum = 0;\n"
+    "for ( unsigned int fY = 1; fY <= " + inputTileHeight_s + "; fY++ ) {\n"
+    "sum += localSums[(fY * " + integralStride_s + ") + (fX + 1)];\n"
+    "localSums[(fY * " + integralStride_s + ") + (fX + 1)] = sum;\n"
+    "}\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n";
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock;
+      sums.append(code, values);
+    }
+  }
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      average.append(code, values);
+    }
+  }
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock;
+      store.append(code, values);
+    }
+  }
+  code += "}\n";
+
+  return code;
+}
+
+} // OpenCL
+} // isa
+
+#endif // BOX_FILTER_HPP
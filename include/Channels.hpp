@@ -0,0 +1,279 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <utils.hpp>
+#include <Convolution.hpp>
+#include <Search.hpp>
+
+
+#ifndef CHANNELS_HPP
+#define CHANNELS_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Layout of a multi-channel image: PLANAR stores every channel as a padded image, INTERLEAVED stores the channels of a pixel next to each other, and pads the rows of all channels together
+enum ConvolutionLayout { PLANAR = 0, INTERLEAVED };
+
+// Layout from its name (planar, interleaved), and back
+ConvolutionLayout getConvolutionLayout(const std::string & name);
+std::string toString(const ConvolutionLayout layout);
+// Elements of a multi-channel input, border included, and output
+unsigned int getChannelsInputSize(const ConvolutionLayout layout, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight);
+unsigned int getChannelsOutputSize(const ConvolutionLayout layout, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height);
+// Parallel convolution of every channel with the same filter; the results are identical to the sequential algorithm on every channel
+template< typename T > void convolutionChannels(const ConvolutionLayout layout, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+// OpenCL convolution of all the channels in one launch: PLANAR channels are the images of the third dimension of the NDRange, INTERLEAVED channels are the columns of a nrChannels times wider image, whose taps are nrChannels columns apart.
+// The interleaved layout supports neither vectors, filter banks, the sliding window, nor boundary modes.
+std::string getConvolutionChannelsOpenCL(const ConvolutionLayout layout, const ConvolutionConf & conf, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, std::string & dataType);
+// OpenCL convolution of interleaved channels, with the images inputImageStride and outputImageStride elements apart
+std::string getConvolutionInterleavedOpenCL(const bool local, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType, const std::string & accumulatorType);
+// Size of the NDRange of the kernels of getConvolutionChannelsOpenCL, in the first and third dimension; the second one is getConvolutionGlobalRows
+unsigned int getChannelsGlobalColumns(const ConvolutionLayout layout, const ConvolutionConf & conf, const unsigned int nrChannels, const unsigned int width);
+unsigned int getChannelsGlobalImages(const ConvolutionLayout layout, const unsigned int nrChannels);
+// Bytes of local memory used by the kernels of getConvolutionChannelsOpenCL, for images of dataType
+unsigned int getChannelsLocalMemory(const ConvolutionLayout layout, const ConvolutionConf & conf, const unsigned int nrChannels, const unsigned int padding, const unsigned int filterWidth, const unsigned int filterHeight, const std::string & dataType);
+
+// Implementations
+ConvolutionLayout getConvolutionLayout(const std::string & name) {
+  if ( name == "planar" ) {
+    return PLANAR;
+  } else if ( name == "interleaved" ) {
+    return INTERLEAVED;
+  }
+  throw std::invalid_argument("Unknown layout: " + name + ".");
+}
+
+std::string toString(const ConvolutionLayout layout) {
+  if ( layout == INTERLEAVED ) {
+    return "interleaved";
+  }
+  return "planar";
+}
+
+unsigned int getChannelsInputSize(const ConvolutionLayout layout, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight) {
+  if ( layout == INTERLEAVED ) {
+    return (height + (filterHeight - 1)) * isa::utils::pad((width + (filterWidth - 1)) * nrChannels, padding);
+  }
+  return nrChannels * getInputImageSize(padding, width, height, filterWidth, filterHeight);
+}
+
+unsigned int getChannelsOutputSize(const ConvolutionLayout layout, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height) {
+  if ( layout == INTERLEAVED ) {
+    return height * isa::utils::pad(width * nrChannels, padding);
+  }
+  return nrChannels * getOutputImageSize(padding, width, height);
+}
+
+template< typename T > void convolutionChannels(const ConvolutionLayout layout, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  if ( layout == PLANAR ) {
+    convolutionBatched< T >(nrChannels, getInputImageSize(padding, width, height, filterWidth, filterHeight), getOutputImageSize(padding, width, height), padding, width, height, filterWidth, filterHeight, input, output, filter);
+    return;
+  }
+  // An interleaved row is a row of width * nrChannels columns, and the taps of a channel are nrChannels columns apart
+  const unsigned int nrColumns = width * nrChannels;
+  const unsigned int inputStride = isa::utils::pad((width + (filterWidth - 1)) * nrChannels, padding);
+  const unsigned int outputStride = isa::utils::pad(nrColumns, padding);
+
+  #pragma omp parallel
+  {
+    std::vector< typename ConvolutionAccumulator< T >::type > sums = std::vector< typename ConvolutionAccumulator< T >::type >(nrColumns);
+
+    #pragma omp for schedule(static)
+    for ( int y = 0; y < static_cast< int >(height); y++ ) {
+      std::fill(sums.begin(), sums.end(), static_cast< typename ConvolutionAccumulator< T >::type >(0));
+      // Taps are visited in the same order as the sequential algorithm, so the results are identical
+      for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+        for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+          const T tap = filter[(fY * filterWidth) + fX];
+          const T * inputRow = &(input[((y + fY) * inputStride) + (fX * nrChannels)]);
+
+          for ( unsigned int x = 0; x < nrColumns; x++ ) {
+            sums[x] += inputRow[x] * tap;
+          }
+        }
+      }
+      for ( unsigned int x = 0; x < nrColumns; x++ ) {
+        output[(y * outputStride) + x] = convolutionAverage< T >(sums[x], filterWidth * filterHeight);
+      }
+    }
+  }
+}
+
+std::string getConvolutionChannelsOpenCL(const ConvolutionLayout layout, const ConvolutionConf & conf, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, std::string & dataType) {
+  if ( layout == PLANAR ) {
+    return getConvolutionOpenCLSource(conf, padding, width, height, filterWidth, filterHeight, 1, getInputImageSize(padding, width, height, filterWidth, filterHeight), getOutputImageSize(padding, width, height), dataType);
+  } else if ( conf.getVectorWidth() > 1 ) {
+    throw std::invalid_argument("Vectors are not supported by the interleaved layout.");
+  } else if ( conf.getNrFiltersPerThread() > 1 ) {
+    throw std::invalid_argument("Filter banks are not supported by the interleaved layout.");
+  } else if ( conf.getWindow() ) {
+    throw std::invalid_argument("The sliding window is not supported by the interleaved layout.");
+  } else if ( conf.getBoundary() != VALID ) {
+    throw std::invalid_argument("Boundary modes are not supported by the interleaved layout.");
+  }
+  const std::string accumulatorType = conf.getAccumulatorType().empty() ? getConvolutionAccumulatorType(dataType) : conf.getAccumulatorType();
+
+  return getConvolutionInterleavedOpenCL(conf.getLocalMemory(), nrChannels, padding, width, height, filterWidth, filterHeight, conf.getNrColumnsPerBlock(), conf.getNrRowsPerBlock(), conf.getNrColumnsPerThread(), conf.getNrRowsPerThread(), getChannelsInputSize(INTERLEAVED, nrChannels, padding, width, height, filterWidth, filterHeight), getChannelsOutputSize(INTERLEAVED, nrChannels, padding, width, height), dataType, accumulatorType);
+}
+
+std::string getConvolutionInterleavedOpenCL(const bool local, const unsigned int nrChannels, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType, const std::string & accumulatorType) {
+  // Columns of the output, and of the input with the border, counting every channel
+  const unsigned int nrColumns = width * nrChannels;
+  const unsigned int nrInputColumns = (width + (filterWidth - 1)) * nrChannels;
+  const std::string nrChannels_s = isa::utils::toString(nrChannels);
+  const std::string inputStride_s = isa::utils::toString(isa::utils::pad(nrInputColumns, padding));
+  // Size of the tile computed by a work-group, and of its input with the border
+  const unsigned int tileWidth = nrColumnsPerBlock * nrColumnsPerThread;
+  const unsigned int tileHeight = nrRowsPerBlock * nrRowsPerThread;
+  const std::string localStride_s = isa::utils::toString(tileWidth + ((filterWidth - 1) * nrChannels));
+  const std::string localRows_s = isa::utils::toString(tileHeight + (filterHeight - 1));
+  // Half precision is a storage format only, so the tile in local memory is converted already
+  std::string localType = dataType;
+  if ( dataType == "half" ) {
+    localType = accumulatorType;
+  }
+  // When the tile does not divide the image the last work-group of a dimension is a tail: its reads are clamped to the input, and its stores skip the pixels outside the image
+  const bool tails = (nrColumns % tileWidth != 0) || (height % tileHeight != 0);
+  // Row and column of the input read by the tile loop, and by a tap of an accumulator without local memory
+  std::string inputRow_s = "y + fY";
+  std::string inputColumn_s = "x + fX";
+  std::string sumRow_s = "y + get_local_id(1) + <%YOFFSET%> + fY";
+  std::string sumColumn_s = "x + get_local_id(0) + <%XOFFSET%> + (fX * " + nrChannels_s + ")";
+  if ( tails ) {
+    inputRow_s = "min(" + inputRow_s + ", " + isa::utils::toString(height + (filterHeight - 1) - 1) + "u)";
+    inputColumn_s = "min(" + inputColumn_s + ", " + isa::utils::toString(nrInputColumns - 1) + "u)";
+    sumRow_s = "min(" + sumRow_s + ", " + isa::utils::toString(height + (filterHeight - 1) - 1) + "u)";
+    sumColumn_s = "min(" + sumColumn_s + ", " + isa::utils::toString(nrInputColumns - 1) + "u)";
+  } else {
+    inputRow_s = "(" + inputRow_s + ")";
+    inputColumn_s = "(" + inputColumn_s + ")";
+    sumRow_s = "(" + sumRow_s + ")";
+    sumColumn_s = "(" + sumColumn_s + ")";
+  }
+
+  // Begin kernel's templates
+  const ConvolutionTemplate defs(accumulatorType + " sumX<%XNUM%>Y<%YNUM%> = 0;\n");
+  std::string sums_s;
+  if ( local ) {
+    sums_s = "sumX<%XNUM%>Y<%YNUM%> += " + getConvolutionLoad("localInput", "((get_local_id(1) + <%YOFFSET%> + fY) * " + localStride_s + ") + (get_local_id(0) + <%XOFFSET%> + (fX * " + nrChannels_s + "))", 1, localType, accumulatorType) + " * tap;\n";
+  } else {
+    sums_s = "sumX<%XNUM%>Y<%YNUM%> += " + getConvolutionLoad("input", "(image * " + isa::utils::toString(inputImageStride) + ") + (" + sumRow_s + " * " + inputStride_s + ") + " + sumColumn_s, 1, dataType, accumulatorType) + " * tap;\n";
+  }
+  const ConvolutionTemplate sums(sums_s);
+  const ConvolutionTemplate average(getConvolutionAverage("sumX<%XNUM%>Y<%YNUM%>", filterWidth * filterHeight, 1, accumulatorType));
+  const std::string outputIndex_s = "(image * " + isa::utils::toString(outputImageStride) + ") + ((y + get_local_id(1) + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(nrColumns, padding)) + ") + (x + get_local_id(0) + <%XOFFSET%>)";
+  std::string store_s;
+  if ( tails ) {
+    store_s = getConvolutionTailStore("sumX<%XNUM%>Y<%YNUM%>", "output", outputIndex_s, "y + get_local_id(1) + <%YOFFSET%>", "x + get_local_id(0) + <%XOFFSET%>", nrColumns, height, 1, dataType, accumulatorType);
+  } else {
+    store_s = getConvolutionStore("sumX<%XNUM%>Y<%YNUM%>", "output", outputIndex_s, 1, dataType, accumulatorType);
+  }
+  const ConvolutionTemplate store(store_s);
+  // End kernel's templates
+
+  std::string code;
+  unsigned int values[ConvolutionTemplate::COEFFICIENT] = {0};
+
+  code += "__kernel void convolution(__global const " + dataType + " * const restrict input, __global " + dataType + " * const restrict output, __global const " + dataType + " * const restrict filter) {\n"
+    "const unsigned int x = (get_group_id(0) * " + isa::utils::toString(tileWidth) + ");\n"
+    "const unsigned int y = (get_group_id(1) * " + isa::utils::toString(tileHeight) + ");\n"
+    "const unsigned int image = get_group_id(2);\n";
+  if ( local ) {
+    code += "__local " + localType + " localInput[" + isa::utils::toString((tileHeight + (filterHeight - 1)) * (tileWidth + ((filterWidth - 1) * nrChannels))) + "];\n"
+      "for ( unsigned int fY = get_local_id(1); fY < " + localRows_s + "; fY += " + isa::utils::toString(nrRowsPerBlock) + " ) {\n"
+      "for ( unsigned int fX = get_local_id(0); fX < " + localStride_s + "; fX += " + isa::utils::toString(nrColumnsPerBlock) + " ) {\n"
+      "localInput[(fY * " + localStride_s + ") + fX] = " + getConvolutionLoad("input", "(image * " + isa::utils::toString(inputImageStride) + ") + (" + inputRow_s + " * " + inputStride_s + ") + " + inputColumn_s, 1, dataType, localType) + ";\n"
+      "}\n"
+      "}\n"
+      "barrier(CLK_LOCAL_MEM_FENCE);\n";
+  }
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      defs.append(code, values);
+    }
+  }
+  code += "for ( unsigned int fY = 0; fY < " + isa::utils::toString(filterHeight) + "; fY++ ) {\n"
+    "for ( unsigned int fX = 0; fX < " + isa::utils::toString(filterWidth) + "; fX++ ) {\n"
+    "const " + accumulatorType + " tap = " + getConvolutionLoad("filter", "(fY * " + isa::utils::toString(filterWidth) + ") + fX", 1, dataType, accumulatorType) + ";\n";
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock;
+      sums.append(code, values);
+    }
+  }
+  code += "}\n"
+    "}\n";
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      average.append(code, values);
+    }
+  }
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock;
+      store.append(code, values);
+    }
+  }
+  code += "}\n";
+
+  return code;
+}
+
+unsigned int getChannelsGlobalColumns(const ConvolutionLayout layout, const ConvolutionConf & conf, const unsigned int nrChannels, const unsigned int width) {
+  if ( layout == INTERLEAVED ) {
+    return getConvolutionGlobalColumns(conf, width * nrChannels);
+  }
+  return getConvolutionGlobalColumns(conf, width);
+}
+
+unsigned int getChannelsGlobalImages(const ConvolutionLayout layout, const unsigned int nrChannels) {
+  if ( layout == INTERLEAVED ) {
+    return 1;
+  }
+  return nrChannels;
+}
+
+unsigned int getChannelsLocalMemory(const ConvolutionLayout layout, const ConvolutionConf & conf, const unsigned int nrChannels, const unsigned int padding, const unsigned int filterWidth, const unsigned int filterHeight, const std::string & dataType) {
+  std::string localType = dataType;
+
+  if ( layout == PLANAR ) {
+    return getConvolutionLocalMemory(conf, false, padding, filterWidth, filterHeight, dataType);
+  } else if ( !conf.getLocalMemory() ) {
+    return 0;
+  } else if ( dataType == "half" ) {
+    localType = conf.getAccumulatorType().empty() ? getConvolutionAccumulatorType(dataType) : conf.getAccumulatorType();
+  }
+  return ((conf.getNrRowsPerBlock() * conf.getNrRowsPerThread()) + (filterHeight - 1)) * ((conf.getNrColumnsPerBlock() * conf.getNrColumnsPerThread()) + ((filterWidth - 1) * nrChannels)) * getConvolutionTypeSize(localType);
+}
+
+} // OpenCL
+} // isa
+
+#endif // CHANNELS_HPP
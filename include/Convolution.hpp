@@ -13,7 +13,12 @@
 // limitations under the License.
 
 #include <string>
+#include <vector>
 #include <cmath>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <limits>
 
 #include <utils.hpp>
 
@@ -24,214 +29,1316 @@
 namespace isa {
 namespace OpenCL {
 
-// Sequential convolution algorithm
-template< typename T > void convolution(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
-// OpenCL convolution algorithm
+// Pixels outside the image: VALID reads an input that already contains the border, and computes the valid region only.
+// The other modes read an image of the same size as the output, centre the filter on every pixel, and take the pixels outside it as zero, the nearest edge, the mirror image (edge included), or the opposite side.
+enum ConvolutionBoundary { VALID = 0, ZERO, CLAMP, MIRROR, WRAP };
+
+// Tunable parameters of the OpenCL convolution algorithm, and the options of its kernel: sliding window, boundary mode, and accumulator type (empty for the default of the data type)
+class ConvolutionConf {
+public:
+  ConvolutionConf();
+  ~ConvolutionConf();
+  // Get
+  inline bool getLocalMemory() const;
+  inline unsigned int getNrColumnsPerBlock() const;
+  inline unsigned int getNrRowsPerBlock() const;
+  inline unsigned int getNrColumnsPerThread() const;
+  inline unsigned int getNrRowsPerThread() const;
+  inline unsigned int getNrFiltersPerThread() const;
+  inline unsigned int getVectorWidth() const;
+  inline bool getWindow() const;
+  inline ConvolutionBoundary getBoundary() const;
+  inline const std::string & getAccumulatorType() const;
+  // Set
+  inline void setLocalMemory(const bool local);
+  inline void setNrColumnsPerBlock(const unsigned int columns);
+  inline void setNrRowsPerBlock(const unsigned int rows);
+  inline void setNrColumnsPerThread(const unsigned int columns);
+  inline void setNrRowsPerThread(const unsigned int rows);
+  inline void setNrFiltersPerThread(const unsigned int filters);
+  inline void setVectorWidth(const unsigned int width);
+  inline void setWindow(const bool window);
+  inline void setBoundary(const ConvolutionBoundary boundary);
+  inline void setAccumulatorType(const std::string & type);
+  // utils
+  std::string print() const;
+
+private:
+  bool local;
+  unsigned int nrColumnsPerBlock;
+  unsigned int nrRowsPerBlock;
+  unsigned int nrColumnsPerThread;
+  unsigned int nrRowsPerThread;
+  unsigned int nrFiltersPerThread;
+  unsigned int vectorWidth;
+  bool window;
+  ConvolutionBoundary boundary;
+  std::string accumulatorType;
+};
+
+// Piece of an OpenCL kernel, split once at its placeholders, that is appended to the code without temporaries
+class ConvolutionTemplate {
+public:
+  enum Placeholder { XNUM = 0, YNUM, FNUM, XOFFSET, YOFFSET, COEFFICIENT, TEXT };
+
+  ConvolutionTemplate(const std::string & text);
+  ~ConvolutionTemplate();
+  // Append the piece to code, with the numeric placeholders replaced by values and <%COEFFICIENT%> by coefficient
+  inline void append(std::string & code, const unsigned int * values, const std::string & coefficient = std::string()) const;
+  // Size of the piece once appended, with numbers of up to ten digits
+  inline size_t getSize() const;
+
+private:
+  struct Segment {
+    size_t begin;
+    size_t length;
+    Placeholder placeholder;
+  };
+
+  std::string text;
+  std::vector< Segment > segments;
+};
+
+// Type in which the products of a data type are accumulated: 8 and 16 bit integers in int, everything else in its own type
+template< typename T > struct ConvolutionAccumulator {
+  typedef T type;
+};
+template< > struct ConvolutionAccumulator< unsigned char > {
+  typedef int type;
+};
+template< > struct ConvolutionAccumulator< signed char > {
+  typedef int type;
+};
+template< > struct ConvolutionAccumulator< short > {
+  typedef int type;
+};
+template< > struct ConvolutionAccumulator< unsigned short > {
+  typedef int type;
+};
+// Average of nrTaps accumulated products, in the data type; integer results are rounded to the nearest value and saturated, like the OpenCL kernels
+template< typename T, typename A > inline T convolutionAverage(const A sum, const unsigned int nrTaps);
+
+// Sequential convolution algorithm, accumulating in A
+template< typename T, typename A = typename ConvolutionAccumulator< T >::type > void convolution(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+// Sequential convolution algorithm with the pixels outside the image given by boundary; interior pixels read the image directly, only the border applies the mode
+template< typename T, typename A = typename ConvolutionAccumulator< T >::type > void convolution(const ConvolutionBoundary boundary, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+// Element read, in a dimension of size elements, for index; -1 when the element is zero
+inline int getConvolutionBoundaryIndex(const ConvolutionBoundary boundary, const int index, const int size);
+// Boundary mode from its name (valid, zero, clamp, mirror, wrap), and back
+ConvolutionBoundary getConvolutionBoundary(const std::string & name);
+std::string toString(const ConvolutionBoundary boundary);
+// Parallel, cache-blocked convolution algorithm
+template< typename T > void convolutionParallel(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+// Parallel convolution of a batch of images, stored contiguously in memory and imageStride elements apart
+template< typename T > void convolutionBatched(const unsigned int nrImages, const unsigned int inputImageStride, const unsigned int outputImageStride, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+// Parallel, cache-blocked convolution with a bank of nrFilters filters, stored contiguously; each tile of the input is reused by all filters, and the output images are getOutputImageSize() elements apart
+template< typename T > void convolutionBank(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filters);
+// Size, in elements, of one padded input and output image
+unsigned int getInputImageSize(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight);
+unsigned int getOutputImageSize(const unsigned int padding, const unsigned int width, const unsigned int height);
+// Size, in elements, of one input image with the given boundary; only VALID images contain the border
+unsigned int getInputImageSize(const ConvolutionBoundary boundary, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight);
+// Work-items of the NDRange of conf in the first two dimensions; the tiles need not divide the image, the last work-group of a dimension is then a tail
+unsigned int getConvolutionGlobalColumns(const ConvolutionConf & conf, const unsigned int width);
+unsigned int getConvolutionGlobalRows(const ConvolutionConf & conf, const unsigned int height);
+// Fraction of the pixels computed by the NDRange of conf that lie outside the image
+double getConvolutionTailFraction(const ConvolutionConf & conf, const unsigned int width, const unsigned int height);
+// Operations of the direct algorithm, in GFLOP: a multiplication and an addition per tap, and the average
+double getConvolutionGFLOP(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters);
+// Memory traffic of the direct algorithm with conf, in GB; with local memory every tile and its border are read once, otherwise every tap reads its input element once every nrFiltersPerThread filters
+double getConvolutionGB(const ConvolutionConf & conf, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int elementSize);
+// Reads from local memory of the direct algorithm with conf, in GB; zero without local memory
+double getConvolutionLocalGB(const ConvolutionConf & conf, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int elementSize);
+// Tile size for the parallel algorithm, given the L1 and L2 cache sizes in bytes
+template< typename T > void getConvolutionTile(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int l1Size, const unsigned int l2Size, unsigned int & nrColumnsPerTile, unsigned int & nrRowsPerTile);
+// Parallel convolution algorithm with the filter size known at compile time
+template< typename T, unsigned int FilterWidth, unsigned int FilterHeight > void convolution(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+// Use the compile time algorithm for 3x3, 5x5, 7x7 and 11x11 filters, the parallel algorithm otherwise
+template< typename T > void convolutionSpecialized(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+// OpenCL convolution algorithm, kept for compatibility; it returns the code of getConvolutionOpenCLSource
 std::string * getConvolutionOpenCL(const bool local, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, std::string & dataType);
+// Code of the OpenCL convolution algorithm with conf, returned by value and written in a single pass. A bank of nrFilters filters, stored contiguously, writes nrFilters output images per input image, outputImageStride elements apart;
+// every work-item computes vectors of vectorWidth contiguous columns, loaded and stored with vloadN and vstoreN. Non empty coefficients are written in the code, zero coefficients are skipped and the filter argument is not read;
+// every work-item must then compute all the filters of the bank. Integer results are rounded and saturated. Work-groups whose tile, border included, lies inside the image run the code of VALID, only the others apply
+// the boundary mode. With the sliding window every work-item reads each row of the tile in local memory that it needs once, into registers shared by all its accumulators that cover the row.
+std::string getConvolutionOpenCLSource(const ConvolutionConf & conf, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType, const std::vector< double > & coefficients = std::vector< double >());
+// OpenCL type in which the products of dataType are accumulated by default: int for 8 and 16 bit integers, float for half
+std::string getConvolutionAccumulatorType(const std::string & dataType);
+// OpenCL expressions reading one element, or vectorWidth elements, of dataType as accumulatorType, and writing them back as dataType
+std::string getConvolutionLoad(const std::string & pointer, const std::string & index, const unsigned int vectorWidth, const std::string & dataType, const std::string & accumulatorType);
+std::string getConvolutionStore(const std::string & value, const std::string & pointer, const std::string & index, const unsigned int vectorWidth, const std::string & dataType, const std::string & accumulatorType);
+// OpenCL statement dividing sum by the number of taps; integers round halves away from zero, like convolutionAverage
+std::string getConvolutionAverage(const std::string & sum, const unsigned int nrTaps, const unsigned int vectorWidth, const std::string & accumulatorType);
+// getConvolutionStore for a tail work-group, that skips the elements outside the width x height image; row and column are those of the first element
+std::string getConvolutionTailStore(const std::string & value, const std::string & pointer, const std::string & index, const std::string & row, const std::string & column, const unsigned int width, const unsigned int height, const unsigned int vectorWidth, const std::string & dataType, const std::string & accumulatorType);
+// OpenCL literal of a value of type dataType
+std::string getConvolutionLiteral(const double value, const std::string & dataType);
+// Bytes of an OpenCL scalar type
+unsigned int getConvolutionTypeSize(const std::string & dataType);
+// OpenCL functions reading, as loadType, the element at row and column of an image with the boundary mode: loadInput, and loadInputVector for vectorWidth consecutive columns.
+// VALID clamps to the input, border included, for the tail tiles that extend past the image.
+std::string getConvolutionBoundaryOpenCL(const ConvolutionBoundary boundary, const unsigned int width, const unsigned int height, const unsigned int inputImageStride, const unsigned int inputStride, const unsigned int vectorWidth, const std::string & dataType, const std::string & loadType);
+// OpenCL condition that holds for the work-groups whose tile, border included, lies inside the image
+std::string getConvolutionInteriorOpenCL(const ConvolutionBoundary boundary, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int tileWidth, const unsigned int tileHeight);
 
 // Implementations
-template< typename T > void convolution(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+ConvolutionConf::ConvolutionConf() : local(false), nrColumnsPerBlock(1), nrRowsPerBlock(1), nrColumnsPerThread(1), nrRowsPerThread(1), nrFiltersPerThread(1), vectorWidth(1), window(false), boundary(VALID), accumulatorType() {}
+
+ConvolutionConf::~ConvolutionConf() {}
+
+inline bool ConvolutionConf::getLocalMemory() const {
+  return local;
+}
+
+inline unsigned int ConvolutionConf::getNrColumnsPerBlock() const {
+  return nrColumnsPerBlock;
+}
+
+inline unsigned int ConvolutionConf::getNrRowsPerBlock() const {
+  return nrRowsPerBlock;
+}
+
+inline unsigned int ConvolutionConf::getNrColumnsPerThread() const {
+  return nrColumnsPerThread;
+}
+
+inline unsigned int ConvolutionConf::getNrRowsPerThread() const {
+  return nrRowsPerThread;
+}
+
+inline unsigned int ConvolutionConf::getNrFiltersPerThread() const {
+  return nrFiltersPerThread;
+}
+
+inline unsigned int ConvolutionConf::getVectorWidth() const {
+  return vectorWidth;
+}
+
+inline bool ConvolutionConf::getWindow() const {
+  return window;
+}
+
+inline ConvolutionBoundary ConvolutionConf::getBoundary() const {
+  return boundary;
+}
+
+inline const std::string & ConvolutionConf::getAccumulatorType() const {
+  return accumulatorType;
+}
+
+inline void ConvolutionConf::setLocalMemory(const bool local) {
+  this->local = local;
+}
+
+inline void ConvolutionConf::setNrColumnsPerBlock(const unsigned int columns) {
+  nrColumnsPerBlock = columns;
+}
+
+inline void ConvolutionConf::setNrRowsPerBlock(const unsigned int rows) {
+  nrRowsPerBlock = rows;
+}
+
+inline void ConvolutionConf::setNrColumnsPerThread(const unsigned int columns) {
+  nrColumnsPerThread = columns;
+}
+
+inline void ConvolutionConf::setNrRowsPerThread(const unsigned int rows) {
+  nrRowsPerThread = rows;
+}
+
+inline void ConvolutionConf::setNrFiltersPerThread(const unsigned int filters) {
+  nrFiltersPerThread = filters;
+}
+
+inline void ConvolutionConf::setVectorWidth(const unsigned int width) {
+  vectorWidth = width;
+}
+
+inline void ConvolutionConf::setWindow(const bool window) {
+  this->window = window;
+}
+
+inline void ConvolutionConf::setBoundary(const ConvolutionBoundary boundary) {
+  this->boundary = boundary;
+}
+
+inline void ConvolutionConf::setAccumulatorType(const std::string & type) {
+  accumulatorType = type;
+}
+
+std::string ConvolutionConf::print() const {
+  // The default accumulator type depends on the data type, so it is printed by name
+  return isa::utils::toString(local) + " " + isa::utils::toString(nrColumnsPerBlock) + " " + isa::utils::toString(nrRowsPerBlock) + " " + isa::utils::toString(nrColumnsPerThread) + " " + isa::utils::toString(nrRowsPerThread) + " " + isa::utils::toString(nrFiltersPerThread) + " " + isa::utils::toString(vectorWidth) + " " + isa::utils::toString(window) + " " + toString(boundary) + " " + (accumulatorType.empty() ? "default" : accumulatorType);
+}
+
+ConvolutionTemplate::ConvolutionTemplate(const std::string & text) : text(text) {
+  const char * names[TEXT] = {"<%XNUM%>", "<%YNUM%>", "<%FNUM%>", "<%XOFFSET%>", "<%YOFFSET%>", "<%COEFFICIENT%>"};
+  size_t begin = 0;
+  size_t position = 0;
+
+  while ( (position = text.find("<%", position)) != std::string::npos ) {
+    unsigned int placeholder = 0;
+
+    for ( ; placeholder < TEXT; placeholder++ ) {
+      if ( text.compare(position, std::char_traits< char >::length(names[placeholder]), names[placeholder]) == 0 ) {
+        break;
+      }
+    }
+    if ( placeholder == TEXT ) {
+      // Not one of the placeholders of this template, so it is text
+      position += 2;
+      continue;
+    }
+    Segment segment = {begin, position - begin, static_cast< Placeholder >(placeholder)};
+    segments.push_back(segment);
+    position += std::char_traits< char >::length(names[placeholder]);
+    begin = position;
+  }
+  Segment segment = {begin, text.size() - begin, TEXT};
+  segments.push_back(segment);
+}
+
+ConvolutionTemplate::~ConvolutionTemplate() {}
+
+inline void ConvolutionTemplate::append(std::string & code, const unsigned int * values, const std::string & coefficient) const {
+  for ( std::vector< Segment >::const_iterator segment = segments.begin(); segment != segments.end(); ++segment ) {
+    code.append(text, segment->begin, segment->length);
+    if ( segment->placeholder == COEFFICIENT ) {
+      code.append(coefficient);
+    } else if ( segment->placeholder != TEXT ) {
+      // Digits are written backwards into a small buffer, so that no string is created
+      char digits[10];
+      unsigned int nrDigits = 0;
+      unsigned int value = values[segment->placeholder];
+
+      do {
+        digits[nrDigits++] = '0' + (value % 10);
+        value /= 10;
+      } while ( value > 0 );
+      while ( nrDigits > 0 ) {
+        code.push_back(digits[--nrDigits]);
+      }
+    }
+  }
+}
+
+inline size_t ConvolutionTemplate::getSize() const {
+  return text.size() + (segments.size() * 10);
+}
+
+template< typename T, typename A > inline T convolutionAverage(const A sum, const unsigned int nrTaps) {
+  A average = 0;
+
+  if ( std::numeric_limits< A >::is_integer ) {
+    // Halves are rounded away from zero
+    if ( sum >= 0 ) {
+      average = (sum + static_cast< A >(nrTaps / 2)) / static_cast< A >(nrTaps);
+    } else {
+      average = (sum - static_cast< A >(nrTaps / 2)) / static_cast< A >(nrTaps);
+    }
+  } else {
+    average = sum / nrTaps;
+  }
+  if ( !std::numeric_limits< T >::is_integer ) {
+    return static_cast< T >(average);
+  } else if ( !std::numeric_limits< A >::is_integer ) {
+    // Halves are rounded to even, like convert_T_sat_rte
+    average = static_cast< A >(std::nearbyint(static_cast< double >(average)));
+  }
+  if ( average < static_cast< A >(std::numeric_limits< T >::min()) ) {
+    return std::numeric_limits< T >::min();
+  } else if ( average > static_cast< A >(std::numeric_limits< T >::max()) ) {
+    return std::numeric_limits< T >::max();
+  }
+  return static_cast< T >(average);
+}
+
+template< typename T, typename A > void convolution(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
 
   for ( unsigned int y = 0; y < height; y++ ) {
     for ( unsigned int x = 0; x < width; x++ ) {
-      T sum = 0;
+      A sum = 0;
 
       for ( unsigned int fY = y; fY < y + filterHeight; fY++ ) {
         for (unsigned int fX = x; fX < x + filterWidth; fX++ ) {
-          sum += input[(fY * isa::utils::pad(width + (filterWidth - 1), padding)) + fX] * filter[((fY - y) * filterWidth) + (fX - x)];
+          sum += static_cast< A >(input[(fY * isa::utils::pad(width + (filterWidth - 1), padding)) + fX]) * static_cast< A >(filter[((fY - y) * filterWidth) + (fX - x)]);
         }
       }
-      sum /= filterWidth * filterHeight;
-      output[(y * isa::utils::pad(width, padding)) + x] = sum;
+      output[(y * isa::utils::pad(width, padding)) + x] = convolutionAverage< T >(sum, filterWidth * filterHeight);
     }
   }
 }
 
-std::string * getConvolutionOpenCL(const bool local, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, std::string & dataType) {
-  std::string * code = new std::string();
+template< typename T, typename A > void convolution(const ConvolutionBoundary boundary, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  const unsigned int stride = isa::utils::pad(width, padding);
+  const int left = filterWidth / 2;
+  const int top = filterHeight / 2;
 
-  // Begin kernel's template
-  *code = "__kernel void convolution(__global const " + dataType + " * const restrict input, __global " + dataType + " * const restrict output, __constant const " + dataType + " * const restrict filter) {\n";
-  if ( local ) {
-    *code += "const unsigned int x = (get_group_id(0) * " + isa::utils::toString(nrColumnsPerBlock * nrColumnsPerThread) + ");\n"
-      "const unsigned int y = (get_group_id(1) * " + isa::utils::toString(nrRowsPerBlock * nrRowsPerThread) + ");\n"
-      "unsigned int fX = 0;\n"
-      "unsigned int fY = 0;\n";
-    if ( nrColumnsPerBlock < padding ) {
-      *code += "__local " + dataType + " localInput[" + isa::utils::toString(isa::utils::pad((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1), padding) * ((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1))) + "];\n";
-    } else {
-      *code += "__local " + dataType + " localInput[" + isa::utils::toString(((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1)) * ((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1))) + "];\n";
+  if ( boundary == VALID ) {
+    convolution< T, A >(padding, width, height, filterWidth, filterHeight, input, output, filter);
+    return;
+  }
+  for ( int y = 0; y < static_cast< int >(height); y++ ) {
+    // Columns, and rows, whose filter lies inside the image
+    const bool interiorRow = y >= top && y + static_cast< int >(filterHeight) - top <= static_cast< int >(height);
+
+    for ( int x = 0; x < static_cast< int >(width); x++ ) {
+      A sum = 0;
+
+      if ( interiorRow && x >= left && x + static_cast< int >(filterWidth) - left <= static_cast< int >(width) ) {
+        for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+          for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+            sum += static_cast< A >(input[((y - top + fY) * stride) + (x - left + fX)]) * static_cast< A >(filter[(fY * filterWidth) + fX]);
+          }
+        }
+      } else {
+        for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+          const int row = getConvolutionBoundaryIndex(boundary, y - top + fY, height);
+
+          for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+            const int column = getConvolutionBoundaryIndex(boundary, x - left + fX, width);
+
+            if ( row >= 0 && column >= 0 ) {
+              sum += static_cast< A >(input[(row * stride) + column]) * static_cast< A >(filter[(fY * filterWidth) + fX]);
+            }
+          }
+        }
+      }
+      output[(y * stride) + x] = convolutionAverage< T >(sum, filterWidth * filterHeight);
+    }
+  }
+}
+
+inline int getConvolutionBoundaryIndex(const ConvolutionBoundary boundary, const int index, const int size) {
+  int boundaryIndex = index;
+
+  if ( index >= 0 && index < size ) {
+    return index;
+  }
+  if ( boundary == CLAMP ) {
+    boundaryIndex = std::min(std::max(index, 0), size - 1);
+  } else if ( boundary == MIRROR ) {
+    // The mirror image repeats every two sizes, so filters larger than the image are handled too
+    boundaryIndex = index % (2 * size);
+    if ( boundaryIndex < 0 ) {
+      boundaryIndex += 2 * size;
+    }
+    if ( boundaryIndex >= size ) {
+      boundaryIndex = (2 * size) - 1 - boundaryIndex;
+    }
+  } else if ( boundary == WRAP ) {
+    boundaryIndex = index % size;
+    if ( boundaryIndex < 0 ) {
+      boundaryIndex += size;
     }
   } else {
-    *code += "const unsigned int x = (get_group_id(0) * " + isa::utils::toString(nrColumnsPerBlock * nrColumnsPerThread) + ") + get_local_id(0);\n"
-      "const unsigned int y = (get_group_id(1) * " + isa::utils::toString(nrRowsPerBlock * nrRowsPerThread) + ") + get_local_id(1);\n";
+    boundaryIndex = -1;
   }
-  *code += "<%DEF_SUMS%>";
-  if ( local ) {
-    *code += "fY = get_local_id(1);\n"
-      "fX = get_local_id(0);\n"
-      "<%LOAD%>"
-      "barrier(CLK_LOCAL_MEM_FENCE);\n"
-      "fY = get_local_id(1);\n"
-      "fX = get_local_id(0);\n"
-      "<%SUMS%>";
+  return boundaryIndex;
+}
+
+ConvolutionBoundary getConvolutionBoundary(const std::string & name) {
+  if ( name == "valid" ) {
+    return VALID;
+  } else if ( name == "zero" ) {
+    return ZERO;
+  } else if ( name == "clamp" ) {
+    return CLAMP;
+  } else if ( name == "mirror" ) {
+    return MIRROR;
+  } else if ( name == "wrap" ) {
+    return WRAP;
+  }
+  throw std::invalid_argument("Unknown boundary mode \"" + name + "\".");
+}
+
+std::string toString(const ConvolutionBoundary boundary) {
+  if ( boundary == ZERO ) {
+    return "zero";
+  } else if ( boundary == CLAMP ) {
+    return "clamp";
+  } else if ( boundary == MIRROR ) {
+    return "mirror";
+  } else if ( boundary == WRAP ) {
+    return "wrap";
+  }
+  return "valid";
+}
+
+template< typename T > void convolutionParallel(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  const unsigned int inputStride = isa::utils::pad(width + (filterWidth - 1), padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+  const unsigned int nrTileColumns = (width + nrColumnsPerTile - 1) / nrColumnsPerTile;
+  const unsigned int nrTileRows = (height + nrRowsPerTile - 1) / nrRowsPerTile;
+  const int nrTiles = nrTileColumns * nrTileRows;
+
+  #pragma omp parallel
+  {
+    // Each thread accumulates one row of its current tile at a time
+    std::vector< typename ConvolutionAccumulator< T >::type > sums = std::vector< typename ConvolutionAccumulator< T >::type >(nrColumnsPerTile);
+
+    #pragma omp for schedule(dynamic)
+    for ( int tile = 0; tile < nrTiles; tile++ ) {
+      const unsigned int tileX = (tile % nrTileColumns) * nrColumnsPerTile;
+      const unsigned int tileY = (tile / nrTileColumns) * nrRowsPerTile;
+      const unsigned int tileWidth = std::min(nrColumnsPerTile, width - tileX);
+      const unsigned int tileHeight = std::min(nrRowsPerTile, height - tileY);
+
+      for ( unsigned int y = tileY; y < tileY + tileHeight; y++ ) {
+        std::fill(sums.begin(), sums.begin() + tileWidth, static_cast< typename ConvolutionAccumulator< T >::type >(0));
+        // Taps are visited in the same order as the sequential algorithm, so the results are identical
+        for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+          for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+            const T tap = filter[(fY * filterWidth) + fX];
+            const T * inputRow = &(input[((y + fY) * inputStride) + tileX + fX]);
+
+            for ( unsigned int x = 0; x < tileWidth; x++ ) {
+              sums[x] += inputRow[x] * tap;
+            }
+          }
+        }
+        for ( unsigned int x = 0; x < tileWidth; x++ ) {
+          output[(y * outputStride) + tileX + x] = convolutionAverage< T >(sums[x], filterWidth * filterHeight);
+        }
+      }
+    }
+  }
+}
+
+template< typename T > void getConvolutionTile(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int l1Size, const unsigned int l2Size, unsigned int & nrColumnsPerTile, unsigned int & nrRowsPerTile) {
+  // The filterHeight input rows touched by one output row of the tile fit in L1
+  nrColumnsPerTile = l1Size / (filterHeight * sizeof(T));
+  if ( nrColumnsPerTile > filterWidth - 1 ) {
+    nrColumnsPerTile -= filterWidth - 1;
+  } else {
+    nrColumnsPerTile = 1;
+  }
+  if ( nrColumnsPerTile > 16 ) {
+    nrColumnsPerTile -= nrColumnsPerTile % 16;
+  }
+  nrColumnsPerTile = std::min(nrColumnsPerTile, width);
+  // The whole input region of the tile fits in L2
+  nrRowsPerTile = l2Size / ((nrColumnsPerTile + (filterWidth - 1)) * sizeof(T));
+  if ( nrRowsPerTile > filterHeight - 1 ) {
+    nrRowsPerTile -= filterHeight - 1;
+  } else {
+    nrRowsPerTile = 1;
+  }
+  nrRowsPerTile = std::min(nrRowsPerTile, height);
+}
+
+template< typename T > void convolutionBatched(const unsigned int nrImages, const unsigned int inputImageStride, const unsigned int outputImageStride, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  const unsigned int inputStride = isa::utils::pad(width + (filterWidth - 1), padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+
+  #pragma omp parallel
+  {
+    // Each thread accumulates one row of its current image at a time
+    std::vector< typename ConvolutionAccumulator< T >::type > sums = std::vector< typename ConvolutionAccumulator< T >::type >(width);
+
+    #pragma omp for schedule(dynamic)
+    for ( int image = 0; image < static_cast< int >(nrImages); image++ ) {
+      const T * inputImage = &(input[image * inputImageStride]);
+      T * outputImage = &(output[image * outputImageStride]);
+
+      for ( unsigned int y = 0; y < height; y++ ) {
+        std::fill(sums.begin(), sums.end(), static_cast< typename ConvolutionAccumulator< T >::type >(0));
+        // Taps are visited in the same order as the sequential algorithm, so the results are identical
+        for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+          for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+            const T tap = filter[(fY * filterWidth) + fX];
+            const T * inputRow = &(inputImage[((y + fY) * inputStride) + fX]);
+
+            for ( unsigned int x = 0; x < width; x++ ) {
+              sums[x] += inputRow[x] * tap;
+            }
+          }
+        }
+        for ( unsigned int x = 0; x < width; x++ ) {
+          outputImage[(y * outputStride) + x] = convolutionAverage< T >(sums[x], filterWidth * filterHeight);
+        }
+      }
+    }
+  }
+}
+
+template< typename T > void convolutionBank(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filters) {
+  const unsigned int inputStride = isa::utils::pad(width + (filterWidth - 1), padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+  const unsigned int outputImageStride = getOutputImageSize(padding, width, height);
+  const unsigned int nrTileColumns = (width + nrColumnsPerTile - 1) / nrColumnsPerTile;
+  const unsigned int nrTileRows = (height + nrRowsPerTile - 1) / nrRowsPerTile;
+  const int nrTiles = nrTileColumns * nrTileRows;
+
+  #pragma omp parallel
+  {
+    // Each thread accumulates one row of its current tile at a time
+    std::vector< typename ConvolutionAccumulator< T >::type > sums = std::vector< typename ConvolutionAccumulator< T >::type >(nrColumnsPerTile);
+
+    #pragma omp for schedule(dynamic)
+    for ( int tile = 0; tile < nrTiles; tile++ ) {
+      const unsigned int tileX = (tile % nrTileColumns) * nrColumnsPerTile;
+      const unsigned int tileY = (tile / nrTileColumns) * nrRowsPerTile;
+      const unsigned int tileWidth = std::min(nrColumnsPerTile, width - tileX);
+      const unsigned int tileHeight = std::min(nrRowsPerTile, height - tileY);
+
+      // The input of the tile is still in cache when the next filter is applied
+      for ( unsigned int filter = 0; filter < nrFilters; filter++ ) {
+        const T * taps = &(filters[filter * filterWidth * filterHeight]);
+        T * outputImage = &(output[filter * outputImageStride]);
+
+        for ( unsigned int y = tileY; y < tileY + tileHeight; y++ ) {
+          std::fill(sums.begin(), sums.begin() + tileWidth, static_cast< typename ConvolutionAccumulator< T >::type >(0));
+          for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+            for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+              const T tap = taps[(fY * filterWidth) + fX];
+              const T * inputRow = &(input[((y + fY) * inputStride) + tileX + fX]);
+
+              for ( unsigned int x = 0; x < tileWidth; x++ ) {
+                sums[x] += inputRow[x] * tap;
+              }
+            }
+          }
+          for ( unsigned int x = 0; x < tileWidth; x++ ) {
+            outputImage[(y * outputStride) + tileX + x] = convolutionAverage< T >(sums[x], filterWidth * filterHeight);
+          }
+        }
+      }
+    }
+  }
+}
+
+unsigned int getInputImageSize(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight) {
+  return (height + (filterHeight - 1)) * isa::utils::pad(width + (filterWidth - 1), padding);
+}
+
+unsigned int getOutputImageSize(const unsigned int padding, const unsigned int width, const unsigned int height) {
+  return height * isa::utils::pad(width, padding);
+}
+
+unsigned int getInputImageSize(const ConvolutionBoundary boundary, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight) {
+  if ( boundary == VALID ) {
+    return getInputImageSize(padding, width, height, filterWidth, filterHeight);
+  }
+  return getOutputImageSize(padding, width, height);
+}
+
+unsigned int getConvolutionGlobalColumns(const ConvolutionConf & conf, const unsigned int width) {
+  const unsigned int tileWidth = conf.getNrColumnsPerBlock() * conf.getNrColumnsPerThread() * conf.getVectorWidth();
+
+  return ((width + tileWidth - 1) / tileWidth) * conf.getNrColumnsPerBlock();
+}
+
+unsigned int getConvolutionGlobalRows(const ConvolutionConf & conf, const unsigned int height) {
+  const unsigned int tileHeight = conf.getNrRowsPerBlock() * conf.getNrRowsPerThread();
+
+  return ((height + tileHeight - 1) / tileHeight) * conf.getNrRowsPerBlock();
+}
+
+double getConvolutionTailFraction(const ConvolutionConf & conf, const unsigned int width, const unsigned int height) {
+  const double columns = getConvolutionGlobalColumns(conf, width) * conf.getNrColumnsPerThread() * conf.getVectorWidth();
+  const double rows = getConvolutionGlobalRows(conf, height) * conf.getNrRowsPerThread();
+
+  return 1.0 - ((static_cast< double >(width) * height) / (columns * rows));
+}
+
+double getConvolutionGFLOP(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters) {
+  return isa::utils::giga(((static_cast< long long unsigned int >(width) * height * filterWidth * filterHeight * 2) + (static_cast< long long unsigned int >(width) * height)) * nrFilters);
+}
+
+double getConvolutionGB(const ConvolutionConf & conf, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int elementSize) {
+  const unsigned int tileWidth = conf.getNrColumnsPerBlock() * conf.getNrColumnsPerThread() * conf.getVectorWidth();
+  const unsigned int tileHeight = conf.getNrRowsPerBlock() * conf.getNrRowsPerThread();
+
+  if ( conf.getLocalMemory() ) {
+    // The input tile is loaded once for all the filters of the bank
+    return isa::utils::giga((static_cast< long long unsigned int >((width + tileWidth - 1) / tileWidth) * ((height + tileHeight - 1) / tileHeight) * ((tileWidth + (filterWidth - 1)) * (tileHeight + (filterHeight - 1))) * elementSize) + (static_cast< long long unsigned int >(width) * height * nrFilters * elementSize) + (static_cast< long long unsigned int >(width) * (height) * filterWidth * filterHeight * nrFilters * elementSize));
+  }
+  return isa::utils::giga((static_cast< long long unsigned int >(width) * height * filterWidth * filterHeight * ((nrFilters / conf.getNrFiltersPerThread()) + nrFilters) * elementSize) + (static_cast< long long unsigned int >(width) * height * nrFilters * elementSize));
+}
+
+double getConvolutionLocalGB(const ConvolutionConf & conf, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int elementSize) {
+  const unsigned int step = conf.getNrColumnsPerBlock() * conf.getVectorWidth();
+  const long long unsigned int nrItems = static_cast< long long unsigned int >(getConvolutionGlobalColumns(conf, width)) * getConvolutionGlobalRows(conf, height);
+  // Vectors read by a work-item for every block of filters: one per tap of every accumulator, or one per row and column of the window
+  long long unsigned int nrReads = conf.getNrColumnsPerThread() * conf.getNrRowsPerThread() * filterWidth * filterHeight;
+
+  if ( !conf.getLocalMemory() ) {
+    return 0.0;
+  }
+  if ( conf.getWindow() ) {
+    // The columns of neighbouring accumulators overlap when they are closer than the filter width
+    unsigned int nrColumns = conf.getNrColumnsPerThread() * filterWidth;
+    if ( step < filterWidth ) {
+      nrColumns = ((conf.getNrColumnsPerThread() - 1) * step) + filterWidth;
+    }
+    // The same for the rows, and the rows between accumulators further apart than the filter height are not read
+    nrReads = static_cast< long long unsigned int >(((conf.getNrRowsPerThread() - 1) * std::min(conf.getNrRowsPerBlock(), filterHeight)) + filterHeight) * nrColumns;
+  }
+  return isa::utils::giga(nrItems * nrReads * conf.getVectorWidth() * (nrFilters / conf.getNrFiltersPerThread()) * elementSize);
+}
+
+// Filter taps unrolled at compile time, accumulated in the same order as the sequential algorithm
+template< typename T, unsigned int FilterWidth, unsigned int Tap, unsigned int NrTaps > struct ConvolutionTaps {
+  static inline typename ConvolutionAccumulator< T >::type sum(const T * input, const unsigned int inputStride, const T * taps, const typename ConvolutionAccumulator< T >::type partial) {
+    return ConvolutionTaps< T, FilterWidth, Tap + 1, NrTaps >::sum(input, inputStride, taps, partial + (input[((Tap / FilterWidth) * inputStride) + (Tap % FilterWidth)] * taps[Tap]));
+  }
+};
+
+template< typename T, unsigned int FilterWidth, unsigned int NrTaps > struct ConvolutionTaps< T, FilterWidth, NrTaps, NrTaps > {
+  static inline typename ConvolutionAccumulator< T >::type sum(const T * input, const unsigned int inputStride, const T * taps, const typename ConvolutionAccumulator< T >::type partial) {
+    return partial;
+  }
+};
+
+template< typename T, unsigned int FilterWidth, unsigned int FilterHeight > void convolution(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  const unsigned int inputStride = isa::utils::pad(width + (FilterWidth - 1), padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+  const unsigned int nrTileColumns = (width + nrColumnsPerTile - 1) / nrColumnsPerTile;
+  const unsigned int nrTileRows = (height + nrRowsPerTile - 1) / nrRowsPerTile;
+  const int nrTiles = nrTileColumns * nrTileRows;
+  T taps[FilterWidth * FilterHeight];
+
+  std::copy(filter.begin(), filter.begin() + (FilterWidth * FilterHeight), taps);
+  #pragma omp parallel for schedule(dynamic)
+  for ( int tile = 0; tile < nrTiles; tile++ ) {
+    const unsigned int tileX = (tile % nrTileColumns) * nrColumnsPerTile;
+    const unsigned int tileY = (tile / nrTileColumns) * nrRowsPerTile;
+    const unsigned int tileWidth = std::min(nrColumnsPerTile, width - tileX);
+    const unsigned int tileHeight = std::min(nrRowsPerTile, height - tileY);
+
+    for ( unsigned int y = tileY; y < tileY + tileHeight; y++ ) {
+      const T * inputRow = &(input[(y * inputStride) + tileX]);
+      T * outputRow = &(output[(y * outputStride) + tileX]);
+
+      // The output row cannot alias the input, so the columns are computed in SIMD lanes
+      #pragma omp simd
+      for ( unsigned int x = 0; x < tileWidth; x++ ) {
+        typename ConvolutionAccumulator< T >::type sum = ConvolutionTaps< T, FilterWidth, 0, FilterWidth * FilterHeight >::sum(inputRow + x, inputStride, taps, static_cast< typename ConvolutionAccumulator< T >::type >(0));
+
+        outputRow[x] = convolutionAverage< T >(sum, FilterWidth * FilterHeight);
+      }
+    }
+  }
+}
+
+template< typename T > void convolutionSpecialized(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  if ( filterWidth == 3 && filterHeight == 3 ) {
+    convolution< T, 3, 3 >(padding, width, height, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+  } else if ( filterWidth == 5 && filterHeight == 5 ) {
+    convolution< T, 5, 5 >(padding, width, height, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+  } else if ( filterWidth == 7 && filterHeight == 7 ) {
+    convolution< T, 7, 7 >(padding, width, height, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+  } else if ( filterWidth == 11 && filterHeight == 11 ) {
+    convolution< T, 11, 11 >(padding, width, height, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
   } else {
-    *code += "for ( unsigned int fY = y; fY < y + " + isa::utils::toString(filterHeight) + "; fY++ ) {\n"
-      "for ( unsigned int fX = x; fX < x + " + isa::utils::toString(filterWidth) + "; fX++ ) {\n"
-      "<%SUMS%>"
+    convolutionParallel(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+  }
+}
+
+std::string * getConvolutionOpenCL(const bool local, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, std::string & dataType) {
+  ConvolutionConf conf;
+
+  conf.setLocalMemory(local);
+  conf.setNrColumnsPerBlock(nrColumnsPerBlock);
+  conf.setNrRowsPerBlock(nrRowsPerBlock);
+  conf.setNrColumnsPerThread(nrColumnsPerThread);
+  conf.setNrRowsPerThread(nrRowsPerThread);
+  return new std::string(getConvolutionOpenCLSource(conf, padding, width, height, filterWidth, filterHeight, 1, getInputImageSize(padding, width, height, filterWidth, filterHeight), getOutputImageSize(padding, width, height), dataType));
+}
+
+std::string getConvolutionAccumulatorType(const std::string & dataType) {
+  if ( dataType == "uchar" || dataType == "char" || dataType == "ushort" || dataType == "short" ) {
+    return "int";
+  } else if ( dataType == "half" ) {
+    return "float";
+  }
+  return dataType;
+}
+
+std::string getConvolutionLoad(const std::string & pointer, const std::string & index, const unsigned int vectorWidth, const std::string & dataType, const std::string & accumulatorType) {
+  std::string vectorWidth_s;
+  std::string load;
+
+  if ( vectorWidth > 1 ) {
+    vectorWidth_s = isa::utils::toString(vectorWidth);
+  }
+  if ( dataType == "half" ) {
+    return "vload_half" + vectorWidth_s + "(0, " + pointer + " + " + index + ")";
+  } else if ( vectorWidth > 1 ) {
+    load = "vload" + vectorWidth_s + "(0, " + pointer + " + " + index + ")";
+  } else {
+    load = pointer + "[" + index + "]";
+  }
+  if ( dataType == accumulatorType ) {
+    return load;
+  }
+  return "convert_" + accumulatorType + vectorWidth_s + "(" + load + ")";
+}
+
+std::string getConvolutionStore(const std::string & value, const std::string & pointer, const std::string & index, const unsigned int vectorWidth, const std::string & dataType, const std::string & accumulatorType) {
+  std::string vectorWidth_s;
+  std::string store = value;
+
+  if ( vectorWidth > 1 ) {
+    vectorWidth_s = isa::utils::toString(vectorWidth);
+  }
+  if ( dataType == "half" ) {
+    return "vstore_half" + vectorWidth_s + "_rte(" + value + ", 0, " + pointer + " + " + index + ");\n";
+  } else if ( dataType != accumulatorType && dataType != "float" && dataType != "double" ) {
+    // Integers are saturated, and rounded to the nearest value when coming from floating point
+    if ( accumulatorType == "float" || accumulatorType == "double" ) {
+      store = "convert_" + dataType + vectorWidth_s + "_sat_rte(" + value + ")";
+    } else {
+      store = "convert_" + dataType + vectorWidth_s + "_sat(" + value + ")";
+    }
+  } else if ( dataType != accumulatorType ) {
+    store = "convert_" + dataType + vectorWidth_s + "(" + value + ")";
+  }
+  if ( vectorWidth > 1 ) {
+    return "vstore" + vectorWidth_s + "(" + store + ", 0, " + pointer + " + " + index + ");\n";
+  }
+  return pointer + "[" + index + "] = " + store + ";\n";
+}
+
+std::string getConvolutionAverage(const std::string & sum, const unsigned int nrTaps, const unsigned int vectorWidth, const std::string & accumulatorType) {
+  std::string accumulatorVectorType = accumulatorType;
+
+  if ( accumulatorType == "float" || accumulatorType == "double" ) {
+    return sum + " *= " + getConvolutionLiteral(1.0 / nrTaps, accumulatorType) + ";\n";
+  } else if ( vectorWidth > 1 ) {
+    accumulatorVectorType += isa::utils::toString(vectorWidth);
+  }
+  return sum + " = (" + sum + " + select((" + accumulatorVectorType + ")(-" + isa::utils::toString(nrTaps / 2) + "), (" + accumulatorVectorType + ")(" + isa::utils::toString(nrTaps / 2) + "), " + sum + " >= 0)) / " + isa::utils::toString(nrTaps) + ";\n";
+}
+
+std::string getConvolutionTailStore(const std::string & value, const std::string & pointer, const std::string & index, const std::string & row, const std::string & column, const unsigned int width, const unsigned int height, const unsigned int vectorWidth, const std::string & dataType, const std::string & accumulatorType) {
+  if ( vectorWidth == 1 ) {
+    return "if ( (" + row + ") < " + isa::utils::toString(height) + " && (" + column + ") < " + isa::utils::toString(width) + " ) {\n"
+      + getConvolutionStore(value, pointer, index, 1, dataType, accumulatorType) +
+      "}\n";
+  }
+  // A vector that crosses the right edge is stored one element at a time
+  return "if ( (" + row + ") < " + isa::utils::toString(height) + " ) {\n"
+    + accumulatorType + " tail[" + isa::utils::toString(vectorWidth) + "];\n"
+    "vstore" + isa::utils::toString(vectorWidth) + "(" + value + ", 0, tail);\n"
+    "for ( unsigned int item = 0; item < " + isa::utils::toString(vectorWidth) + "; item++ ) {\n"
+    "if ( (" + column + ") + item < " + isa::utils::toString(width) + " ) {\n"
+    + getConvolutionStore("tail[item]", pointer, index + " + item", 1, dataType, accumulatorType) +
+    "}\n"
+    "}\n"
+    "}\n";
+}
+
+std::string getConvolutionLiteral(const double value, const std::string & dataType) {
+  std::ostringstream literal;
+
+  // Enough digits to represent a double exactly
+  literal.precision(17);
+  literal << value;
+  if ( dataType != "float" && dataType != "double" ) {
+    return literal.str();
+  } else if ( literal.str().find_first_of(".en") == std::string::npos ) {
+    literal << ".0";
+  }
+  if ( dataType == "float" ) {
+    literal << "f";
+  }
+  return literal.str();
+}
+
+unsigned int getConvolutionTypeSize(const std::string & dataType) {
+  if ( dataType == "char" || dataType == "uchar" ) {
+    return 1;
+  } else if ( dataType == "short" || dataType == "ushort" || dataType == "half" ) {
+    return 2;
+  } else if ( dataType == "int" || dataType == "uint" || dataType == "float" ) {
+    return 4;
+  } else if ( dataType == "long" || dataType == "ulong" || dataType == "double" ) {
+    return 8;
+  }
+  throw std::invalid_argument("Unknown OpenCL type: " + dataType + ".");
+}
+
+std::string getConvolutionBoundaryOpenCL(const ConvolutionBoundary boundary, const unsigned int width, const unsigned int height, const unsigned int inputImageStride, const unsigned int inputStride, const unsigned int vectorWidth, const std::string & dataType, const std::string & loadType) {
+  std::string code = "int getBoundaryIndex(int index, const int size) {\n";
+
+  // Same mapping as getConvolutionBoundaryIndex
+  if ( boundary == CLAMP || boundary == VALID ) {
+    code += "return (index < 0) ? 0 : ((index >= size) ? size - 1 : index);\n";
+  } else if ( boundary == MIRROR ) {
+    code += "index %= 2 * size;\n"
+      "if ( index < 0 ) {\n"
+      "index += 2 * size;\n"
       "}\n"
+      "return (index < size) ? index : (2 * size) - 1 - index;\n";
+  } else if ( boundary == WRAP ) {
+    code += "index %= size;\n"
+      "return (index < 0) ? index + size : index;\n";
+  } else {
+    code += "return (index >= 0 && index < size) ? index : -1;\n";
+  }
+  code += "}\n"
+    + loadType + " loadInput(__global const " + dataType + " * const restrict input, const unsigned int image, const int row, const int column) {\n"
+    "const int boundaryRow = getBoundaryIndex(row, " + isa::utils::toString(height) + ");\n"
+    "const int boundaryColumn = getBoundaryIndex(column, " + isa::utils::toString(width) + ");\n";
+  if ( boundary == ZERO ) {
+    code += "if ( boundaryRow < 0 || boundaryColumn < 0 ) {\n"
+      "return 0;\n"
       "}\n";
   }
-  *code += "<%AVERAGE%>"
-    "<%STORE%>"
+  code += "return " + getConvolutionLoad("input", "(image * " + isa::utils::toString(inputImageStride) + ") + (boundaryRow * " + isa::utils::toString(inputStride) + ") + boundaryColumn", 1, dataType, loadType) + ";\n"
     "}\n";
-  std::string defSumsTemplate = dataType + " sumX<%XNUM%>Y<%YNUM%> = 0;\n";
-  std::string loadTemplate;
-  std::string sumsTemplate;
+  if ( vectorWidth > 1 ) {
+    // The columns of a vector can fall on both sides of the boundary, so they are read one by one
+    code += loadType + isa::utils::toString(vectorWidth) + " loadInputVector(__global const " + dataType + " * const restrict input, const unsigned int image, const int row, const int column) {\n"
+      + loadType + " values[" + isa::utils::toString(vectorWidth) + "];\n"
+      "for ( int item = 0; item < " + isa::utils::toString(vectorWidth) + "; item++ ) {\n"
+      "values[item] = loadInput(input, image, row, column + item);\n"
+      "}\n"
+      "return vload" + isa::utils::toString(vectorWidth) + "(0, values);\n"
+      "}\n";
+  }
+  return code;
+}
+
+std::string getConvolutionInteriorOpenCL(const ConvolutionBoundary boundary, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int tileWidth, const unsigned int tileHeight) {
+  const unsigned int size[2] = {width, height};
+  const unsigned int tile[2] = {tileWidth, tileHeight};
+  // Taps before and after the output pixel; the input of VALID contains them
+  unsigned int before[2] = {0, 0};
+  unsigned int after[2] = {0, 0};
+  if ( boundary != VALID ) {
+    before[0] = filterWidth / 2;
+    before[1] = filterHeight / 2;
+    after[0] = (filterWidth - 1) - (filterWidth / 2);
+    after[1] = (filterHeight - 1) - (filterHeight / 2);
+  }
+  std::string condition;
+
+  for ( unsigned int dimension = 0; dimension < 2; dimension++ ) {
+    const unsigned int nrGroups = (size[dimension] + tile[dimension] - 1) / tile[dimension];
+    const unsigned int first = (before[dimension] + tile[dimension] - 1) / tile[dimension];
+    const std::string group_s = "get_group_id(" + isa::utils::toString(dimension) + ")";
+
+    if ( size[dimension] < tile[dimension] + after[dimension] || first > (size[dimension] - tile[dimension] - after[dimension]) / tile[dimension] ) {
+      return "false";
+    }
+    const unsigned int last = (size[dimension] - tile[dimension] - after[dimension]) / tile[dimension];
+    if ( first > 0 ) {
+      condition += " && (" + group_s + " >= " + isa::utils::toString(first) + ")";
+    }
+    if ( last < nrGroups - 1 ) {
+      condition += " && (" + group_s + " <= " + isa::utils::toString(last) + ")";
+    }
+  }
+  if ( condition.empty() ) {
+    return "true";
+  }
+  // Without the leading " && "
+  return condition.substr(4);
+}
+
+std::string getConvolutionOpenCLSource(const ConvolutionConf & conf, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType, const std::vector< double > & coefficients) {
+  const ConvolutionBoundary boundary = conf.getBoundary();
+  const bool local = conf.getLocalMemory();
+  const bool window = conf.getWindow();
+  const unsigned int nrColumnsPerBlock = conf.getNrColumnsPerBlock();
+  const unsigned int nrRowsPerBlock = conf.getNrRowsPerBlock();
+  const unsigned int nrColumnsPerThread = conf.getNrColumnsPerThread();
+  const unsigned int nrRowsPerThread = conf.getNrRowsPerThread();
+  const unsigned int nrFiltersPerThread = conf.getNrFiltersPerThread();
+  const unsigned int vectorWidth = conf.getVectorWidth();
+  const std::string accumulatorType = conf.getAccumulatorType().empty() ? getConvolutionAccumulatorType(dataType) : conf.getAccumulatorType();
+  const bool constant = !coefficients.empty();
+  const bool integerAccumulator = accumulatorType != "float" && accumulatorType != "double";
+  if ( integerAccumulator && (dataType == "float" || dataType == "double" || dataType == "half") ) {
+    throw std::invalid_argument("Floating point data cannot be accumulated in " + accumulatorType + ".");
+  } else if ( accumulatorType == "half" ) {
+    throw std::invalid_argument("Half precision data is accumulated in float.");
+  } else if ( nrFiltersPerThread == 0 || nrFilters % nrFiltersPerThread != 0 ) {
+    throw std::invalid_argument("The filters per work-item have to divide the filter bank.");
+  } else if ( constant && nrFiltersPerThread != nrFilters ) {
+    throw std::invalid_argument("Constant coefficients need all the filters of the bank in every work-item.");
+  } else if ( constant && coefficients.size() != static_cast< size_t >(nrFilters) * filterWidth * filterHeight ) {
+    throw std::invalid_argument("The number of coefficients does not match the filter bank.");
+  } else if ( window && !local ) {
+    throw std::invalid_argument("The sliding window needs local memory.");
+  }
+  // Columns computed by a work-group, and the local index of the first column of a work-item
+  const unsigned int tileWidth = nrColumnsPerBlock * nrColumnsPerThread * vectorWidth;
+  const unsigned int tileHeight = nrRowsPerBlock * nrRowsPerThread;
+  std::string accumulatorVectorType = accumulatorType;
+  std::string localX_s = "get_local_id(0)";
+  if ( vectorWidth > 1 ) {
+    accumulatorVectorType += isa::utils::toString(vectorWidth);
+    localX_s = "(get_local_id(0) * " + isa::utils::toString(vectorWidth) + ")";
+  }
+  // Half precision is a storage format only, so the tile in local memory is converted already
+  std::string localType = dataType;
+  if ( dataType == "half" ) {
+    localType = accumulatorType;
+  }
+  // With a boundary mode the input has no border, and the first tap is left columns and top rows before the output pixel
+  const bool bounded = boundary != VALID;
+  // The last work-group of a dimension that the tile does not divide is a tail: it reads through loadInput and stores only inside the image
+  const bool tails = (width % tileWidth != 0) || (height % tileHeight != 0);
+  const unsigned int nrPaths = (bounded || tails) ? 2 : 1;
+  std::string inputStride_s = isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding));
+  std::string left_s;
+  std::string top_s;
+  if ( bounded ) {
+    inputStride_s = isa::utils::toString(isa::utils::pad(width, padding));
+    left_s = " - " + isa::utils::toString(filterWidth / 2);
+    top_s = " - " + isa::utils::toString(filterHeight / 2);
+  }
+
+  // Begin kernel's templates
+  std::string localStride_s = isa::utils::toString(tileWidth + (filterWidth - 1));
+  if ( local && nrColumnsPerBlock < padding ) {
+    localStride_s = isa::utils::toString(isa::utils::pad(tileWidth + (filterWidth - 1), padding));
+  }
+  const std::string localIndex_s = "((fY + <%YOFFSET%>) * " + localStride_s + ") + (fX + <%XOFFSET%>)";
+  // Row and column of the input element read by a tap
+  std::string row_s = "fY + <%YOFFSET%>";
+  std::string column_s = "fX + <%XOFFSET%>";
   if ( local ) {
-    if ( nrColumnsPerBlock < padding ) {
-      loadTemplate = "localInput[((fY + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1), padding)) + ") + (fX + <%XOFFSET%>)] = input[((y + fY + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding)) + ") + (x + fX + <%XOFFSET%>)];\n";
-      sumsTemplate = "sumX<%XNUM%>Y<%YNUM%> += localInput[((fY + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1), padding)) + ") + (fX + <%XOFFSET%>)] * filter[((fY - get_local_id(1)) * " + isa::utils::toString(filterWidth) + ") + (fX - get_local_id(0))];\n";
+    row_s = "y + fY + <%YOFFSET%>";
+    column_s = "x + fX + <%XOFFSET%>";
+  } else if ( constant ) {
+    row_s = "y + <%YOFFSET%>";
+    column_s = "x + <%XOFFSET%>";
+  }
+  const std::string inputIndex_s = "(image * " + isa::utils::toString(inputImageStride) + ") + ((" + row_s + top_s + ") * " + inputStride_s + ") + (" + column_s + left_s + ")";
+  const std::string boundaryArguments_s = "(input, image, (int)(" + row_s + ")" + top_s + ", (int)(" + column_s + ")" + left_s + ")";
+  // Templates of the interior, and of the work-groups touching the boundary, that read every element through loadInput
+  std::string loadTemplate[2];
+  std::string input_s[2];
+  std::string filter_s;
+  // Vectors are loaded and stored with vloadN and vstoreN, that only need the alignment of the elements
+  if ( local ) {
+    loadTemplate[0] = "localInput[" + localIndex_s + "] = " + getConvolutionLoad("input", inputIndex_s, 1, dataType, localType) + ";\n";
+    loadTemplate[1] = "localInput[" + localIndex_s + "] = loadInput" + boundaryArguments_s + ";\n";
+    input_s[0] = getConvolutionLoad("localInput", localIndex_s, vectorWidth, localType, accumulatorType);
+    input_s[1] = input_s[0];
+    filter_s = getConvolutionLoad("filter", "((filterBlock + <%FNUM%>) * " + isa::utils::toString(filterWidth * filterHeight) + ") + ((fY - get_local_id(1)) * " + isa::utils::toString(filterWidth) + ") + (fX - " + localX_s + ")", 1, dataType, accumulatorType);
+  } else {
+    input_s[0] = getConvolutionLoad("input", inputIndex_s, vectorWidth, dataType, accumulatorType);
+    if ( vectorWidth > 1 ) {
+      input_s[1] = "loadInputVector" + boundaryArguments_s;
     } else {
-      loadTemplate = "localInput[((fY + <%YOFFSET%>) * " + isa::utils::toString((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1)) + ") + (fX + <%XOFFSET%>)] = input[((y + fY + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding)) + ") + (x + fX + <%XOFFSET%>)];\n";
-      sumsTemplate = "sumX<%XNUM%>Y<%YNUM%> += localInput[((fY + <%YOFFSET%>) * " + isa::utils::toString((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1)) + ") + (fX + <%XOFFSET%>)] * filter[((fY - get_local_id(1)) * " + isa::utils::toString(filterWidth) + ") + (fX - get_local_id(0))];\n";
+      input_s[1] = "loadInput" + boundaryArguments_s;
     }
-  } else {
-    sumsTemplate =  "sumX<%XNUM%>Y<%YNUM%> += input[((fY + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding)) + ") + (fX + <%XOFFSET%>)] * filter[((fY - y) * " + isa::utils::toString(filterWidth) + ") + (fX - x)];\n";
-  }
-  std::string loadYIncTemplate = "fY += " + isa::utils::toString(nrRowsPerBlock * nrRowsPerThread) + ";\n";
-  std::string loadXIncTemplate = "fX += " + isa::utils::toString(nrColumnsPerBlock * nrColumnsPerThread) + ";\n";
-  std::string xResetTemplate = "fX = get_local_id(0);\n";
-  std::string sumYIncTemplate = "fY++;\n";
-  std::string sumXIncTemplate = "fX++;\n";
-  std::string averageTemplate = "sumX<%XNUM%>Y<%YNUM%> *= " + isa::utils::toString(1.0f / (filterWidth * filterHeight)) + "f;\n";
-  std::string storeTemplate;
+    filter_s = getConvolutionLoad("filter", "((filterBlock + <%FNUM%>) * " + isa::utils::toString(filterWidth * filterHeight) + ") + ((fY - y) * " + isa::utils::toString(filterWidth) + ") + (fX - x)", 1, dataType, accumulatorType);
+  }
+  if ( constant ) {
+    filter_s = "<%COEFFICIENT%>";
+  }
+  // The last row and column of loads into local memory are guarded
+  const unsigned int nrLoadRows = static_cast< unsigned int >(std::ceil(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) / static_cast< float >(nrRowsPerBlock * nrRowsPerThread)));
+  const unsigned int nrLoadColumns = static_cast< unsigned int >(std::ceil((tileWidth + (filterWidth - 1)) / static_cast< float >(nrColumnsPerBlock * nrColumnsPerThread)));
+  const std::string rows_s = isa::utils::toString((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1));
+  const std::string columns_s = isa::utils::toString(tileWidth + (filterWidth - 1));
+  std::vector< ConvolutionTemplate > load;
+  std::vector< ConvolutionTemplate > loadRows;
+  std::vector< ConvolutionTemplate > loadColumns;
+  std::vector< ConvolutionTemplate > loadCorner;
+  std::vector< ConvolutionTemplate > sums;
+  for ( unsigned int path = 0; path < nrPaths; path++ ) {
+    load.push_back(ConvolutionTemplate(loadTemplate[path]));
+    loadRows.push_back(ConvolutionTemplate("if ( (fY + <%YOFFSET%>) < " + rows_s + " ) {\n" + loadTemplate[path] + "}\n"));
+    loadColumns.push_back(ConvolutionTemplate("if ( (fX + <%XOFFSET%>) < " + columns_s + " ) {\n" + loadTemplate[path] + "}\n"));
+    loadCorner.push_back(ConvolutionTemplate("if ( (fY + <%YOFFSET%>) < " + rows_s + " && (fX + <%XOFFSET%>) < " + columns_s + " ) {\n" + loadTemplate[path] + "}\n"));
+    sums.push_back(ConvolutionTemplate("sumX<%XNUM%>Y<%YNUM%>F<%FNUM%> += " + input_s[path] + " * " + filter_s + ";\n"));
+  }
+  // The window holds a row of the tile, in one register for every column offset used by the accumulators of a work-item; vectors at every offset are loaded with vloadN
+  const unsigned int nrWindowRows = ((nrRowsPerThread - 1) * nrRowsPerBlock) + filterHeight;
+  std::vector< unsigned int > windowColumns;
+  std::vector< std::string > taps;
+  if ( window ) {
+    for ( unsigned int column = 0; column < ((nrColumnsPerThread - 1) * nrColumnsPerBlock * vectorWidth) + filterWidth; column++ ) {
+      for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+        if ( column >= x * nrColumnsPerBlock * vectorWidth && column - (x * nrColumnsPerBlock * vectorWidth) < filterWidth ) {
+          windowColumns.push_back(column);
+          break;
+        }
+      }
+    }
+    for ( unsigned int f = 0; f < nrFiltersPerThread; f++ ) {
+      for ( unsigned int tap = 0; tap < filterWidth * filterHeight; tap++ ) {
+        taps.push_back(getConvolutionLoad("filter", "((filterBlock + " + isa::utils::toString(f) + ") * " + isa::utils::toString(filterWidth * filterHeight) + ") + " + isa::utils::toString(tap), 1, dataType, accumulatorType));
+      }
+    }
+  }
+  const ConvolutionTemplate windowLoad("windowC<%XOFFSET%> = " + getConvolutionLoad("localInput", "((get_local_id(1) + <%YOFFSET%>) * " + localStride_s + ") + (" + localX_s + " + <%XOFFSET%>)", vectorWidth, localType, accumulatorType) + ";\n");
+  const ConvolutionTemplate windowSums("sumX<%XNUM%>Y<%YNUM%>F<%FNUM%> += windowC<%XOFFSET%> * <%COEFFICIENT%>;\n");
+  const ConvolutionTemplate defSums(accumulatorVectorType + " sumX<%XNUM%>Y<%YNUM%>F<%FNUM%> = 0;\n");
+  const std::string loadYInc_s = "fY += " + isa::utils::toString(nrRowsPerBlock * nrRowsPerThread) + ";\n";
+  const std::string loadXInc_s = "fX += " + isa::utils::toString(nrColumnsPerBlock * nrColumnsPerThread) + ";\n";
+  const std::string sumXReset_s = "fX = " + localX_s + ";\n";
+  const ConvolutionTemplate average(getConvolutionAverage("sumX<%XNUM%>Y<%YNUM%>F<%FNUM%>", filterWidth * filterHeight, vectorWidth, accumulatorType));
+  std::string outputRow_s = "y + <%YOFFSET%>";
+  std::string outputColumn_s = "x + <%XOFFSET%>";
   if ( local ) {
-    storeTemplate = "output[((y + get_local_id(1) + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width, padding)) + ") + (x + get_local_id(0) + <%XOFFSET%>)] = sumX<%XNUM%>Y<%YNUM%>;\n";
-  } else {
-    storeTemplate = "output[((y + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width, padding)) + ") + (x + <%XOFFSET%>)] = sumX<%XNUM%>Y<%YNUM%>;\n";
+    outputRow_s = "y + get_local_id(1) + <%YOFFSET%>";
+    outputColumn_s = "x + " + localX_s + " + <%XOFFSET%>";
   }
-  // End kernel's template
-
-  std::string * defSums_s = new std::string();
-  std::string * load_s = new std::string();
-  std::string * sums_s = new std::string();
-  std::string * average_s = new std::string();
-  std::string * store_s = new std::string();
-
-  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
-    std::string y_s = isa::utils::toString(y);
-    std::string yOffset_s = isa::utils::toString(y * nrRowsPerBlock);
+  const std::string outputIndex_s = "(((image * " + isa::utils::toString(nrFilters) + ") + filterBlock + <%FNUM%>) * " + isa::utils::toString(outputImageStride) + ") + ((" + outputRow_s + ") * " + isa::utils::toString(isa::utils::pad(width, padding)) + ") + (" + outputColumn_s + ")";
+  // Stores of the interior, and of the tail work-groups
+  std::vector< ConvolutionTemplate > store;
+  store.push_back(ConvolutionTemplate(getConvolutionStore("sumX<%XNUM%>Y<%YNUM%>F<%FNUM%>", "output", outputIndex_s, vectorWidth, dataType, accumulatorType)));
+  if ( tails ) {
+    store.push_back(ConvolutionTemplate(getConvolutionTailStore("sumX<%XNUM%>Y<%YNUM%>F<%FNUM%>", "output", outputIndex_s, outputRow_s, outputColumn_s, width, height, vectorWidth, dataType, accumulatorType)));
+  }
+  std::vector< std::string > literals;
+  for ( unsigned int coefficient = 0; coefficient < coefficients.size(); coefficient++ ) {
+    literals.push_back(getConvolutionLiteral(coefficients[coefficient], accumulatorType));
+  }
+  // End kernel's templates
 
-    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
-      std::string x_s = isa::utils::toString(x);
-      std::string xOffset_s = isa::utils::toString(x * nrColumnsPerBlock);
-      std::string * temp_s = 0;
-
-      temp_s = isa::utils::replace(&defSumsTemplate, "<%XNUM%>", x_s);
-      temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
-      defSums_s->append(*temp_s);
-      delete temp_s;
-      if ( !local ) {
-        temp_s = isa::utils::replace(&sumsTemplate, "<%XNUM%>", x_s);
-        temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
-        temp_s = isa::utils::replace(temp_s, "<%XOFFSET%>", xOffset_s, true);
-        temp_s = isa::utils::replace(temp_s, "<%YOFFSET%>", yOffset_s, true);
-        sums_s->append(*temp_s);
-        delete temp_s;
-      }
-      temp_s = isa::utils::replace(&averageTemplate, "<%XNUM%>", x_s);
-      temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
-      average_s->append(*temp_s);
-      delete temp_s;
-      temp_s = isa::utils::replace(&storeTemplate, "<%XNUM%>", x_s);
-      temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
-      temp_s = isa::utils::replace(temp_s, "<%XOFFSET%>", xOffset_s, true);
-      temp_s = isa::utils::replace(temp_s, "<%YOFFSET%>", yOffset_s, true);
-      store_s->append(*temp_s);
-      delete temp_s;
-    }
-  }
-  
-  for ( unsigned int j = 0; j < static_cast< unsigned int >(std::ceil(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) / static_cast< float >(nrRowsPerBlock * nrRowsPerThread))); j++ ) {
-    const unsigned int rows = (nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1);
-
-    for ( unsigned int i = 0; i < static_cast< unsigned int >(std::ceil(((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1)) / static_cast< float >(nrColumnsPerBlock * nrColumnsPerThread))); i++ ) {
-      const unsigned int columns = (nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1);
+  // The code is written once, front to back, into a buffer large enough for all of it
+  const size_t nrItems = static_cast< size_t >(nrColumnsPerThread) * nrRowsPerThread * nrFiltersPerThread;
+  // Only the input of the work-items is read through the boundary, the tile in local memory is not
+  const unsigned int nrSumPaths = local ? 1 : nrPaths;
+  size_t size = 4096 + (nrItems * (defSums.getSize() + average.getSize() + (store.size() * store.back().getSize())));
+  if ( local ) {
+    size += nrPaths * static_cast< size_t >(nrLoadRows) * nrLoadColumns * nrColumnsPerThread * nrRowsPerThread * (loadCorner[nrPaths - 1].getSize() + loadXInc_s.size() + loadYInc_s.size() + sumXReset_s.size());
+  }
+  if ( window ) {
+    size += nrWindowRows * ((windowColumns.size() * (windowLoad.getSize() + accumulatorVectorType.size() + 16)) + (nrItems * filterWidth * (windowSums.getSize() + taps.back().size())));
+  } else if ( local || constant ) {
+    size += nrSumPaths * static_cast< size_t >(filterWidth) * filterHeight * (nrItems * sums[nrSumPaths - 1].getSize() + sumXReset_s.size() + 16);
+  } else {
+    size += nrSumPaths * nrItems * sums[nrSumPaths - 1].getSize();
+  }
+  std::string code;
+  unsigned int values[ConvolutionTemplate::COEFFICIENT] = {0};
 
-      for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
-        std::string yOffset_s = isa::utils::toString(y * nrRowsPerBlock);
+  code.reserve(size);
+  if ( bounded ) {
+    code += getConvolutionBoundaryOpenCL(boundary, width, height, inputImageStride, isa::utils::pad(width, padding), vectorWidth, dataType, local ? localType : accumulatorType);
+  } else if ( tails ) {
+    code += getConvolutionBoundaryOpenCL(boundary, width + (filterWidth - 1), height + (filterHeight - 1), inputImageStride, isa::utils::pad(width + (filterWidth - 1), padding), vectorWidth, dataType, local ? localType : accumulatorType);
+  }
+  // A bank of filters can exceed the 64 KB guaranteed for __constant memory
+  if ( nrFilters > 1 ) {
+    code += "__kernel void convolution(__global const " + dataType + " * const restrict input, __global " + dataType + " * const restrict output, __global const " + dataType + " * const restrict filter) {\n";
+  } else {
+    code += "__kernel void convolution(__global const " + dataType + " * const restrict input, __global " + dataType + " * const restrict output, __constant const " + dataType + " * const restrict filter) {\n";
+  }
+  code += "const unsigned int image = get_group_id(2);\n";
+  if ( local ) {
+    code += "const unsigned int x = (get_group_id(0) * " + isa::utils::toString(tileWidth) + ");\n"
+      "const unsigned int y = (get_group_id(1) * " + isa::utils::toString(nrRowsPerBlock * nrRowsPerThread) + ");\n"
+      "unsigned int fX = 0;\n"
+      "unsigned int fY = 0;\n";
+    if ( nrColumnsPerBlock < padding ) {
+      code += "__local " + localType + " localInput[" + isa::utils::toString(isa::utils::pad(tileWidth + (filterWidth - 1), padding) * ((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1))) + "];\n";
+    } else {
+      code += "__local " + localType + " localInput[" + isa::utils::toString((tileWidth + (filterWidth - 1)) * ((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1))) + "];\n";
+    }
+  } else {
+    code += "const unsigned int x = (get_group_id(0) * " + isa::utils::toString(tileWidth) + ") + " + localX_s + ";\n"
+      "const unsigned int y = (get_group_id(1) * " + isa::utils::toString(nrRowsPerBlock * nrRowsPerThread) + ") + get_local_id(1);\n";
+  }
+  if ( nrPaths > 1 ) {
+    // The same for the whole work-group, so the work-items never diverge
+    code += "const bool interior = " + getConvolutionInteriorOpenCL(boundary, width, height, filterWidth, filterHeight, tileWidth, tileHeight) + ";\n";
+  }
+  if ( local ) {
+    for ( unsigned int path = 0; path < nrPaths; path++ ) {
+      if ( nrPaths > 1 ) {
+        code += (path == 0) ? "if ( interior ) {\n" : "} else {\n";
+      }
+      code += "fY = get_local_id(1);\n"
+        "fX = get_local_id(0);\n";
+      for ( unsigned int j = 0; j < nrLoadRows; j++ ) {
+        for ( unsigned int i = 0; i < nrLoadColumns; i++ ) {
+          const ConvolutionTemplate * piece = &(load[path]);
 
-        for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
-          std::string xOffset_s = isa::utils::toString(x * nrColumnsPerBlock);
-          std::string * temp_s = new std::string();
-
-          if ( (j == static_cast< unsigned int >(std::ceil(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) / static_cast< float >(nrRowsPerBlock * nrRowsPerThread))) - 1) && (i == static_cast< unsigned int >(std::ceil(((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1)) / static_cast< float >(nrColumnsPerBlock * nrColumnsPerThread))) - 1) ){
-            temp_s->append("if ( (fY + <%YOFFSET%>) < " + isa::utils::toString(rows) + " && (fX + <%XOFFSET%>) < " + isa::utils::toString(columns) + " ) {\n" + loadTemplate + "}\n");
-          } else if ( j == static_cast< unsigned int >(std::ceil(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) / static_cast< float >(nrRowsPerBlock * nrRowsPerThread))) - 1 ) {
-            temp_s->append("if ( (fY + <%YOFFSET%>) < " + isa::utils::toString(rows) + " ) {\n" + loadTemplate + "}\n");
-          } else if ( i == static_cast< unsigned int >(std::ceil(((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1)) / static_cast< float >(nrColumnsPerBlock * nrColumnsPerThread))) - 1 ) {
-            temp_s->append("if ( (fX + <%XOFFSET%>) < " + isa::utils::toString(columns) + " ) {\n" + loadTemplate + "}\n");
-          } else {
-            temp_s->append(loadTemplate);
+          if ( j == nrLoadRows - 1 && i == nrLoadColumns - 1 ) {
+            piece = &(loadCorner[path]);
+          } else if ( j == nrLoadRows - 1 ) {
+            piece = &(loadRows[path]);
+          } else if ( i == nrLoadColumns - 1 ) {
+            piece = &(loadColumns[path]);
+          }
+          for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+            values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+            for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+              values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock;
+              piece->append(code, values);
+            }
+          }
+          if ( i != nrLoadColumns - 1 ) {
+            code += loadXInc_s;
           }
-          temp_s = isa::utils::replace(temp_s, "<%XOFFSET%>", xOffset_s, true);
-          temp_s = isa::utils::replace(temp_s, "<%YOFFSET%>", yOffset_s, true);
-          load_s->append(*temp_s);
-          delete temp_s;
+        }
+        if ( j != nrLoadRows - 1 ) {
+          code += loadYInc_s;
+          code += "fX = get_local_id(0);\n";
         }
       }
-      if ( i != static_cast< unsigned int >(std::ceil(((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1)) / static_cast< float >(nrColumnsPerBlock * nrColumnsPerThread))) - 1 ) {
-        load_s->append(loadXIncTemplate);
-      }
     }
-    if ( j != static_cast< unsigned int >(std::ceil(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) / static_cast< float >(nrRowsPerBlock * nrRowsPerThread))) - 1 ) {
-      load_s->append(loadYIncTemplate);
-      load_s->append(xResetTemplate);
+    if ( nrPaths > 1 ) {
+      code += "}\n";
+    }
+    code += "barrier(CLK_LOCAL_MEM_FENCE);\n";
+  }
+  // The input is reused by all the filters of the bank, nrFiltersPerThread at a time
+  if ( nrFilters > nrFiltersPerThread ) {
+    code += "for ( unsigned int filterBlock = 0; filterBlock < " + isa::utils::toString(nrFilters) + "; filterBlock += " + isa::utils::toString(nrFiltersPerThread) + " ) {\n";
+  } else {
+    code += "{\n"
+      "const unsigned int filterBlock = 0;\n";
+  }
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      for ( unsigned int f = 0; f < nrFiltersPerThread; f++ ) {
+        values[ConvolutionTemplate::FNUM] = f;
+        defSums.append(code, values);
+      }
     }
   }
+  for ( unsigned int path = 0; path < nrSumPaths; path++ ) {
+    if ( nrSumPaths > 1 ) {
+      code += (path == 0) ? "if ( interior ) {\n" : "} else {\n";
+    }
+    if ( window ) {
+      const std::vector< std::string > & coefficients_s = constant ? literals : taps;
 
-  if ( local ) {
-    for ( unsigned int j = 0; j < filterHeight; j++ ) {
-      for ( unsigned int i = 0; i < filterWidth; i++ ) {
+      for ( unsigned int column = 0; column < windowColumns.size(); column++ ) {
+        code += accumulatorVectorType + " windowC" + isa::utils::toString(windowColumns[column]) + ";\n";
+      }
+      // The window moves down one row at a time; the taps of every accumulator are still added in the order of the filter
+      for ( unsigned int row = 0; row < nrWindowRows; row++ ) {
+        // Rows between accumulators further apart than the filter height are not used by any of them, and are not loaded
+        if ( row - (std::min(row / nrRowsPerBlock, nrRowsPerThread - 1) * nrRowsPerBlock) >= filterHeight ) {
+          continue;
+        }
+        values[ConvolutionTemplate::YOFFSET] = row;
+        for ( unsigned int column = 0; column < windowColumns.size(); column++ ) {
+          values[ConvolutionTemplate::XOFFSET] = windowColumns[column];
+          windowLoad.append(code, values);
+        }
         for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
-          std::string y_s = isa::utils::toString(y);
-          std::string yOffset_s = isa::utils::toString(y * nrRowsPerBlock);
-
+          if ( row < y * nrRowsPerBlock || row - (y * nrRowsPerBlock) >= filterHeight ) {
+            continue;
+          }
+          values[ConvolutionTemplate::YNUM] = y;
           for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
-            std::string x_s = isa::utils::toString(x);
-            std::string xOffset_s = isa::utils::toString(x * nrColumnsPerBlock);
-            std::string * temp_s = 0;
-
-            temp_s = isa::utils::replace(&sumsTemplate, "<%XNUM%>", x_s);
-            temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
-            temp_s = isa::utils::replace(temp_s, "<%XOFFSET%>", xOffset_s, true);
-            temp_s = isa::utils::replace(temp_s, "<%YOFFSET%>", yOffset_s, true);
-            sums_s->append(*temp_s);
-            delete temp_s;
+            values[ConvolutionTemplate::XNUM] = x;
+            for ( unsigned int i = 0; i < filterWidth; i++ ) {
+              values[ConvolutionTemplate::XOFFSET] = (x * nrColumnsPerBlock * vectorWidth) + i;
+              for ( unsigned int f = 0; f < nrFiltersPerThread; f++ ) {
+                const unsigned int tap = (((f * filterHeight) + (row - (y * nrRowsPerBlock))) * filterWidth) + i;
+
+                values[ConvolutionTemplate::FNUM] = f;
+                if ( !constant || coefficients[tap] != 0 ) {
+                  windowSums.append(code, values, coefficients_s[tap]);
+                }
+              }
+            }
+          }
+        }
+      }
+    } else if ( local || constant ) {
+      // With constant coefficients every tap has its own offsets, instead of moving fX and fY
+      if ( local ) {
+        code += "fY = get_local_id(1);\n";
+        code += sumXReset_s;
+      }
+      for ( unsigned int j = 0; j < filterHeight; j++ ) {
+        for ( unsigned int i = 0; i < filterWidth; i++ ) {
+          for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+            values[ConvolutionTemplate::YNUM] = y;
+            values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+            if ( constant ) {
+              values[ConvolutionTemplate::YOFFSET] += j;
+            }
+            for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+              values[ConvolutionTemplate::XNUM] = x;
+              values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock * vectorWidth;
+              if ( constant ) {
+                values[ConvolutionTemplate::XOFFSET] += i;
+              }
+              for ( unsigned int f = 0; f < nrFiltersPerThread; f++ ) {
+                const unsigned int tap = (((f * filterHeight) + j) * filterWidth) + i;
+
+                values[ConvolutionTemplate::FNUM] = f;
+                if ( !constant ) {
+                  sums[path].append(code, values);
+                } else if ( coefficients[tap] != 0 ) {
+                  sums[path].append(code, values, literals[tap]);
+                }
+              }
+            }
+          }
+          if ( !constant && i != filterWidth - 1 ) {
+            code += "fX++;\n";
           }
         }
-        if ( i != filterWidth - 1 ) {
-          sums_s->append(sumXIncTemplate);
+        if ( !constant && j != filterHeight - 1 ) {
+          code += "fY++;\n";
+          code += sumXReset_s;
         }
       }
-      if ( j != filterHeight - 1 ) {
-        sums_s->append(sumYIncTemplate);
-        sums_s->append(xResetTemplate);
+    } else {
+      code += "for ( unsigned int fY = y; fY < y + " + isa::utils::toString(filterHeight) + "; fY++ ) {\n"
+        "for ( unsigned int fX = x; fX < x + " + isa::utils::toString(filterWidth) + "; fX++ ) {\n";
+      for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+        values[ConvolutionTemplate::YNUM] = y;
+        values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+        for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+          values[ConvolutionTemplate::XNUM] = x;
+          values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock * vectorWidth;
+          for ( unsigned int f = 0; f < nrFiltersPerThread; f++ ) {
+            values[ConvolutionTemplate::FNUM] = f;
+            sums[path].append(code, values);
+          }
+        }
       }
+      code += "}\n"
+        "}\n";
     }
   }
-
-  code = isa::utils::replace(code, "<%DEF_SUMS%>", *defSums_s, true);
-  code = isa::utils::replace(code, "<%LOAD%>", *load_s, true);
-  code = isa::utils::replace(code, "<%SUMS%>", *sums_s, true);
-  code = isa::utils::replace(code, "<%AVERAGE%>", *average_s, true);
-  code = isa::utils::replace(code, "<%STORE%>", *store_s, true);
-  delete defSums_s;
-  delete load_s;
-  delete sums_s;
-  delete average_s;
-  delete store_s;
+  if ( nrSumPaths > 1 ) {
+    code += "}\n";
+  }
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      for ( unsigned int f = 0; f < nrFiltersPerThread; f++ ) {
+        values[ConvolutionTemplate::FNUM] = f;
+        average.append(code, values);
+      }
+    }
+  }
+  for ( unsigned int path = 0; path < store.size(); path++ ) {
+    if ( store.size() > 1 ) {
+      code += (path == 0) ? "if ( interior ) {\n" : "} else {\n";
+    }
+    for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+      values[ConvolutionTemplate::YNUM] = y;
+      values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+      for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+        values[ConvolutionTemplate::XNUM] = x;
+        values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock * vectorWidth;
+        for ( unsigned int f = 0; f < nrFiltersPerThread; f++ ) {
+          values[ConvolutionTemplate::FNUM] = f;
+          store[path].append(code, values);
+        }
+      }
+    }
+  }
+  if ( store.size() > 1 ) {
+    code += "}\n";
+  }
+  code += "}\n"
+    "}\n";
 
   return code;
 }
@@ -0,0 +1,290 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define CONVOLUTION_X86
+#endif
+
+#include <utils.hpp>
+#include <Convolution.hpp>
+
+
+#ifndef CONVOLUTION_SIMD_HPP
+#define CONVOLUTION_SIMD_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Instruction sets of the vectorized CPU algorithm
+enum ConvolutionISA { SCALAR = 0, SSE42, AVX2, AVX512 };
+
+// Widest instruction set supported by both the CPU and the operating system
+ConvolutionISA getConvolutionISA();
+std::string toString(const ConvolutionISA isa);
+// Vectorized, parallel convolution algorithm (float and double, other types use the scalar code)
+template< typename T > void convolutionSIMD(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+template< typename T > void convolutionSIMD(const ConvolutionISA isa, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+
+// Implementations
+ConvolutionISA getConvolutionISA() {
+#ifdef CONVOLUTION_X86
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  unsigned int xcr0 = 0;
+  ConvolutionISA isa = SCALAR;
+
+  if ( !__get_cpuid(1, &eax, &ebx, &ecx, &edx) ) {
+    return isa;
+  }
+  if ( ecx & bit_SSE4_2 ) {
+    isa = SSE42;
+  }
+  // AVX state must be enabled by the operating system
+  if ( !(ecx & bit_OSXSAVE) || !(ecx & bit_AVX) || !(ecx & bit_FMA) ) {
+    return isa;
+  }
+  __asm__ ("xgetbv" : "=a" (xcr0), "=d" (edx) : "c" (0));
+  if ( (xcr0 & 0x06) != 0x06 || __get_cpuid_max(0, 0) < 7 ) {
+    return isa;
+  }
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  if ( ebx & bit_AVX2 ) {
+    isa = AVX2;
+  } else {
+    return isa;
+  }
+  if ( (ebx & bit_AVX512F) && (xcr0 & 0xE6) == 0xE6 ) {
+    isa = AVX512;
+  }
+  return isa;
+#else
+  return SCALAR;
+#endif
+}
+
+std::string toString(const ConvolutionISA isa) {
+  switch ( isa ) {
+    case SSE42:
+      return "SSE4.2";
+    case AVX2:
+      return "AVX2";
+    case AVX512:
+      return "AVX-512";
+    default:
+      return "scalar";
+  }
+}
+
+// Scalar code for the columns [first, last) of one output row
+template< typename T > void convolutionRowScalar(const T * input, const unsigned int inputStride, T * output, const unsigned int first, const unsigned int last, const unsigned int filterWidth, const unsigned int filterHeight, const T * filter) {
+  for ( unsigned int x = first; x < last; x++ ) {
+    typename ConvolutionAccumulator< T >::type sum = 0;
+
+    for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+      for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+        sum += input[(fY * inputStride) + x + fX] * filter[(fY * filterWidth) + fX];
+      }
+    }
+    output[x] = convolutionAverage< T >(sum, filterWidth * filterHeight);
+  }
+}
+
+#ifdef CONVOLUTION_X86
+// Vector types; SSE4.2 has no FMA, so fma is a multiply followed by an add
+template< typename T > struct SSE42Vector;
+template< > struct SSE42Vector< float > {
+  typedef __m128 type;
+  static const unsigned int width = 4;
+  static inline __attribute__((target("sse4.2"))) type zero() { return _mm_setzero_ps(); }
+  static inline __attribute__((target("sse4.2"))) type broadcast(const float value) { return _mm_set1_ps(value); }
+  static inline __attribute__((target("sse4.2"))) type load(const float * pointer) { return _mm_loadu_ps(pointer); }
+  static inline __attribute__((target("sse4.2"))) void store(float * pointer, const type value) { _mm_storeu_ps(pointer, value); }
+  static inline __attribute__((target("sse4.2"))) type fma(const type a, const type b, const type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+  static inline __attribute__((target("sse4.2"))) type divide(const type a, const type b) { return _mm_div_ps(a, b); }
+};
+template< > struct SSE42Vector< double > {
+  typedef __m128d type;
+  static const unsigned int width = 2;
+  static inline __attribute__((target("sse4.2"))) type zero() { return _mm_setzero_pd(); }
+  static inline __attribute__((target("sse4.2"))) type broadcast(const double value) { return _mm_set1_pd(value); }
+  static inline __attribute__((target("sse4.2"))) type load(const double * pointer) { return _mm_loadu_pd(pointer); }
+  static inline __attribute__((target("sse4.2"))) void store(double * pointer, const type value) { _mm_storeu_pd(pointer, value); }
+  static inline __attribute__((target("sse4.2"))) type fma(const type a, const type b, const type c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+  static inline __attribute__((target("sse4.2"))) type divide(const type a, const type b) { return _mm_div_pd(a, b); }
+};
+template< typename T > struct AVX2Vector;
+template< > struct AVX2Vector< float > {
+  typedef __m256 type;
+  static const unsigned int width = 8;
+  static inline __attribute__((target("avx2,fma"))) type zero() { return _mm256_setzero_ps(); }
+  static inline __attribute__((target("avx2,fma"))) type broadcast(const float value) { return _mm256_set1_ps(value); }
+  static inline __attribute__((target("avx2,fma"))) type load(const float * pointer) { return _mm256_loadu_ps(pointer); }
+  static inline __attribute__((target("avx2,fma"))) void store(float * pointer, const type value) { _mm256_storeu_ps(pointer, value); }
+  static inline __attribute__((target("avx2,fma"))) type fma(const type a, const type b, const type c) { return _mm256_fmadd_ps(a, b, c); }
+  static inline __attribute__((target("avx2,fma"))) type divide(const type a, const type b) { return _mm256_div_ps(a, b); }
+};
+template< > struct AVX2Vector< double > {
+  typedef __m256d type;
+  static const unsigned int width = 4;
+  static inline __attribute__((target("avx2,fma"))) type zero() { return _mm256_setzero_pd(); }
+  static inline __attribute__((target("avx2,fma"))) type broadcast(const double value) { return _mm256_set1_pd(value); }
+  static inline __attribute__((target("avx2,fma"))) type load(const double * pointer) { return _mm256_loadu_pd(pointer); }
+  static inline __attribute__((target("avx2,fma"))) void store(double * pointer, const type value) { _mm256_storeu_pd(pointer, value); }
+  static inline __attribute__((target("avx2,fma"))) type fma(const type a, const type b, const type c) { return _mm256_fmadd_pd(a, b, c); }
+  static inline __attribute__((target("avx2,fma"))) type divide(const type a, const type b) { return _mm256_div_pd(a, b); }
+};
+template< typename T > struct AVX512Vector;
+template< > struct AVX512Vector< float > {
+  typedef __m512 type;
+  static const unsigned int width = 16;
+  static inline __attribute__((target("avx512f"))) type zero() { return _mm512_setzero_ps(); }
+  static inline __attribute__((target("avx512f"))) type broadcast(const float value) { return _mm512_set1_ps(value); }
+  static inline __attribute__((target("avx512f"))) type load(const float * pointer) { return _mm512_loadu_ps(pointer); }
+  static inline __attribute__((target("avx512f"))) void store(float * pointer, const type value) { _mm512_storeu_ps(pointer, value); }
+  static inline __attribute__((target("avx512f"))) type fma(const type a, const type b, const type c) { return _mm512_fmadd_ps(a, b, c); }
+  static inline __attribute__((target("avx512f"))) type divide(const type a, const type b) { return _mm512_div_ps(a, b); }
+};
+template< > struct AVX512Vector< double > {
+  typedef __m512d type;
+  static const unsigned int width = 8;
+  static inline __attribute__((target("avx512f"))) type zero() { return _mm512_setzero_pd(); }
+  static inline __attribute__((target("avx512f"))) type broadcast(const double value) { return _mm512_set1_pd(value); }
+  static inline __attribute__((target("avx512f"))) type load(const double * pointer) { return _mm512_loadu_pd(pointer); }
+  static inline __attribute__((target("avx512f"))) void store(double * pointer, const type value) { _mm512_storeu_pd(pointer, value); }
+  static inline __attribute__((target("avx512f"))) type fma(const type a, const type b, const type c) { return _mm512_fmadd_pd(a, b, c); }
+  static inline __attribute__((target("avx512f"))) type divide(const type a, const type b) { return _mm512_div_pd(a, b); }
+};
+
+// One output row: four vectors of columns are kept in registers while every filter tap is broadcast over them.
+// The target attribute cannot depend on a template parameter, so the row code is stamped out once per instruction set.
+#define CONVOLUTION_ROW_SIMD(NAME, VECTOR, TARGET) \
+template< typename T > __attribute__((target(TARGET))) void NAME(const T * input, const unsigned int inputStride, T * output, const unsigned int width, const unsigned int filterWidth, const unsigned int filterHeight, const T * filter) { \
+  typedef VECTOR< T > V; \
+  const typename V::type divisor = V::broadcast(static_cast< T >(filterWidth * filterHeight)); \
+  unsigned int x = 0; \
+\
+  for ( ; x + (4 * V::width) <= width; x += 4 * V::width ) { \
+    typename V::type sum0 = V::zero(), sum1 = V::zero(), sum2 = V::zero(), sum3 = V::zero(); \
+\
+    for ( unsigned int fY = 0; fY < filterHeight; fY++ ) { \
+      const T * inputRow = input + (fY * inputStride) + x; \
+\
+      for ( unsigned int fX = 0; fX < filterWidth; fX++ ) { \
+        const typename V::type tap = V::broadcast(filter[(fY * filterWidth) + fX]); \
+\
+        sum0 = V::fma(V::load(inputRow + fX), tap, sum0); \
+        sum1 = V::fma(V::load(inputRow + fX + V::width), tap, sum1); \
+        sum2 = V::fma(V::load(inputRow + fX + (2 * V::width)), tap, sum2); \
+        sum3 = V::fma(V::load(inputRow + fX + (3 * V::width)), tap, sum3); \
+      } \
+    } \
+    V::store(output + x, V::divide(sum0, divisor)); \
+    V::store(output + x + V::width, V::divide(sum1, divisor)); \
+    V::store(output + x + (2 * V::width), V::divide(sum2, divisor)); \
+    V::store(output + x + (3 * V::width), V::divide(sum3, divisor)); \
+  } \
+  for ( ; x + V::width <= width; x += V::width ) { \
+    typename V::type sum = V::zero(); \
+\
+    for ( unsigned int fY = 0; fY < filterHeight; fY++ ) { \
+      const T * inputRow = input + (fY * inputStride) + x; \
+\
+      for ( unsigned int fX = 0; fX < filterWidth; fX++ ) { \
+        sum = V::fma(V::load(inputRow + fX), V::broadcast(filter[(fY * filterWidth) + fX]), sum); \
+      } \
+    } \
+    V::store(output + x, V::divide(sum, divisor)); \
+  } \
+  convolutionRowScalar(input, inputStride, output, x, width, filterWidth, filterHeight, filter); \
+}
+
+CONVOLUTION_ROW_SIMD(convolutionRowSSE42, SSE42Vector, "sse4.2")
+CONVOLUTION_ROW_SIMD(convolutionRowAVX2, AVX2Vector, "avx2,fma")
+CONVOLUTION_ROW_SIMD(convolutionRowAVX512, AVX512Vector, "avx512f")
+#undef CONVOLUTION_ROW_SIMD
+#endif // CONVOLUTION_X86
+
+// Row dispatch: vector code exists only for float and double
+template< typename T > inline void convolutionRowSIMD(const ConvolutionISA isa, const T * input, const unsigned int inputStride, T * output, const unsigned int width, const unsigned int filterWidth, const unsigned int filterHeight, const T * filter) {
+  convolutionRowScalar(input, inputStride, output, 0, width, filterWidth, filterHeight, filter);
+}
+
+#ifdef CONVOLUTION_X86
+inline void convolutionRowSIMD(const ConvolutionISA isa, const float * input, const unsigned int inputStride, float * output, const unsigned int width, const unsigned int filterWidth, const unsigned int filterHeight, const float * filter) {
+  switch ( isa ) {
+    case AVX512:
+      convolutionRowAVX512(input, inputStride, output, width, filterWidth, filterHeight, filter);
+      break;
+    case AVX2:
+      convolutionRowAVX2(input, inputStride, output, width, filterWidth, filterHeight, filter);
+      break;
+    case SSE42:
+      convolutionRowSSE42(input, inputStride, output, width, filterWidth, filterHeight, filter);
+      break;
+    default:
+      convolutionRowScalar(input, inputStride, output, 0, width, filterWidth, filterHeight, filter);
+  }
+}
+
+inline void convolutionRowSIMD(const ConvolutionISA isa, const double * input, const unsigned int inputStride, double * output, const unsigned int width, const unsigned int filterWidth, const unsigned int filterHeight, const double * filter) {
+  switch ( isa ) {
+    case AVX512:
+      convolutionRowAVX512(input, inputStride, output, width, filterWidth, filterHeight, filter);
+      break;
+    case AVX2:
+      convolutionRowAVX2(input, inputStride, output, width, filterWidth, filterHeight, filter);
+      break;
+    case SSE42:
+      convolutionRowSSE42(input, inputStride, output, width, filterWidth, filterHeight, filter);
+      break;
+    default:
+      convolutionRowScalar(input, inputStride, output, 0, width, filterWidth, filterHeight, filter);
+  }
+}
+#endif // CONVOLUTION_X86
+
+template< typename T > void convolutionSIMD(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  convolutionSIMD(getConvolutionISA(), padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+}
+
+template< typename T > void convolutionSIMD(const ConvolutionISA isa, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  const unsigned int inputStride = isa::utils::pad(width + (filterWidth - 1), padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+  const unsigned int nrTileColumns = (width + nrColumnsPerTile - 1) / nrColumnsPerTile;
+  const unsigned int nrTileRows = (height + nrRowsPerTile - 1) / nrRowsPerTile;
+  const int nrTiles = nrTileColumns * nrTileRows;
+
+  #pragma omp parallel for schedule(dynamic)
+  for ( int tile = 0; tile < nrTiles; tile++ ) {
+    const unsigned int tileX = (tile % nrTileColumns) * nrColumnsPerTile;
+    const unsigned int tileY = (tile / nrTileColumns) * nrRowsPerTile;
+    const unsigned int tileWidth = std::min(nrColumnsPerTile, width - tileX);
+    const unsigned int tileHeight = std::min(nrRowsPerTile, height - tileY);
+
+    for ( unsigned int y = tileY; y < tileY + tileHeight; y++ ) {
+      convolutionRowSIMD(isa, &(input[(y * inputStride) + tileX]), inputStride, &(output[(y * outputStride) + tileX]), tileWidth, filterWidth, filterHeight, filter.data());
+    }
+  }
+}
+
+} // OpenCL
+} // isa
+
+#endif // CONVOLUTION_SIMD_HPP
+
@@ -0,0 +1,243 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include <InitializeOpenCL.hpp>
+#include <Kernel.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+#include <Convolution.hpp>
+#include <Profiling.hpp>
+
+
+#ifndef CONVOLVER_HPP
+#define CONVOLVER_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Convolution of frames with a fixed geometry and filter: the context, the kernel, and the device buffers are created once.
+// Every frame in flight owns a pair of device buffers from a pool; uploads, kernels, and downloads run on three queues, so consecutive frames overlap.
+// With profile the queues have profiling enabled, and the commands of every completed frame are added to a profiler. The images are padded, so the boundary of conf has to be VALID.
+template< typename T > class Convolver {
+public:
+  Convolver(const unsigned int clPlatformID, const unsigned int clDeviceID, const ConvolutionConf & conf, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::string & dataType, const unsigned int maxInFlight, const bool profile);
+  // Waits for the frames in flight
+  ~Convolver();
+  // Convolve a padded image into a padded output image; both must stay valid until the future is ready.
+  // Blocks while maxInFlight frames are in flight; meant to be called by one thread only.
+  std::future< void > submit(const std::vector< T > & input, std::vector< T > & output);
+  // Host time spent in submit, including the wait for a free pair of buffers
+  inline const isa::utils::Timer & getSubmitTimer() const;
+  inline unsigned int getMaxInFlight() const;
+  // Device times of the frames completed so far
+  ConvolutionProfiler getProfiler();
+
+private:
+  struct Slot {
+    Convolver< T > * owner;
+    cl::Buffer input_d;
+    cl::Buffer output_d;
+    std::vector< cl::Event > upload;
+    std::vector< cl::Event > computation;
+    cl::Event download;
+    std::promise< void > promise;
+  };
+
+  static void CL_CALLBACK complete(cl_event event, cl_int status, void * data);
+  void release(Slot * slot);
+  void record(Slot * slot);
+
+  unsigned int inputSize;
+  unsigned int outputSize;
+  cl::Context * clContext;
+  std::vector< cl::Platform > * clPlatforms;
+  std::vector< cl::Device > * clDevices;
+  std::vector< std::vector< cl::CommandQueue > > * clQueues;
+  std::vector< cl::CommandQueue > * queues;
+  cl::Kernel * kernel;
+  cl::Buffer filter_d;
+  cl::NDRange global;
+  cl::NDRange local;
+  std::vector< Slot * > slots;
+  std::vector< Slot * > freeSlots;
+  std::mutex lock;
+  std::condition_variable available;
+  isa::utils::Timer submitTimer;
+  bool profile;
+  ConvolutionProfiler profiler;
+};
+
+// Implementations
+template< typename T > Convolver< T >::Convolver(const unsigned int clPlatformID, const unsigned int clDeviceID, const ConvolutionConf & conf, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::string & dataType, const unsigned int maxInFlight, const bool profile) : inputSize(getInputImageSize(padding, width, height, filterWidth, filterHeight)), outputSize(getOutputImageSize(padding, width, height)), kernel(0), global(getConvolutionGlobalColumns(conf, width), getConvolutionGlobalRows(conf, height), 1), local(conf.getNrColumnsPerBlock(), conf.getNrRowsPerBlock(), 1), profile(profile) {
+  if ( maxInFlight == 0 ) {
+    throw std::invalid_argument("At least one frame must be in flight.");
+  } else if ( conf.getBoundary() != VALID ) {
+    throw std::invalid_argument("Padded images need the VALID boundary mode.");
+  }
+  clContext = new cl::Context();
+  clPlatforms = new std::vector< cl::Platform >();
+  clDevices = new std::vector< cl::Device >();
+  clQueues = new std::vector< std::vector< cl::CommandQueue > >();
+  initializeOpenCL(clPlatformID, 3, clPlatforms, clContext, clDevices, clQueues);
+  queues = &(clQueues->at(clDeviceID));
+  if ( profile ) {
+    for ( unsigned int queue = 0; queue < queues->size(); queue++ ) {
+      queues->at(queue) = getProfilingQueue(*clContext, clDevices->at(clDeviceID));
+    }
+  }
+
+  std::string code = getConvolutionOpenCLSource(conf, padding, width, height, filterWidth, filterHeight, 1, inputSize, outputSize, dataType);
+  kernel = compile("convolution", code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+  try {
+    filter_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, filter.size() * sizeof(T), 0, 0);
+    queues->at(0).enqueueWriteBuffer(filter_d, CL_TRUE, 0, filter.size() * sizeof(T), reinterpret_cast< const void * >(filter.data()));
+    kernel->setArg(2, filter_d);
+    for ( unsigned int slot = 0; slot < maxInFlight; slot++ ) {
+      Slot * item = new Slot();
+
+      item->owner = this;
+      item->input_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, inputSize * sizeof(T), 0, 0);
+      item->output_d = cl::Buffer(*clContext, CL_MEM_WRITE_ONLY, outputSize * sizeof(T), 0, 0);
+      item->upload.resize(1);
+      item->computation.resize(1);
+      slots.push_back(item);
+    }
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error allocating memory: " + isa::utils::toString(err.err()) + ".");
+  }
+  freeSlots = slots;
+}
+
+template< typename T > Convolver< T >::~Convolver() {
+  std::unique_lock< std::mutex > guard(lock);
+
+  while ( freeSlots.size() < slots.size() ) {
+    available.wait(guard);
+  }
+  guard.unlock();
+  for ( unsigned int slot = 0; slot < slots.size(); slot++ ) {
+    delete slots[slot];
+  }
+  delete kernel;
+  delete clQueues;
+  delete clDevices;
+  delete clPlatforms;
+  delete clContext;
+}
+
+template< typename T > std::future< void > Convolver< T >::submit(const std::vector< T > & input, std::vector< T > & output) {
+  Slot * slot = 0;
+  std::future< void > result;
+
+  if ( input.size() < inputSize || output.size() < outputSize ) {
+    throw std::invalid_argument("The frame is smaller than the geometry of the convolver.");
+  }
+  submitTimer.start();
+  {
+    std::unique_lock< std::mutex > guard(lock);
+
+    while ( freeSlots.empty() ) {
+      available.wait(guard);
+    }
+    slot = freeSlots.back();
+    freeSlots.pop_back();
+  }
+  // The shared state of the future is the only allocation of a call
+  slot->promise = std::promise< void >();
+  result = slot->promise.get_future();
+  try {
+    queues->at(0).enqueueWriteBuffer(slot->input_d, CL_FALSE, 0, inputSize * sizeof(T), reinterpret_cast< const void * >(input.data()), 0, &(slot->upload[0]));
+    kernel->setArg(0, slot->input_d);
+    kernel->setArg(1, slot->output_d);
+    queues->at(1).enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, &(slot->upload), &(slot->computation[0]));
+    queues->at(2).enqueueReadBuffer(slot->output_d, CL_FALSE, 0, outputSize * sizeof(T), reinterpret_cast< void * >(output.data()), &(slot->computation), &(slot->download));
+    slot->download.setCallback(CL_COMPLETE, &Convolver< T >::complete, reinterpret_cast< void * >(slot));
+    queues->at(0).flush();
+    queues->at(1).flush();
+    queues->at(2).flush();
+  } catch ( cl::Error & err ) {
+    release(slot);
+    submitTimer.stop();
+    throw std::runtime_error("OpenCL error submitting a frame: " + isa::utils::toString(err.err()) + ".");
+  }
+  submitTimer.stop();
+  return result;
+}
+
+template< typename T > inline const isa::utils::Timer & Convolver< T >::getSubmitTimer() const {
+  return submitTimer;
+}
+
+template< typename T > inline unsigned int Convolver< T >::getMaxInFlight() const {
+  return slots.size();
+}
+
+template< typename T > ConvolutionProfiler Convolver< T >::getProfiler() {
+  std::lock_guard< std::mutex > guard(lock);
+
+  return profiler;
+}
+
+template< typename T > void CL_CALLBACK Convolver< T >::complete(cl_event event, cl_int status, void * data) {
+  Slot * slot = reinterpret_cast< Slot * >(data);
+  // The slot can be reused as soon as it is released, so the promise is taken out of it first
+  std::promise< void > promise(std::move(slot->promise));
+  std::exception_ptr error;
+
+  if ( status < 0 ) {
+    error = std::make_exception_ptr(std::runtime_error("OpenCL error executing a frame: " + isa::utils::toString(status) + "."));
+  } else if ( slot->owner->profile ) {
+    try {
+      slot->owner->record(slot);
+    } catch ( std::runtime_error & err ) {
+      error = std::current_exception();
+    }
+  }
+  slot->owner->release(slot);
+  if ( error ) {
+    promise.set_exception(error);
+  } else {
+    promise.set_value();
+  }
+}
+
+template< typename T > void Convolver< T >::release(Slot * slot) {
+  std::lock_guard< std::mutex > guard(lock);
+
+  freeSlots.push_back(slot);
+  available.notify_one();
+}
+
+template< typename T > void Convolver< T >::record(Slot * slot) {
+  std::lock_guard< std::mutex > guard(lock);
+
+  profiler.record(UPLOAD, slot->upload[0]);
+  profiler.record(COMPUTE, slot->computation[0]);
+  profiler.record(DOWNLOAD, slot->download);
+}
+
+} // OpenCL
+} // isa
+
+#endif // CONVOLVER_HPP
+
@@ -0,0 +1,192 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <limits>
+
+#include <utils.hpp>
+#include <Convolution.hpp>
+#include <ConvolutionSIMD.hpp>
+#include <Separable.hpp>
+#include <FFT.hpp>
+#include <BoxFilter.hpp>
+
+
+#ifndef COST_MODEL_HPP
+#define COST_MODEL_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Convolution algorithms
+enum ConvolutionAlgorithm { DIRECT = 0, SEPARABLE, FFT, BOX };
+
+// Largest FFT size considered by the cost model
+const unsigned int maxFFTSize = 256;
+
+// Linear cost model: the time of an algorithm is its work multiplied by a calibrated cost in seconds per unit of work
+class ConvolutionCostModel {
+public:
+  ConvolutionCostModel();
+  ~ConvolutionCostModel();
+  // Get
+  inline double getCost(const ConvolutionAlgorithm algorithm) const;
+  // Set
+  inline void setCost(const ConvolutionAlgorithm algorithm, const double cost);
+  // Estimated time, in seconds
+  double getTime(const ConvolutionAlgorithm algorithm, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight) const;
+  // Fastest algorithm; SEPARABLE is only considered for separable filters, FFT when fft is true, and BOX for filters with equal coefficients
+  ConvolutionAlgorithm select(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const bool separable, const bool fft, const bool box) const;
+
+private:
+  double costs[4];
+};
+
+std::string toString(const ConvolutionAlgorithm algorithm);
+// Units of work: taps for DIRECT and SEPARABLE, size^2 * log2(size) per tile for FFT, input elements and outputs for BOX
+double getConvolutionWork(const ConvolutionAlgorithm algorithm, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight);
+// Read the costs of a model from a file written by the tuner: one "algorithm cost" pair per line, lines starting with # are ignored
+void readCostModel(const std::string & fileName, ConvolutionCostModel & model);
+// CPU convolution with the algorithm selected by the cost model; FFT is only selected for floating point types
+template< typename T > ConvolutionAlgorithm convolutionAuto(const ConvolutionCostModel & model, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+
+// Implementations
+ConvolutionCostModel::ConvolutionCostModel() {
+  // Defaults for a single core, to be replaced by calibrated costs
+  costs[DIRECT] = 1.0e-10;
+  costs[SEPARABLE] = 2.0e-10;
+  costs[FFT] = 2.0e-9;
+  costs[BOX] = 2.0e-10;
+}
+
+ConvolutionCostModel::~ConvolutionCostModel() {}
+
+inline double ConvolutionCostModel::getCost(const ConvolutionAlgorithm algorithm) const {
+  return costs[algorithm];
+}
+
+inline void ConvolutionCostModel::setCost(const ConvolutionAlgorithm algorithm, const double cost) {
+  costs[algorithm] = cost;
+}
+
+double ConvolutionCostModel::getTime(const ConvolutionAlgorithm algorithm, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight) const {
+  return costs[algorithm] * getConvolutionWork(algorithm, width, height, filterWidth, filterHeight);
+}
+
+ConvolutionAlgorithm ConvolutionCostModel::select(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const bool separable, const bool fft, const bool box) const {
+  ConvolutionAlgorithm best = DIRECT;
+
+  if ( separable && getTime(SEPARABLE, width, height, filterWidth, filterHeight) < getTime(best, width, height, filterWidth, filterHeight) ) {
+    best = SEPARABLE;
+  }
+  if ( fft && getTime(FFT, width, height, filterWidth, filterHeight) < getTime(best, width, height, filterWidth, filterHeight) ) {
+    best = FFT;
+  }
+  if ( box && getTime(BOX, width, height, filterWidth, filterHeight) < getTime(best, width, height, filterWidth, filterHeight) ) {
+    best = BOX;
+  }
+  return best;
+}
+
+std::string toString(const ConvolutionAlgorithm algorithm) {
+  switch ( algorithm ) {
+    case SEPARABLE:
+      return "separable";
+    case FFT:
+      return "fft";
+    case BOX:
+      return "box";
+    default:
+      return "direct";
+  }
+}
+
+double getConvolutionWork(const ConvolutionAlgorithm algorithm, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight) {
+  switch ( algorithm ) {
+    case SEPARABLE:
+      return static_cast< double >(width) * height * (filterWidth + filterHeight);
+    case FFT:
+      return getFFTWork(getFFTSize(width, height, filterWidth, filterHeight, maxFFTSize), width, height, filterWidth, filterHeight);
+    case BOX:
+      return (static_cast< double >(width + (filterWidth - 1)) * (height + (filterHeight - 1))) + (static_cast< double >(width) * height);
+    default:
+      return static_cast< double >(width) * height * filterWidth * filterHeight;
+  }
+}
+
+void readCostModel(const std::string & fileName, ConvolutionCostModel & model) {
+  std::ifstream file;
+  std::string line;
+
+  file.open(fileName.c_str());
+  if ( !file ) {
+    throw std::runtime_error("Impossible to open " + fileName + ".");
+  }
+  while ( std::getline(file, line) ) {
+    std::istringstream items(line);
+    std::string algorithm;
+    double cost = 0.0;
+
+    if ( line.empty() || line[0] == '#' || !(items >> algorithm >> cost) ) {
+      continue;
+    }
+    if ( algorithm == toString(DIRECT) ) {
+      model.setCost(DIRECT, cost);
+    } else if ( algorithm == toString(SEPARABLE) ) {
+      model.setCost(SEPARABLE, cost);
+    } else if ( algorithm == toString(FFT) ) {
+      model.setCost(FFT, cost);
+    } else if ( algorithm == toString(BOX) ) {
+      model.setCost(BOX, cost);
+    }
+  }
+  file.close();
+}
+
+template< typename T > ConvolutionAlgorithm convolutionAuto(const ConvolutionCostModel & model, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  unsigned int nrColumnsPerTile = 0;
+  unsigned int nrRowsPerTile = 0;
+  std::vector< T > rowFilter, columnFilter;
+  T coefficient = 0;
+  const bool separable = isSeparable(filterWidth, filterHeight, filter, rowFilter, columnFilter);
+  const bool box = isBox(filterWidth, filterHeight, filter, coefficient);
+  // The results of the FFT algorithm are not exact, so integers, that the other algorithms compute exactly, do not use it
+  const ConvolutionAlgorithm algorithm = model.select(width, height, filterWidth, filterHeight, separable, !std::numeric_limits< T >::is_integer, box);
+
+  getConvolutionTile< T >(width, height, filterWidth, filterHeight, 32 * 1024, 256 * 1024, nrColumnsPerTile, nrRowsPerTile);
+  switch ( algorithm ) {
+    case SEPARABLE:
+      convolutionSeparable(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, rowFilter, columnFilter);
+      break;
+    case FFT:
+      convolutionFFT(padding, width, height, filterWidth, filterHeight, getFFTSize(width, height, filterWidth, filterHeight, maxFFTSize), input, output, filter);
+      break;
+    case BOX:
+      convolutionBox(padding, width, height, filterWidth, filterHeight, input, output, coefficient);
+      break;
+    default:
+      convolutionSIMD(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+  }
+  return algorithm;
+}
+
+} // OpenCL
+} // isa
+
+#endif // COST_MODEL_HPP
+
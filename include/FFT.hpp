@@ -0,0 +1,301 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <complex>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+#include <utils.hpp>
+#include <Convolution.hpp>
+
+
+#ifndef FFT_HPP
+#define FFT_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Twiddle factors exp(-2 pi i k / size), for k < size / 2
+void getTwiddles(const unsigned int size, std::vector< std::complex< double > > & twiddles);
+// In-place, radix-2 FFT of size (a power of two) elements, accessed with a stride; the inverse is not scaled
+void fft(std::complex< double > * data, const unsigned int size, const unsigned int stride, const std::vector< std::complex< double > > & twiddles, const bool inverse);
+// In-place 2D FFT of a size x size matrix
+void fft2D(std::complex< double > * data, const unsigned int size, const std::vector< std::complex< double > > & twiddles, const bool inverse);
+// Work, in size^2 * log2(size) units, of the overlap-save algorithm with a size x size FFT
+double getFFTWork(const unsigned int size, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight);
+// The power of two, between the filter size and maxSize, that minimizes the work of the overlap-save algorithm
+unsigned int getFFTSize(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int maxSize);
+// Spectrum of the flipped filter, zero-padded to size x size
+template< typename T > void getFilterSpectrum(const unsigned int size, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::vector< std::complex< double > > & spectrum);
+// Spectrum of the flipped filter for the OpenCL algorithm: size x size real parts, followed by size x size imaginary parts
+template< typename T, typename S > void getFilterSpectrumOpenCL(const unsigned int size, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::vector< S > & spectrum);
+// Parallel, overlap-save FFT convolution algorithm
+template< typename T > void convolutionFFT(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int size, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter);
+// OpenCL overlap-save FFT convolution algorithm, one work-group of size work-items per tile.
+// The transforms are computed in float, or double, and the spectrum is of dataType, or float for integers.
+std::string getConvolutionFFTOpenCL(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int size, std::string & dataType);
+
+// Implementations
+void getTwiddles(const unsigned int size, std::vector< std::complex< double > > & twiddles) {
+  twiddles = std::vector< std::complex< double > >(size / 2);
+  for ( unsigned int k = 0; k < size / 2; k++ ) {
+    twiddles[k] = std::polar(1.0, (-2.0 * M_PI * k) / size);
+  }
+}
+
+void fft(std::complex< double > * data, const unsigned int size, const unsigned int stride, const std::vector< std::complex< double > > & twiddles, const bool inverse) {
+  // Bit reversal permutation
+  for ( unsigned int i = 1, j = 0; i < size; i++ ) {
+    unsigned int bit = size >> 1;
+
+    for ( ; j & bit; bit >>= 1 ) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if ( i < j ) {
+      std::swap(data[i * stride], data[j * stride]);
+    }
+  }
+  // Butterflies
+  for ( unsigned int length = 2; length <= size; length <<= 1 ) {
+    const unsigned int step = size / length;
+
+    for ( unsigned int i = 0; i < size; i += length ) {
+      for ( unsigned int k = 0; k < length / 2; k++ ) {
+        const std::complex< double > twiddle = inverse ? std::conj(twiddles[k * step]) : twiddles[k * step];
+        const std::complex< double > item = data[(i + k + (length / 2)) * stride] * twiddle;
+
+        data[(i + k + (length / 2)) * stride] = data[(i + k) * stride] - item;
+        data[(i + k) * stride] += item;
+      }
+    }
+  }
+}
+
+void fft2D(std::complex< double > * data, const unsigned int size, const std::vector< std::complex< double > > & twiddles, const bool inverse) {
+  for ( unsigned int row = 0; row < size; row++ ) {
+    fft(data + (row * size), size, 1, twiddles, inverse);
+  }
+  for ( unsigned int column = 0; column < size; column++ ) {
+    fft(data + column, size, size, twiddles, inverse);
+  }
+}
+
+double getFFTWork(const unsigned int size, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight) {
+  const unsigned int nrTileColumns = (width + (size - filterWidth)) / (size - (filterWidth - 1));
+  const unsigned int nrTileRows = (height + (size - filterHeight)) / (size - (filterHeight - 1));
+
+  return static_cast< double >(nrTileColumns) * nrTileRows * size * size * std::log(static_cast< double >(size)) / std::log(2.0);
+}
+
+unsigned int getFFTSize(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int maxSize) {
+  unsigned int bestSize = 2;
+
+  while ( bestSize < std::max(filterWidth, filterHeight) ) {
+    bestSize <<= 1;
+  }
+  for ( unsigned int size = bestSize << 1; size <= maxSize; size <<= 1 ) {
+    if ( getFFTWork(size, width, height, filterWidth, filterHeight) < getFFTWork(bestSize, width, height, filterWidth, filterHeight) ) {
+      bestSize = size;
+    }
+  }
+  return bestSize;
+}
+
+template< typename T > void getFilterSpectrum(const unsigned int size, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::vector< std::complex< double > > & spectrum) {
+  std::vector< std::complex< double > > twiddles;
+
+  getTwiddles(size, twiddles);
+  spectrum = std::vector< std::complex< double > >(size * size);
+  // The algorithm is a correlation, so the filter is flipped to use the convolution theorem
+  for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+    for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+      spectrum[((filterHeight - 1 - fY) * size) + (filterWidth - 1 - fX)] = static_cast< double >(filter[(fY * filterWidth) + fX]);
+    }
+  }
+  fft2D(spectrum.data(), size, twiddles, false);
+}
+
+template< typename T, typename S > void getFilterSpectrumOpenCL(const unsigned int size, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::vector< S > & spectrum) {
+  std::vector< std::complex< double > > complexSpectrum;
+
+  getFilterSpectrum(size, filterWidth, filterHeight, filter, complexSpectrum);
+  spectrum = std::vector< S >(2 * size * size);
+  for ( unsigned int item = 0; item < size * size; item++ ) {
+    spectrum[item] = static_cast< S >(complexSpectrum[item].real());
+    spectrum[(size * size) + item] = static_cast< S >(complexSpectrum[item].imag());
+  }
+}
+
+template< typename T > void convolutionFFT(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int size, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & filter) {
+  const unsigned int inputStride = isa::utils::pad(width + (filterWidth - 1), padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+  // Each size x size tile produces the outputs not affected by the circular wrap-around
+  const unsigned int nrColumnsPerTile = size - (filterWidth - 1);
+  const unsigned int nrRowsPerTile = size - (filterHeight - 1);
+  const unsigned int nrTileColumns = (width + nrColumnsPerTile - 1) / nrColumnsPerTile;
+  const unsigned int nrTileRows = (height + nrRowsPerTile - 1) / nrRowsPerTile;
+  const int nrTiles = nrTileColumns * nrTileRows;
+  std::vector< std::complex< double > > twiddles;
+  std::vector< std::complex< double > > spectrum;
+
+  getTwiddles(size, twiddles);
+  getFilterSpectrum(size, filterWidth, filterHeight, filter, spectrum);
+  #pragma omp parallel
+  {
+    std::vector< std::complex< double > > tile = std::vector< std::complex< double > >(size * size);
+
+    #pragma omp for schedule(dynamic)
+    for ( int tileID = 0; tileID < nrTiles; tileID++ ) {
+      const unsigned int tileX = (tileID % nrTileColumns) * nrColumnsPerTile;
+      const unsigned int tileY = (tileID / nrTileColumns) * nrRowsPerTile;
+
+      for ( unsigned int y = 0; y < size; y++ ) {
+        for ( unsigned int x = 0; x < size; x++ ) {
+          if ( (tileY + y < height + (filterHeight - 1)) && (tileX + x < width + (filterWidth - 1)) ) {
+            tile[(y * size) + x] = static_cast< double >(input[((tileY + y) * inputStride) + tileX + x]);
+          } else {
+            tile[(y * size) + x] = 0.0;
+          }
+        }
+      }
+      fft2D(tile.data(), size, twiddles, false);
+      for ( unsigned int item = 0; item < size * size; item++ ) {
+        tile[item] *= spectrum[item];
+      }
+      fft2D(tile.data(), size, twiddles, true);
+      for ( unsigned int y = filterHeight - 1; y < size && tileY + y - (filterHeight - 1) < height; y++ ) {
+        for ( unsigned int x = filterWidth - 1; x < size && tileX + x - (filterWidth - 1) < width; x++ ) {
+          // The inverse transform is not scaled; the average is computed in double, and rounded and saturated for integers
+          output[((tileY + y - (filterHeight - 1)) * outputStride) + tileX + x - (filterWidth - 1)] = convolutionAverage< T >(tile[(y * size) + x].real() / (static_cast< double >(size) * size), filterWidth * filterHeight);
+        }
+      }
+    }
+  }
+}
+
+std::string getConvolutionFFTOpenCL(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int size, std::string & dataType) {
+  std::string code;
+  const std::string size_s = isa::utils::toString(size);
+  const std::string accumulatorType = (dataType == "double") ? "double" : "float";
+  // The spectrum of a filter is not integer
+  const std::string spectrumType = (dataType == "half" || dataType == accumulatorType) ? dataType : accumulatorType;
+  std::vector< std::complex< double > > twiddles;
+  std::stringstream twiddlesReal_s;
+  std::stringstream twiddlesImag_s;
+
+  // Twiddle factors are written with full precision, as the default conversion keeps only six digits
+  getTwiddles(size, twiddles);
+  twiddlesReal_s << std::setprecision(17);
+  twiddlesImag_s << std::setprecision(17);
+  for ( unsigned int k = 0; k < size / 2; k++ ) {
+    if ( k > 0 ) {
+      twiddlesReal_s << ", ";
+      twiddlesImag_s << ", ";
+    }
+    twiddlesReal_s << twiddles[k].real();
+    twiddlesImag_s << twiddles[k].imag();
+  }
+
+  // Begin kernel's template
+  code = "__constant " + accumulatorType + " twiddlesReal[" + isa::utils::toString(size / 2) + "] = {" + twiddlesReal_s.str() + "};\n"
+    "__constant " + accumulatorType + " twiddlesImag[" + isa::utils::toString(size / 2) + "] = {" + twiddlesImag_s.str() + "};\n"
+    "void fft(__local " + accumulatorType + " * const restrict real, __local " + accumulatorType + " * const restrict imag, const unsigned int stride, const " + accumulatorType + " direction) {\n"
+    "for ( unsigned int i = 1, j = 0; i < " + size_s + "; i++ ) {\n"
+    "unsigned int bit = " + isa::utils::toString(size >> 1) + ";\n"
+    "for ( ; j & bit; bit >>= 1 ) {\n"
+    "j ^= bit;\n"
+    "}\n"
+    "j ^= bit;\n"
+    "if ( i < j ) {\n"
+    "const " + accumulatorType + " swapReal = real[i * stride];\n"
+    "const " + accumulatorType + " swapImag = imag[i * stride];\n"
+    "real[i * stride] = real[j * stride];\n"
+    "imag[i * stride] = imag[j * stride];\n"
+    "real[j * stride] = swapReal;\n"
+    "imag[j * stride] = swapImag;\n"
+    "}\n"
+    "}\n"
+    "for ( unsigned int length = 2; length <= " + size_s + "; length <<= 1 ) {\n"
+    "for ( unsigned int i = 0; i < " + size_s + "; i += length ) {\n"
+    "for ( unsigned int k = 0; k < length / 2; k++ ) {\n"
+    "const " + accumulatorType + " twiddleReal = twiddlesReal[k * (" + size_s + " / length)];\n"
+    "const " + accumulatorType + " twiddleImag = direction * twiddlesImag[k * (" + size_s + " / length)];\n"
+    "const unsigned int a = (i + k) * stride;\n"
+    "const unsigned int b = (i + k + (length / 2)) * stride;\n"
+    "const " + accumulatorType + " itemReal = (real[b] * twiddleReal) - (imag[b] * twiddleImag);\n"
+    "const " + accumulatorType + " itemImag = (real[b] * twiddleImag) + (imag[b] * twiddleReal);\n"
+    "real[b] = real[a] - itemReal;\n"
+    "imag[b] = imag[a] - itemImag;\n"
+    "real[a] += itemReal;\n"
+    "imag[a] += itemImag;\n"
+    "}\n"
+    "}\n"
+    "}\n"
+    "}\n"
+    "__kernel void convolution(__global const " + dataType + " * const restrict input, __global " + dataType + " * const restrict output, __global const " + spectrumType + " * const restrict spectrum) {\n"
+    "const unsigned int x = get_group_id(0) * " + isa::utils::toString(size - (filterWidth - 1)) + ";\n"
+    "const unsigned int y = get_group_id(1) * " + isa::utils::toString(size - (filterHeight - 1)) + ";\n"
+    "const unsigned int item = get_local_id(0);\n"
+    "__local " + accumulatorType + " tileReal[" + isa::utils::toString(size * size) + "];\n"
+    "__local " + accumulatorType + " tileImag[" + isa::utils::toString(size * size) + "];\n"
+    // Load, with zeros outside the input
+    "for ( unsigned int row = 0; row < " + size_s + "; row++ ) {\n"
+    "if ( (y + row) < " + isa::utils::toString(height + (filterHeight - 1)) + " && (x + item) < " + isa::utils::toString(width + (filterWidth - 1)) + " ) {\n"
+    "tileReal[(row * " + size_s + ") + item] = " + getConvolutionLoad("input", "((y + row) * " + isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding)) + ") + (x + item)", 1, dataType, accumulatorType) + ";\n"
+    "} else {\n"
+    "tileReal[(row * " + size_s + ") + item] = 0;\n"
+    "}\n"
+    "tileImag[(row * " + size_s + ") + item] = 0;\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    // Forward transform, point-wise product with the filter's spectrum, inverse transform
+    "fft(tileReal + (item * " + size_s + "), tileImag + (item * " + size_s + "), 1, 1);\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "fft(tileReal + item, tileImag + item, " + size_s + ", 1);\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "for ( unsigned int column = 0; column < " + size_s + "; column++ ) {\n"
+    "const unsigned int index = (item * " + size_s + ") + column;\n"
+    "const " + accumulatorType + " spectrumReal = " + getConvolutionLoad("spectrum", "index", 1, spectrumType, accumulatorType) + ";\n"
+    "const " + accumulatorType + " spectrumImag = " + getConvolutionLoad("spectrum", isa::utils::toString(size * size) + " + index", 1, spectrumType, accumulatorType) + ";\n"
+    "const " + accumulatorType + " real = (tileReal[index] * spectrumReal) - (tileImag[index] * spectrumImag);\n"
+    "tileImag[index] = (tileReal[index] * spectrumImag) + (tileImag[index] * spectrumReal);\n"
+    "tileReal[index] = real;\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "fft(tileReal + (item * " + size_s + "), tileImag + (item * " + size_s + "), 1, -1);\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    "fft(tileReal + item, tileImag + item, " + size_s + ", -1);\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n"
+    // Store the outputs not affected by the circular wrap-around, scaled by the inverse transform and the number of taps
+    "if ( item >= " + isa::utils::toString(filterWidth - 1) + " && (x + item - " + isa::utils::toString(filterWidth - 1) + ") < " + isa::utils::toString(width) + " ) {\n"
+    "for ( unsigned int row = " + isa::utils::toString(filterHeight - 1) + "; row < " + size_s + " && (y + row - " + isa::utils::toString(filterHeight - 1) + ") < " + isa::utils::toString(height) + "; row++ ) {\n"
+    + getConvolutionStore("tileReal[(row * " + size_s + ") + item] * " + getConvolutionLiteral(1.0 / (static_cast< double >(size) * size * filterWidth * filterHeight), accumulatorType), "output", "((y + row - " + isa::utils::toString(filterHeight - 1) + ") * " + isa::utils::toString(isa::utils::pad(width, padding)) + ") + (x + item - " + isa::utils::toString(filterWidth - 1) + ")", 1, dataType, accumulatorType) +
+    "}\n"
+    "}\n"
+    "}\n";
+  // End kernel's template
+
+  return code;
+}
+
+} // OpenCL
+} // isa
+
+#endif // FFT_HPP
+
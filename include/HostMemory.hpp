@@ -0,0 +1,211 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <new>
+#include <limits>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <CL/cl.hpp>
+#include <utils.hpp>
+
+
+#ifndef HOST_MEMORY_HPP
+#define HOST_MEMORY_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Alignment, and granularity, of the host memory that OpenCL runtimes can use in place
+const size_t hostPageSize = 4096;
+
+// Allocator of page-aligned host memory
+template< typename T > class HostAllocator {
+public:
+  typedef T value_type;
+  typedef T * pointer;
+  typedef const T * const_pointer;
+  typedef T & reference;
+  typedef const T & const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+  template< typename U > struct rebind {
+    typedef HostAllocator< U > other;
+  };
+
+  HostAllocator();
+  template< typename U > HostAllocator(const HostAllocator< U > & allocator);
+  ~HostAllocator();
+  inline pointer address(reference value) const;
+  inline const_pointer address(const_reference value) const;
+  // The size is rounded up to a multiple of the page size
+  pointer allocate(const size_type nrElements, const void * hint = 0);
+  void deallocate(pointer memory, const size_type nrElements);
+  inline size_type max_size() const;
+  inline void construct(pointer memory, const T & value);
+  inline void destroy(pointer memory);
+};
+template< typename T, typename U > inline bool operator==(const HostAllocator< T > & left, const HostAllocator< U > & right);
+template< typename T, typename U > inline bool operator!=(const HostAllocator< T > & left, const HostAllocator< U > & right);
+
+// Vector in page-aligned host memory
+template< typename T > struct HostVector {
+  typedef std::vector< T, HostAllocator< T > > type;
+};
+
+// Transfers between host and device memory: COPY writes and reads device buffers, ZERO_COPY maps buffers that use host memory
+enum ConvolutionBufferMode { COPY = 0, ZERO_COPY };
+
+// ZERO_COPY for devices sharing the memory of the host, like CPUs and integrated GPUs, COPY otherwise
+ConvolutionBufferMode getConvolutionBufferMode(cl::Device & clDevice);
+// Buffer of size bytes for the host memory in host; with ZERO_COPY page-aligned memory is used in place (CL_MEM_USE_HOST_PTR), otherwise the runtime allocates memory that can be mapped (CL_MEM_ALLOC_HOST_PTR)
+cl::Buffer getConvolutionBuffer(cl::Context & clContext, const cl_mem_flags flags, const ConvolutionBufferMode mode, const size_t size, void * host);
+// Make the content of host visible to the device; with ZERO_COPY the buffer is mapped and unmapped, and only memory not used in place is copied
+void writeConvolutionBuffer(cl::CommandQueue & clQueue, cl::Buffer & buffer, const ConvolutionBufferMode mode, const size_t size, const void * host, cl::Event * event);
+// Make the content of the buffer visible in host, blocking
+void readConvolutionBuffer(cl::CommandQueue & clQueue, cl::Buffer & buffer, const ConvolutionBufferMode mode, const size_t size, void * host, cl::Event * event);
+std::string toString(const ConvolutionBufferMode mode);
+
+// Implementations
+template< typename T > HostAllocator< T >::HostAllocator() {}
+
+template< typename T > template< typename U > HostAllocator< T >::HostAllocator(const HostAllocator< U > & allocator) {}
+
+template< typename T > HostAllocator< T >::~HostAllocator() {}
+
+template< typename T > inline typename HostAllocator< T >::pointer HostAllocator< T >::address(reference value) const {
+  return &value;
+}
+
+template< typename T > inline typename HostAllocator< T >::const_pointer HostAllocator< T >::address(const_reference value) const {
+  return &value;
+}
+
+template< typename T > typename HostAllocator< T >::pointer HostAllocator< T >::allocate(const size_type nrElements, const void * hint) {
+  void * memory = 0;
+  size_t size = nrElements * sizeof(T);
+
+  if ( nrElements > max_size() ) {
+    throw std::bad_alloc();
+  }
+  size = ((size + hostPageSize - 1) / hostPageSize) * hostPageSize;
+  if ( posix_memalign(&memory, hostPageSize, size) != 0 ) {
+    throw std::bad_alloc();
+  }
+  return reinterpret_cast< pointer >(memory);
+}
+
+template< typename T > void HostAllocator< T >::deallocate(pointer memory, const size_type nrElements) {
+  std::free(memory);
+}
+
+template< typename T > inline typename HostAllocator< T >::size_type HostAllocator< T >::max_size() const {
+  return (std::numeric_limits< size_type >::max() - hostPageSize) / sizeof(T);
+}
+
+template< typename T > inline void HostAllocator< T >::construct(pointer memory, const T & value) {
+  new (memory) T(value);
+}
+
+template< typename T > inline void HostAllocator< T >::destroy(pointer memory) {
+  memory->~T();
+}
+
+template< typename T, typename U > inline bool operator==(const HostAllocator< T > & left, const HostAllocator< U > & right) {
+  return true;
+}
+
+template< typename T, typename U > inline bool operator!=(const HostAllocator< T > & left, const HostAllocator< U > & right) {
+  return false;
+}
+
+ConvolutionBufferMode getConvolutionBufferMode(cl::Device & clDevice) {
+  cl_bool unified = 0;
+  cl_device_type type = 0;
+
+  try {
+    clDevice.getInfo(CL_DEVICE_HOST_UNIFIED_MEMORY, &unified);
+    clDevice.getInfo(CL_DEVICE_TYPE, &type);
+  } catch ( cl::Error & err ) {
+    return COPY;
+  }
+  if ( unified || (type & CL_DEVICE_TYPE_CPU) ) {
+    return ZERO_COPY;
+  }
+  return COPY;
+}
+
+cl::Buffer getConvolutionBuffer(cl::Context & clContext, const cl_mem_flags flags, const ConvolutionBufferMode mode, const size_t size, void * host) {
+  try {
+    if ( mode == COPY ) {
+      return cl::Buffer(clContext, flags, size, 0, 0);
+    } else if ( reinterpret_cast< size_t >(host) % hostPageSize == 0 ) {
+      return cl::Buffer(clContext, flags | CL_MEM_USE_HOST_PTR, size, host, 0);
+    }
+    return cl::Buffer(clContext, flags | CL_MEM_ALLOC_HOST_PTR, size, 0, 0);
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error allocating memory: " + isa::utils::toString(err.err()) + ".");
+  }
+}
+
+void writeConvolutionBuffer(cl::CommandQueue & clQueue, cl::Buffer & buffer, const ConvolutionBufferMode mode, const size_t size, const void * host, cl::Event * event) {
+  try {
+    if ( mode == COPY ) {
+      clQueue.enqueueWriteBuffer(buffer, CL_FALSE, 0, size, host, 0, event);
+    } else {
+      void * mapped = clQueue.enqueueMapBuffer(buffer, CL_TRUE, CL_MAP_WRITE, 0, size);
+
+      if ( mapped != host ) {
+        std::memcpy(mapped, host, size);
+      }
+      clQueue.enqueueUnmapMemObject(buffer, mapped, 0, event);
+    }
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error H2D transfer: " + isa::utils::toString(err.err()) + ".");
+  }
+}
+
+void readConvolutionBuffer(cl::CommandQueue & clQueue, cl::Buffer & buffer, const ConvolutionBufferMode mode, const size_t size, void * host, cl::Event * event) {
+  try {
+    if ( mode == COPY ) {
+      clQueue.enqueueReadBuffer(buffer, CL_TRUE, 0, size, host, 0, event);
+    } else {
+      void * mapped = clQueue.enqueueMapBuffer(buffer, CL_TRUE, CL_MAP_READ, 0, size, 0, event);
+
+      if ( mapped != host ) {
+        std::memcpy(host, mapped, size);
+      }
+      clQueue.enqueueUnmapMemObject(buffer, mapped);
+      clQueue.finish();
+    }
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error D2H transfer: " + isa::utils::toString(err.err()) + ".");
+  }
+}
+
+std::string toString(const ConvolutionBufferMode mode) {
+  if ( mode == ZERO_COPY ) {
+    return "zero-copy";
+  }
+  return "copy";
+}
+
+} // OpenCL
+} // isa
+
+#endif // HOST_MEMORY_HPP
+
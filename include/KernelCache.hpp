@@ -0,0 +1,257 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <utility>
+#include <iterator>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <mutex>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <Kernel.hpp>
+#include <Exceptions.hpp>
+#include <utils.hpp>
+
+
+#ifndef KERNEL_CACHE_HPP
+#define KERNEL_CACHE_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Cache of compiled kernels: an in-process LRU of cl::Kernel objects, backed by program binaries stored in a directory
+// getKernel can be called concurrently; programs are built outside the lock, so different kernels compile in parallel
+class KernelCache {
+public:
+  // An empty directory disables the on-disk cache
+  KernelCache(const std::string & directory, const unsigned int maxKernels);
+  ~KernelCache();
+  // Get the kernel, compiling it only if it is neither in memory nor on disk; the kernel is owned by the cache, and valid until evicted
+  cl::Kernel * getKernel(const std::string & name, const std::string & code, const std::string & flags, cl::Context & clContext, cl::Device & clDevice);
+  // Counters
+  inline unsigned int getHits() const;
+  inline unsigned int getDiskHits() const;
+  inline unsigned int getMisses() const;
+
+private:
+  typedef std::list< std::pair< std::string, cl::Kernel * > > KernelList;
+
+  cl::Program * loadBinary(const std::string & fileName, const std::string & flags, cl::Context & clContext, cl::Device & clDevice) const;
+  void storeBinary(const std::string & fileName, const cl::Program & program) const;
+
+  std::string directory;
+  unsigned int maxKernels;
+  unsigned int hits;
+  unsigned int diskHits;
+  unsigned int misses;
+  mutable std::mutex lock;
+  // Most recently used first
+  KernelList kernels;
+  std::map< std::string, KernelList::iterator > index;
+};
+
+// Key of a kernel: a 64 bit FNV-1a hash of the source, the device name and driver version, and the build options
+std::string getKernelKey(const std::string & name, const std::string & code, const std::string & flags, const cl::Device & clDevice);
+
+// Implementations
+KernelCache::KernelCache(const std::string & directory, const unsigned int maxKernels) : directory(directory), maxKernels(maxKernels), hits(0), diskHits(0), misses(0) {
+  if ( !directory.empty() ) {
+    mkdir(directory.c_str(), 0755);
+  }
+}
+
+KernelCache::~KernelCache() {
+  for ( KernelList::iterator kernel = kernels.begin(); kernel != kernels.end(); ++kernel ) {
+    delete kernel->second;
+  }
+}
+
+cl::Kernel * KernelCache::getKernel(const std::string & name, const std::string & code, const std::string & flags, cl::Context & clContext, cl::Device & clDevice) {
+  const std::string key = getKernelKey(name, code, flags, clDevice);
+  std::string fileName;
+  cl::Program * program = 0;
+  cl::Kernel * kernel = 0;
+  bool diskHit = false;
+
+  {
+    std::lock_guard< std::mutex > guard(lock);
+    std::map< std::string, KernelList::iterator >::iterator item = index.find(key);
+
+    if ( item != index.end() ) {
+      hits++;
+      kernels.splice(kernels.begin(), kernels, item->second);
+      return kernels.front().second;
+    }
+  }
+  if ( !directory.empty() ) {
+    fileName = directory + "/" + key + ".bin";
+    program = loadBinary(fileName, flags, clContext, clDevice);
+  }
+  if ( program != 0 ) {
+    diskHit = true;
+  } else {
+    std::vector< cl::Device > devices(1, clDevice);
+    cl::Program::Sources sources(1, std::make_pair(code.c_str(), code.length()));
+
+    program = new cl::Program(clContext, sources, 0);
+    try {
+      program->build(devices, flags.c_str());
+    } catch ( cl::Error & err ) {
+      std::string log;
+
+      program->getBuildInfo(clDevice, CL_PROGRAM_BUILD_LOG, &log);
+      delete program;
+      std::lock_guard< std::mutex > guard(lock);
+      misses++;
+      throw OpenCLError("Impossible to build the program: " + isa::utils::toString(err.err()) + ".\n" + log);
+    }
+    if ( !fileName.empty() ) {
+      storeBinary(fileName, *program);
+    }
+  }
+  try {
+    kernel = new cl::Kernel(*program, name.c_str(), 0);
+  } catch ( cl::Error & err ) {
+    delete program;
+    throw OpenCLError("Impossible to create the kernel " + name + ": " + isa::utils::toString(err.err()) + ".");
+  }
+  delete program;
+
+  std::lock_guard< std::mutex > guard(lock);
+  if ( diskHit ) {
+    diskHits++;
+  } else {
+    misses++;
+  }
+  // Another thread built the same kernel in the meantime
+  if ( index.find(key) != index.end() ) {
+    delete kernel;
+    kernels.splice(kernels.begin(), kernels, index[key]);
+    return kernels.front().second;
+  }
+  kernels.push_front(std::make_pair(key, kernel));
+  index[key] = kernels.begin();
+  if ( kernels.size() > maxKernels ) {
+    index.erase(kernels.back().first);
+    delete kernels.back().second;
+    kernels.pop_back();
+  }
+  return kernel;
+}
+
+inline unsigned int KernelCache::getHits() const {
+  return hits;
+}
+
+inline unsigned int KernelCache::getDiskHits() const {
+  return diskHits;
+}
+
+inline unsigned int KernelCache::getMisses() const {
+  return misses;
+}
+
+cl::Program * KernelCache::loadBinary(const std::string & fileName, const std::string & flags, cl::Context & clContext, cl::Device & clDevice) const {
+  std::ifstream file(fileName.c_str(), std::ios::in | std::ios::binary);
+  std::vector< char > binary;
+  cl::Program * program = 0;
+
+  if ( !file ) {
+    return 0;
+  }
+  binary.assign(std::istreambuf_iterator< char >(file), std::istreambuf_iterator< char >());
+  file.close();
+  if ( binary.empty() ) {
+    return 0;
+  }
+  // A binary that does not build, e.g. after a driver update with the same version string, is treated as a miss
+  try {
+    std::vector< cl::Device > devices(1, clDevice);
+    cl::Program::Binaries binaries(1, std::make_pair(reinterpret_cast< const void * >(&(binary[0])), binary.size()));
+
+    program = new cl::Program(clContext, devices, binaries, 0, 0);
+    program->build(devices, flags.c_str());
+  } catch ( cl::Error & err ) {
+    delete program;
+    return 0;
+  }
+  return program;
+}
+
+void KernelCache::storeBinary(const std::string & fileName, const cl::Program & program) const {
+  std::vector< size_t > sizes;
+  std::vector< std::vector< char > > binaries;
+  std::vector< char * > pointers;
+  const std::string temporaryName = fileName + ".tmp";
+  std::ofstream file;
+
+  // The program is only built for one device, the binaries of the other devices of the context are empty
+  program.getInfo(CL_PROGRAM_BINARY_SIZES, &sizes);
+  for ( unsigned int device = 0; device < sizes.size(); device++ ) {
+    binaries.push_back(std::vector< char >(sizes[device] + 1));
+  }
+  for ( unsigned int device = 0; device < sizes.size(); device++ ) {
+    pointers.push_back(&(binaries[device][0]));
+  }
+  if ( pointers.empty() || clGetProgramInfo(program(), CL_PROGRAM_BINARIES, pointers.size() * sizeof(char *), reinterpret_cast< void * >(&(pointers[0])), 0) != CL_SUCCESS ) {
+    return;
+  }
+  for ( unsigned int device = 0; device < sizes.size(); device++ ) {
+    if ( sizes[device] == 0 ) {
+      continue;
+    }
+    // Written to a temporary file first, so that concurrent runs never read a partial binary
+    file.open(temporaryName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(&(binaries[device][0]), sizes[device]);
+    file.close();
+    if ( file ) {
+      std::rename(temporaryName.c_str(), fileName.c_str());
+    } else {
+      std::remove(temporaryName.c_str());
+    }
+    break;
+  }
+}
+
+std::string getKernelKey(const std::string & name, const std::string & code, const std::string & flags, const cl::Device & clDevice) {
+  std::string deviceName;
+  std::string driverVersion;
+  std::string items;
+  long long unsigned int hash = 14695981039346656037ULL;
+  std::ostringstream key;
+
+  clDevice.getInfo(CL_DEVICE_NAME, &deviceName);
+  clDevice.getInfo(CL_DRIVER_VERSION, &driverVersion);
+  // The fields are separated by a character that cannot appear in any of them
+  items = name + '\0' + code + '\0' + flags + '\0' + deviceName + '\0' + driverVersion;
+  for ( std::string::const_iterator item = items.begin(); item != items.end(); ++item ) {
+    hash ^= static_cast< unsigned char >(*item);
+    hash *= 1099511628211ULL;
+  }
+  key << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return key.str();
+}
+
+} // OpenCL
+} // isa
+
+#endif // KERNEL_CACHE_HPP
+
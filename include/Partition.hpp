@@ -0,0 +1,236 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+
+#include <CL/cl.hpp>
+#include <Kernel.hpp>
+#include <utils.hpp>
+#include <Convolution.hpp>
+#include <TuningDatabase.hpp>
+
+
+#ifndef PARTITION_HPP
+#define PARTITION_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Rows of the output computed by one device; its input are the same rows plus the filterHeight - 1 rows below them, that are also in the input of the next partition
+class ConvolutionPartition {
+public:
+  ConvolutionPartition();
+  ~ConvolutionPartition();
+
+  unsigned int firstRow;
+  unsigned int nrRows;
+};
+
+// Split height rows in consecutive partitions, one per weight, with a number of rows proportional to the weight; partitions with small weights can be empty
+std::vector< ConvolutionPartition > getConvolutionPartitions(const unsigned int height, const std::vector< double > & weights);
+// Load-balancing weights of devices, from the GFLOP/s of their tuned configuration for the problem; devices without one get the average weight of the others, or 1
+std::vector< double > getConvolutionWeights(const TuningDatabase & database, const std::vector< std::string > & devices, const std::string & dataType, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight);
+// Split an OpenCL device in sub-devices of nrComputeUnits compute units each
+inline std::vector< cl::Device > getConvolutionSubDevices(cl::Device & clDevice, const unsigned int nrComputeUnits);
+
+// Convolution of one image split by rows across the devices, or sub-devices, of a context: every device owns a partition of the output rows and a copy of the input rows it needs, halo included.
+// Every device has its own configuration, with the VALID boundary, kernel generated for the height of its partition, and queue; the partitions run concurrently.
+template< typename T > class PartitionedConvolver {
+public:
+  PartitionedConvolver(cl::Context & clContext, std::vector< cl::Device > & clDevices, const std::vector< ConvolutionConf > & confs, const std::vector< double > & weights, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::string & dataType);
+  ~PartitionedConvolver();
+  // Convolve a padded image into a padded output image; returns when all the partitions are done
+  void convolve(const std::vector< T > & input, std::vector< T > & output);
+  // Get
+  inline const std::vector< ConvolutionPartition > & getPartitions() const;
+
+private:
+  unsigned int inputStride;
+  unsigned int outputStride;
+  std::vector< ConvolutionPartition > partitions;
+  std::vector< unsigned int > inputSizes;
+  std::vector< unsigned int > outputSizes;
+  std::vector< cl::CommandQueue > clQueues;
+  std::vector< cl::Kernel * > kernels;
+  std::vector< cl::Buffer > input_d;
+  std::vector< cl::Buffer > output_d;
+  cl::Buffer filter_d;
+  std::vector< cl::NDRange > global;
+  std::vector< cl::NDRange > local;
+};
+
+// Implementations
+ConvolutionPartition::ConvolutionPartition() : firstRow(0), nrRows(0) {}
+
+ConvolutionPartition::~ConvolutionPartition() {}
+
+std::vector< ConvolutionPartition > getConvolutionPartitions(const unsigned int height, const std::vector< double > & weights) {
+  std::vector< ConvolutionPartition > partitions(weights.size());
+  double totalWeight = 0.0;
+  double weight = 0.0;
+
+  if ( weights.empty() ) {
+    throw std::invalid_argument("At least one partition is needed.");
+  }
+  for ( unsigned int partition = 0; partition < weights.size(); partition++ ) {
+    if ( weights[partition] < 0.0 ) {
+      throw std::invalid_argument("The weights of the partitions cannot be negative.");
+    }
+    totalWeight += weights[partition];
+  }
+  if ( totalWeight <= 0.0 ) {
+    throw std::invalid_argument("At least one partition needs a positive weight.");
+  }
+  // The boundaries are rounded from the cumulative weights, so the rounding errors do not add up
+  for ( unsigned int partition = 0; partition < weights.size(); partition++ ) {
+    unsigned int lastRow = height;
+
+    weight += weights[partition];
+    if ( partition < weights.size() - 1 ) {
+      lastRow = std::min(static_cast< unsigned int >(std::floor(((height * weight) / totalWeight) + 0.5)), height);
+    }
+    if ( partition > 0 ) {
+      partitions[partition].firstRow = partitions[partition - 1].firstRow + partitions[partition - 1].nrRows;
+    }
+    partitions[partition].nrRows = lastRow - partitions[partition].firstRow;
+  }
+  return partitions;
+}
+
+std::vector< double > getConvolutionWeights(const TuningDatabase & database, const std::vector< std::string > & devices, const std::string & dataType, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight) {
+  std::vector< double > weights(devices.size(), 0.0);
+  unsigned int nrTuned = 0;
+  double totalWeight = 0.0;
+
+  for ( unsigned int device = 0; device < devices.size(); device++ ) {
+    try {
+      weights[device] = database.getEntry(devices[device], dataType, width, height, filterWidth, filterHeight, 1, false).gflops;
+      totalWeight += weights[device];
+      nrTuned++;
+    } catch ( std::out_of_range & err ) {
+      continue;
+    }
+  }
+  for ( unsigned int device = 0; device < devices.size(); device++ ) {
+    if ( weights[device] > 0.0 ) {
+      continue;
+    } else if ( nrTuned > 0 && totalWeight > 0.0 ) {
+      weights[device] = totalWeight / nrTuned;
+    } else {
+      weights[device] = 1.0;
+    }
+  }
+  return weights;
+}
+
+inline std::vector< cl::Device > getConvolutionSubDevices(cl::Device & clDevice, const unsigned int nrComputeUnits) {
+  std::vector< cl::Device > subDevices;
+  const cl_device_partition_property properties[3] = {CL_DEVICE_PARTITION_EQUALLY, static_cast< cl_device_partition_property >(nrComputeUnits), 0};
+
+  try {
+    clDevice.createSubDevices(properties, &subDevices);
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error creating sub-devices: " + isa::utils::toString(err.err()) + ".");
+  }
+  return subDevices;
+}
+
+template< typename T > PartitionedConvolver< T >::PartitionedConvolver(cl::Context & clContext, std::vector< cl::Device > & clDevices, const std::vector< ConvolutionConf > & confs, const std::vector< double > & weights, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::string & dataType) : inputStride(isa::utils::pad(width + (filterWidth - 1), padding)), outputStride(isa::utils::pad(width, padding)) {
+  if ( clDevices.empty() || confs.size() != clDevices.size() || weights.size() != clDevices.size() ) {
+    throw std::invalid_argument("Every device needs a configuration and a weight.");
+  }
+  // The halo of a partition is in the rows of the next one, a boundary mode would be applied at every seam
+  for ( unsigned int device = 0; device < confs.size(); device++ ) {
+    if ( confs[device].getBoundary() != VALID ) {
+      throw std::invalid_argument("Padded images need the VALID boundary mode.");
+    }
+  }
+  partitions = getConvolutionPartitions(height, weights);
+  kernels.resize(clDevices.size(), 0);
+  try {
+    filter_d = cl::Buffer(clContext, CL_MEM_READ_ONLY, filter.size() * sizeof(T), 0, 0);
+    for ( unsigned int device = 0; device < clDevices.size(); device++ ) {
+      const unsigned int nrRows = partitions[device].nrRows;
+
+      inputSizes.push_back(getInputImageSize(padding, width, nrRows, filterWidth, filterHeight));
+      outputSizes.push_back(getOutputImageSize(padding, width, nrRows));
+      clQueues.push_back(cl::CommandQueue(clContext, clDevices[device]));
+      global.push_back(cl::NDRange(getConvolutionGlobalColumns(confs[device], width), getConvolutionGlobalRows(confs[device], nrRows), 1));
+      local.push_back(cl::NDRange(confs[device].getNrColumnsPerBlock(), confs[device].getNrRowsPerBlock(), 1));
+      if ( nrRows == 0 ) {
+        input_d.push_back(cl::Buffer());
+        output_d.push_back(cl::Buffer());
+        continue;
+      }
+      input_d.push_back(cl::Buffer(clContext, CL_MEM_READ_ONLY, inputSizes[device] * sizeof(T), 0, 0));
+      output_d.push_back(cl::Buffer(clContext, CL_MEM_WRITE_ONLY, outputSizes[device] * sizeof(T), 0, 0));
+    }
+    clQueues[0].enqueueWriteBuffer(filter_d, CL_TRUE, 0, filter.size() * sizeof(T), reinterpret_cast< const void * >(filter.data()));
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error allocating memory: " + isa::utils::toString(err.err()) + ".");
+  }
+  for ( unsigned int device = 0; device < clDevices.size(); device++ ) {
+    if ( partitions[device].nrRows == 0 ) {
+      continue;
+    }
+    std::string code = getConvolutionOpenCLSource(confs[device], padding, width, partitions[device].nrRows, filterWidth, filterHeight, 1, inputSizes[device], outputSizes[device], dataType);
+
+    kernels[device] = compile("convolution", code, "-cl-mad-enable -Werror", clContext, clDevices[device]);
+    try {
+      kernels[device]->setArg(0, input_d[device]);
+      kernels[device]->setArg(1, output_d[device]);
+      kernels[device]->setArg(2, filter_d);
+    } catch ( cl::Error & err ) {
+      throw std::runtime_error("OpenCL error setting the arguments: " + isa::utils::toString(err.err()) + ".");
+    }
+  }
+}
+
+template< typename T > PartitionedConvolver< T >::~PartitionedConvolver() {
+  for ( unsigned int device = 0; device < kernels.size(); device++ ) {
+    delete kernels[device];
+  }
+}
+
+template< typename T > void PartitionedConvolver< T >::convolve(const std::vector< T > & input, std::vector< T > & output) {
+  try {
+    // Enqueue all the partitions before waiting for any of them, so that the devices work concurrently
+    for ( unsigned int device = 0; device < partitions.size(); device++ ) {
+      if ( partitions[device].nrRows == 0 ) {
+        continue;
+      }
+      clQueues[device].enqueueWriteBuffer(input_d[device], CL_FALSE, 0, inputSizes[device] * sizeof(T), reinterpret_cast< const void * >(&(input[partitions[device].firstRow * inputStride])));
+      clQueues[device].enqueueNDRangeKernel(*(kernels[device]), cl::NullRange, global[device], local[device]);
+      clQueues[device].enqueueReadBuffer(output_d[device], CL_FALSE, 0, outputSizes[device] * sizeof(T), reinterpret_cast< void * >(&(output[partitions[device].firstRow * outputStride])));
+      clQueues[device].flush();
+    }
+    for ( unsigned int device = 0; device < partitions.size(); device++ ) {
+      clQueues[device].finish();
+    }
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error in the partitioned convolution: " + isa::utils::toString(err.err()) + ".");
+  }
+}
+
+template< typename T > inline const std::vector< ConvolutionPartition > & PartitionedConvolver< T >::getPartitions() const {
+  return partitions;
+}
+
+} // OpenCL
+} // isa
+
+#endif // PARTITION_HPP
@@ -0,0 +1,119 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+#include <CL/cl.hpp>
+#include <utils.hpp>
+
+
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Convolution of a stream of frames, overlapping the upload of frame N + 1, the computation of frame N, and the download of frame N - 1.
+// Every frame in flight has its own input and output buffers; uploads use the first queue, computations the second, and downloads the third.
+// With two queues downloads share the queue of the computations, with one queue nothing overlaps.
+class ConvolutionPipeline {
+public:
+  ConvolutionPipeline(const unsigned int nrBuffers, const size_t inputFrameSize, const size_t outputFrameSize, cl::Context & clContext, std::vector< cl::CommandQueue > & clQueues);
+  ~ConvolutionPipeline();
+  // Convolve nrFrames frames, inputFrameSize and outputFrameSize bytes apart in host memory; the filter arguments of the kernel are already set
+  void run(const unsigned int nrFrames, const void * input, void * output, cl::Kernel & kernel, const cl::NDRange & global, const cl::NDRange & local);
+  // Get
+  inline unsigned int getNrBuffers() const;
+
+private:
+  unsigned int nrBuffers;
+  size_t inputFrameSize;
+  size_t outputFrameSize;
+  std::vector< cl::CommandQueue > & clQueues;
+  std::vector< cl::Buffer > input_d;
+  std::vector< cl::Buffer > output_d;
+};
+
+// Implementations
+ConvolutionPipeline::ConvolutionPipeline(const unsigned int nrBuffers, const size_t inputFrameSize, const size_t outputFrameSize, cl::Context & clContext, std::vector< cl::CommandQueue > & clQueues) : nrBuffers(nrBuffers), inputFrameSize(inputFrameSize), outputFrameSize(outputFrameSize), clQueues(clQueues) {
+  if ( nrBuffers == 0 || clQueues.empty() ) {
+    throw std::invalid_argument("A pipeline needs at least one buffer and one queue.");
+  }
+  try {
+    for ( unsigned int buffer = 0; buffer < nrBuffers; buffer++ ) {
+      input_d.push_back(cl::Buffer(clContext, CL_MEM_READ_ONLY, inputFrameSize, 0, 0));
+      output_d.push_back(cl::Buffer(clContext, CL_MEM_WRITE_ONLY, outputFrameSize, 0, 0));
+    }
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error allocating memory: " + isa::utils::toString(err.err()) + ".");
+  }
+}
+
+ConvolutionPipeline::~ConvolutionPipeline() {}
+
+void ConvolutionPipeline::run(const unsigned int nrFrames, const void * input, void * output, cl::Kernel & kernel, const cl::NDRange & global, const cl::NDRange & local) {
+  cl::CommandQueue & uploadQueue = clQueues[0];
+  cl::CommandQueue & computeQueue = clQueues[std::min(static_cast< size_t >(1), clQueues.size() - 1)];
+  cl::CommandQueue & downloadQueue = clQueues[std::min(static_cast< size_t >(2), clQueues.size() - 1)];
+  // Last command issued on each buffer
+  std::vector< cl::Event > uploads(nrBuffers);
+  std::vector< cl::Event > computations(nrBuffers);
+  std::vector< cl::Event > downloads(nrBuffers);
+
+  try {
+    for ( unsigned int frame = 0; frame < nrFrames; frame++ ) {
+      const unsigned int buffer = frame % nrBuffers;
+      std::vector< cl::Event > dependencies;
+
+      // The input buffer can be overwritten once the kernel of the previous frame that used it is done
+      if ( frame >= nrBuffers ) {
+        dependencies.push_back(computations[buffer]);
+      }
+      uploadQueue.enqueueWriteBuffer(input_d[buffer], CL_FALSE, 0, inputFrameSize, reinterpret_cast< const char * >(input) + (frame * inputFrameSize), dependencies.empty() ? 0 : &dependencies, &(uploads[buffer]));
+      // The output buffer can be overwritten once the previous frame that used it is downloaded
+      dependencies.clear();
+      dependencies.push_back(uploads[buffer]);
+      if ( frame >= nrBuffers ) {
+        dependencies.push_back(downloads[buffer]);
+      }
+      kernel.setArg(0, input_d[buffer]);
+      kernel.setArg(1, output_d[buffer]);
+      computeQueue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local, &dependencies, &(computations[buffer]));
+      dependencies.clear();
+      dependencies.push_back(computations[buffer]);
+      downloadQueue.enqueueReadBuffer(output_d[buffer], CL_FALSE, 0, outputFrameSize, reinterpret_cast< char * >(output) + (frame * outputFrameSize), &dependencies, &(downloads[buffer]));
+      // Submit now, so that the device works while the next frame is enqueued
+      uploadQueue.flush();
+      computeQueue.flush();
+      downloadQueue.flush();
+    }
+    uploadQueue.finish();
+    computeQueue.finish();
+    downloadQueue.finish();
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error in the pipeline: " + isa::utils::toString(err.err()) + ".");
+  }
+}
+
+inline unsigned int ConvolutionPipeline::getNrBuffers() const {
+  return nrBuffers;
+}
+
+} // OpenCL
+} // isa
+
+#endif // PIPELINE_HPP
+
@@ -0,0 +1,155 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <stdexcept>
+
+#include <CL/cl.hpp>
+#include <utils.hpp>
+
+
+#ifndef PROFILING_HPP
+#define PROFILING_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Phases of a convolution on the device: host to device transfers, kernels, and device to host transfers
+enum ConvolutionPhase { UPLOAD = 0, COMPUTE, DOWNLOAD };
+
+// Device timestamps of the commands of a convolution, aggregated per phase
+class ConvolutionProfiler {
+public:
+  ConvolutionProfiler();
+  ~ConvolutionProfiler();
+  // Add the QUEUED, SUBMIT, START and END timestamps of a completed command; its queue must have CL_QUEUE_PROFILING_ENABLE
+  void record(const ConvolutionPhase phase, const cl::Event & event);
+  void reset();
+  // Get, times are averages per command in seconds
+  inline unsigned int getNrCommands(const ConvolutionPhase phase) const;
+  // Time from the enqueue to the submission to the device, and from the submission to the start
+  inline double getQueuedTime(const ConvolutionPhase phase) const;
+  inline double getSubmitTime(const ConvolutionPhase phase) const;
+  inline double getExecutionTime(const ConvolutionPhase phase) const;
+  // Largest cost of one convolution: "launch" for the latency of a kernel, "transfer" for an upload and a download, "compute" for the execution of a kernel
+  std::string getBound() const;
+
+private:
+  unsigned int nrCommands[3];
+  // Sums, in nanoseconds
+  double queued[3];
+  double submit[3];
+  double execution[3];
+};
+
+// Command queue for a profiler
+cl::CommandQueue getProfilingQueue(cl::Context & clContext, cl::Device & clDevice);
+std::string toString(const ConvolutionPhase phase);
+
+// Implementations
+ConvolutionProfiler::ConvolutionProfiler() {
+  reset();
+}
+
+ConvolutionProfiler::~ConvolutionProfiler() {}
+
+void ConvolutionProfiler::record(const ConvolutionPhase phase, const cl::Event & event) {
+  cl_ulong queuedStamp = 0;
+  cl_ulong submitStamp = 0;
+  cl_ulong startStamp = 0;
+  cl_ulong endStamp = 0;
+
+  try {
+    event.getProfilingInfo(CL_PROFILING_COMMAND_QUEUED, &queuedStamp);
+    event.getProfilingInfo(CL_PROFILING_COMMAND_SUBMIT, &submitStamp);
+    event.getProfilingInfo(CL_PROFILING_COMMAND_START, &startStamp);
+    event.getProfilingInfo(CL_PROFILING_COMMAND_END, &endStamp);
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error reading the profiling information: " + isa::utils::toString(err.err()) + ".");
+  }
+  nrCommands[phase]++;
+  queued[phase] += submitStamp - queuedStamp;
+  submit[phase] += startStamp - submitStamp;
+  execution[phase] += endStamp - startStamp;
+}
+
+void ConvolutionProfiler::reset() {
+  for ( unsigned int phase = UPLOAD; phase <= DOWNLOAD; phase++ ) {
+    nrCommands[phase] = 0;
+    queued[phase] = 0.0;
+    submit[phase] = 0.0;
+    execution[phase] = 0.0;
+  }
+}
+
+inline unsigned int ConvolutionProfiler::getNrCommands(const ConvolutionPhase phase) const {
+  return nrCommands[phase];
+}
+
+inline double ConvolutionProfiler::getQueuedTime(const ConvolutionPhase phase) const {
+  if ( nrCommands[phase] == 0 ) {
+    return 0.0;
+  }
+  return (queued[phase] / nrCommands[phase]) * 1.0e-9;
+}
+
+inline double ConvolutionProfiler::getSubmitTime(const ConvolutionPhase phase) const {
+  if ( nrCommands[phase] == 0 ) {
+    return 0.0;
+  }
+  return (submit[phase] / nrCommands[phase]) * 1.0e-9;
+}
+
+inline double ConvolutionProfiler::getExecutionTime(const ConvolutionPhase phase) const {
+  if ( nrCommands[phase] == 0 ) {
+    return 0.0;
+  }
+  return (execution[phase] / nrCommands[phase]) * 1.0e-9;
+}
+
+std::string ConvolutionProfiler::getBound() const {
+  const double launch = getQueuedTime(COMPUTE) + getSubmitTime(COMPUTE);
+  const double transfer = getExecutionTime(UPLOAD) + getExecutionTime(DOWNLOAD);
+  const double compute = getExecutionTime(COMPUTE);
+
+  if ( launch > transfer && launch > compute ) {
+    return "launch";
+  } else if ( transfer > compute ) {
+    return "transfer";
+  }
+  return "compute";
+}
+
+cl::CommandQueue getProfilingQueue(cl::Context & clContext, cl::Device & clDevice) {
+  try {
+    return cl::CommandQueue(clContext, clDevice, CL_QUEUE_PROFILING_ENABLE);
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error creating a profiling queue: " + isa::utils::toString(err.err()) + ".");
+  }
+}
+
+std::string toString(const ConvolutionPhase phase) {
+  if ( phase == UPLOAD ) {
+    return "upload";
+  } else if ( phase == COMPUTE ) {
+    return "compute";
+  }
+  return "download";
+}
+
+} // OpenCL
+} // isa
+
+#endif // PROFILING_HPP
+
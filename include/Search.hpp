@@ -0,0 +1,383 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cmath>
+
+#include <utils.hpp>
+#include <Convolution.hpp>
+
+
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// All the configurations that respect the work-group limits of the tuner; vector widths are the powers of two up to maxVectorWidth.
+// The tiles need not divide the image, but a work-group never has a whole column or row of elements per work-item outside it.
+std::vector< ConvolutionConf > getConvolutionSpace(const bool local, const unsigned int width, const unsigned int height, const unsigned int nrFilters, const unsigned int threadUnit, const unsigned int minThreads, const unsigned int maxThreads, const unsigned int threadIncrement, const unsigned int maxColumns, const unsigned int maxRows, const unsigned int maxItems, const unsigned int maxVectorWidth);
+// Bytes of local memory used by the kernel of a configuration, for images of dataType
+unsigned int getConvolutionLocalMemory(const ConvolutionConf & conf, const bool separable, const unsigned int padding, const unsigned int filterWidth, const unsigned int filterHeight, const std::string & dataType);
+// Registers used by a work-item, counted in data items: the accumulators plus the indices
+unsigned int getConvolutionRegisters(const ConvolutionConf & conf);
+// Remove the configurations that exceed the local memory, work-group size, or register budget; returns the number of removed configurations
+unsigned int pruneConvolutionSpace(std::vector< ConvolutionConf > & space, const bool separable, const unsigned int padding, const unsigned int filterWidth, const unsigned int filterHeight, const std::string & dataType, const unsigned int localMemorySize, const unsigned int maxWorkGroupSize, const unsigned int maxItems);
+
+// A search strategy proposes configurations of the space, and is told how fast they were
+class SearchStrategy {
+public:
+  SearchStrategy(const std::vector< ConvolutionConf > & space);
+  virtual ~SearchStrategy();
+  // Next configuration to evaluate, false when there are no more configurations to propose
+  virtual bool next(ConvolutionConf & conf) = 0;
+  // Performance of the proposed configurations, in the order in which they were proposed; failed configurations have 0 GFLOP/s
+  virtual void report(const double gflops);
+
+protected:
+  unsigned int getRandomUnvisited() const;
+
+  const std::vector< ConvolutionConf > & space;
+  std::vector< bool > visited;
+  unsigned int nrVisited;
+};
+
+// All configurations, in the order of the space
+class ExhaustiveSearch : public SearchStrategy {
+public:
+  ExhaustiveSearch(const std::vector< ConvolutionConf > & space);
+  ~ExhaustiveSearch();
+  bool next(ConvolutionConf & conf);
+};
+
+// Configurations sampled uniformly, without repetitions
+class RandomSearch : public SearchStrategy {
+public:
+  RandomSearch(const std::vector< ConvolutionConf > & space);
+  ~RandomSearch();
+  bool next(ConvolutionConf & conf);
+};
+
+// Simulated annealing: moves to configurations that differ in one parameter, accepting slower ones with a probability that decreases over time
+class AnnealingSearch : public SearchStrategy {
+public:
+  AnnealingSearch(const std::vector< ConvolutionConf > & space, const double temperature, const double cooling);
+  ~AnnealingSearch();
+  bool next(ConvolutionConf & conf);
+  void report(const double gflops);
+
+private:
+  bool isNeighbour(const ConvolutionConf & first, const ConvolutionConf & second) const;
+
+  double temperature;
+  double cooling;
+  int current;
+  double currentGflops;
+  std::deque< unsigned int > proposed;
+};
+
+// Configurations in increasing order of the global memory traffic per output element predicted by the tiling
+class ModelSearch : public SearchStrategy {
+public:
+  ModelSearch(const std::vector< ConvolutionConf > & space, const unsigned int filterWidth, const unsigned int filterHeight);
+  ~ModelSearch();
+  bool next(ConvolutionConf & conf);
+
+private:
+  std::vector< unsigned int > order;
+};
+
+// Traffic model used by ModelSearch, in input elements loaded per output element
+double getConvolutionTraffic(const ConvolutionConf & conf, const unsigned int filterWidth, const unsigned int filterHeight);
+// Strategy by name: exhaustive, random, annealing, or model; the caller owns the strategy
+SearchStrategy * getSearchStrategy(const std::string & name, const std::vector< ConvolutionConf > & space, const unsigned int filterWidth, const unsigned int filterHeight);
+
+// Implementations
+std::vector< ConvolutionConf > getConvolutionSpace(const bool local, const unsigned int width, const unsigned int height, const unsigned int nrFilters, const unsigned int threadUnit, const unsigned int minThreads, const unsigned int maxThreads, const unsigned int threadIncrement, const unsigned int maxColumns, const unsigned int maxRows, const unsigned int maxItems, const unsigned int maxVectorWidth) {
+  std::vector< ConvolutionConf > space;
+
+  for ( unsigned int columns = minThreads; columns <= maxColumns; columns += threadIncrement ) {
+    for ( unsigned int rows = 1; rows <= maxRows; rows++ ) {
+      if ( (columns * rows) > maxThreads ) {
+        break;
+      } else if ( (columns * rows) % threadUnit != 0 ) {
+        continue;
+      }
+      for ( unsigned int columnsPerThread = 1; columnsPerThread <= maxItems; columnsPerThread++ ) {
+        for ( unsigned int vectorWidth = 1; vectorWidth <= maxVectorWidth; vectorWidth *= 2 ) {
+          if ( columnsPerThread > 1 && (columns * (columnsPerThread - 1) * vectorWidth) >= width ) {
+            continue;
+          }
+          for ( unsigned int rowsPerThread = 1; rowsPerThread <= maxItems; rowsPerThread++ ) {
+            if ( rowsPerThread > 1 && (rows * (rowsPerThread - 1)) >= height ) {
+              break;
+            } else if ( columnsPerThread * rowsPerThread > maxItems ) {
+              break;
+            }
+            for ( unsigned int filtersPerThread = 1; filtersPerThread <= nrFilters; filtersPerThread++ ) {
+              ConvolutionConf conf;
+
+              if ( (nrFilters % filtersPerThread) != 0 ) {
+                continue;
+              } else if ( columnsPerThread * rowsPerThread * filtersPerThread > maxItems ) {
+                break;
+              }
+              conf.setLocalMemory(local);
+              conf.setNrColumnsPerBlock(columns);
+              conf.setNrRowsPerBlock(rows);
+              conf.setNrColumnsPerThread(columnsPerThread);
+              conf.setNrRowsPerThread(rowsPerThread);
+              conf.setNrFiltersPerThread(filtersPerThread);
+              conf.setVectorWidth(vectorWidth);
+              space.push_back(conf);
+            }
+          }
+        }
+      }
+    }
+  }
+  return space;
+}
+
+unsigned int getConvolutionLocalMemory(const ConvolutionConf & conf, const bool separable, const unsigned int padding, const unsigned int filterWidth, const unsigned int filterHeight, const std::string & dataType) {
+  const unsigned int tileWidth = conf.getNrColumnsPerBlock() * conf.getNrColumnsPerThread() * conf.getVectorWidth();
+  const unsigned int tileHeight = conf.getNrRowsPerBlock() * conf.getNrRowsPerThread();
+  unsigned int items = 0;
+  const std::string accumulatorType = conf.getAccumulatorType().empty() ? getConvolutionAccumulatorType(dataType) : conf.getAccumulatorType();
+  // Half precision is kept in local memory in the accumulator type
+  std::string localType = dataType;
+  if ( dataType == "half" ) {
+    localType = accumulatorType;
+  }
+
+  // Same buffers declared by getConvolutionOpenCLSource and getConvolutionSeparableOpenCL; the rows of the separable algorithm are accumulators
+  if ( separable ) {
+    const unsigned int rows = (tileHeight + (filterHeight - 1)) * tileWidth * getConvolutionTypeSize(accumulatorType);
+
+    if ( conf.getLocalMemory() ) {
+      items = (tileHeight + (filterHeight - 1)) * (tileWidth + (filterWidth - 1));
+    }
+    return rows + (items * getConvolutionTypeSize(localType));
+  } else if ( conf.getLocalMemory() ) {
+    if ( conf.getNrColumnsPerBlock() < padding ) {
+      items = isa::utils::pad(tileWidth + (filterWidth - 1), padding) * (tileHeight + (filterHeight - 1));
+    } else {
+      items = (tileWidth + (filterWidth - 1)) * (tileHeight + (filterHeight - 1));
+    }
+  }
+  return items * getConvolutionTypeSize(localType);
+}
+
+unsigned int getConvolutionRegisters(const ConvolutionConf & conf) {
+  const unsigned int accumulators = conf.getNrColumnsPerThread() * conf.getVectorWidth() * conf.getNrRowsPerThread() * conf.getNrFiltersPerThread();
+
+  if ( conf.getLocalMemory() ) {
+    return accumulators + 5;
+  }
+  return accumulators + 2;
+}
+
+unsigned int pruneConvolutionSpace(std::vector< ConvolutionConf > & space, const bool separable, const unsigned int padding, const unsigned int filterWidth, const unsigned int filterHeight, const std::string & dataType, const unsigned int localMemorySize, const unsigned int maxWorkGroupSize, const unsigned int maxItems) {
+  std::vector< ConvolutionConf > pruned;
+
+  for ( std::vector< ConvolutionConf >::const_iterator conf = space.begin(); conf != space.end(); ++conf ) {
+    if ( getConvolutionLocalMemory(*conf, separable, padding, filterWidth, filterHeight, dataType) > localMemorySize ) {
+      continue;
+    } else if ( conf->getNrColumnsPerBlock() * conf->getNrRowsPerBlock() > maxWorkGroupSize ) {
+      continue;
+    } else if ( getConvolutionRegisters(*conf) > maxItems ) {
+      continue;
+    }
+    pruned.push_back(*conf);
+  }
+  const unsigned int nrPruned = space.size() - pruned.size();
+  space.swap(pruned);
+  return nrPruned;
+}
+
+SearchStrategy::SearchStrategy(const std::vector< ConvolutionConf > & space) : space(space), visited(std::vector< bool >(space.size(), false)), nrVisited(0) {}
+
+SearchStrategy::~SearchStrategy() {}
+
+void SearchStrategy::report(const double gflops) {}
+
+unsigned int SearchStrategy::getRandomUnvisited() const {
+  unsigned int item = std::rand() % (space.size() - nrVisited);
+
+  for ( unsigned int conf = 0; conf < space.size(); conf++ ) {
+    if ( visited[conf] ) {
+      continue;
+    } else if ( item == 0 ) {
+      return conf;
+    }
+    item--;
+  }
+  return 0;
+}
+
+ExhaustiveSearch::ExhaustiveSearch(const std::vector< ConvolutionConf > & space) : SearchStrategy(space) {}
+
+ExhaustiveSearch::~ExhaustiveSearch() {}
+
+bool ExhaustiveSearch::next(ConvolutionConf & conf) {
+  if ( nrVisited == space.size() ) {
+    return false;
+  }
+  visited[nrVisited] = true;
+  conf = space[nrVisited];
+  nrVisited++;
+  return true;
+}
+
+RandomSearch::RandomSearch(const std::vector< ConvolutionConf > & space) : SearchStrategy(space) {}
+
+RandomSearch::~RandomSearch() {}
+
+bool RandomSearch::next(ConvolutionConf & conf) {
+  if ( nrVisited == space.size() ) {
+    return false;
+  }
+  const unsigned int item = getRandomUnvisited();
+
+  visited[item] = true;
+  conf = space[item];
+  nrVisited++;
+  return true;
+}
+
+AnnealingSearch::AnnealingSearch(const std::vector< ConvolutionConf > & space, const double temperature, const double cooling) : SearchStrategy(space), temperature(temperature), cooling(cooling), current(-1), currentGflops(0.0) {}
+
+AnnealingSearch::~AnnealingSearch() {}
+
+bool AnnealingSearch::next(ConvolutionConf & conf) {
+  std::vector< unsigned int > neighbours;
+  unsigned int item = 0;
+
+  if ( nrVisited == space.size() ) {
+    return false;
+  }
+  if ( current >= 0 ) {
+    for ( unsigned int neighbour = 0; neighbour < space.size(); neighbour++ ) {
+      if ( !visited[neighbour] && isNeighbour(space[current], space[neighbour]) ) {
+        neighbours.push_back(neighbour);
+      }
+    }
+  }
+  // Restart from a random configuration when the neighbourhood is exhausted
+  if ( neighbours.empty() ) {
+    item = getRandomUnvisited();
+  } else {
+    item = neighbours[std::rand() % neighbours.size()];
+  }
+  visited[item] = true;
+  conf = space[item];
+  nrVisited++;
+  proposed.push_back(item);
+  if ( current < 0 ) {
+    current = item;
+  }
+  return true;
+}
+
+void AnnealingSearch::report(const double gflops) {
+  if ( proposed.empty() ) {
+    return;
+  }
+  const unsigned int item = proposed.front();
+
+  proposed.pop_front();
+  // Slower configurations are accepted with probability exp(-relativeSlowdown / temperature)
+  if ( gflops >= currentGflops ) {
+    current = item;
+    currentGflops = gflops;
+  } else if ( gflops > 0.0 && (static_cast< double >(std::rand()) / RAND_MAX) < std::exp(((gflops - currentGflops) / currentGflops) / temperature) ) {
+    current = item;
+    currentGflops = gflops;
+  }
+  temperature *= cooling;
+}
+
+bool AnnealingSearch::isNeighbour(const ConvolutionConf & first, const ConvolutionConf & second) const {
+  unsigned int differences = 0;
+
+  differences += first.getNrColumnsPerBlock() != second.getNrColumnsPerBlock();
+  differences += first.getNrRowsPerBlock() != second.getNrRowsPerBlock();
+  differences += first.getNrColumnsPerThread() != second.getNrColumnsPerThread();
+  differences += first.getNrRowsPerThread() != second.getNrRowsPerThread();
+  differences += first.getNrFiltersPerThread() != second.getNrFiltersPerThread();
+  differences += first.getVectorWidth() != second.getVectorWidth();
+  return differences == 1;
+}
+
+ModelSearch::ModelSearch(const std::vector< ConvolutionConf > & space, const unsigned int filterWidth, const unsigned int filterHeight) : SearchStrategy(space) {
+  std::vector< std::pair< double, unsigned int > > costs;
+
+  for ( unsigned int conf = 0; conf < space.size(); conf++ ) {
+    // Ties are broken in favour of larger work-groups, that hide latency better
+    costs.push_back(std::make_pair(getConvolutionTraffic(space[conf], filterWidth, filterHeight) - (1e-9 * space[conf].getNrColumnsPerBlock() * space[conf].getNrRowsPerBlock()), conf));
+  }
+  std::stable_sort(costs.begin(), costs.end());
+  for ( unsigned int conf = 0; conf < costs.size(); conf++ ) {
+    order.push_back(costs[conf].second);
+  }
+}
+
+ModelSearch::~ModelSearch() {}
+
+bool ModelSearch::next(ConvolutionConf & conf) {
+  if ( nrVisited == space.size() ) {
+    return false;
+  }
+  visited[order[nrVisited]] = true;
+  conf = space[order[nrVisited]];
+  nrVisited++;
+  return true;
+}
+
+double getConvolutionTraffic(const ConvolutionConf & conf, const unsigned int filterWidth, const unsigned int filterHeight) {
+  double tileWidth = conf.getNrColumnsPerThread() * conf.getVectorWidth();
+  double tileHeight = conf.getNrRowsPerThread();
+
+  // With local memory the input is shared by the work-group, otherwise only by the items of a work-item
+  if ( conf.getLocalMemory() ) {
+    tileWidth *= conf.getNrColumnsPerBlock();
+    tileHeight *= conf.getNrRowsPerBlock();
+  }
+  return ((tileWidth + (filterWidth - 1)) * (tileHeight + (filterHeight - 1))) / (tileWidth * tileHeight * conf.getNrFiltersPerThread());
+}
+
+SearchStrategy * getSearchStrategy(const std::string & name, const std::vector< ConvolutionConf > & space, const unsigned int filterWidth, const unsigned int filterHeight) {
+  if ( name == "exhaustive" ) {
+    return new ExhaustiveSearch(space);
+  } else if ( name == "random" ) {
+    return new RandomSearch(space);
+  } else if ( name == "annealing" ) {
+    return new AnnealingSearch(space, 0.1, 0.95);
+  } else if ( name == "model" ) {
+    return new ModelSearch(space, filterWidth, filterHeight);
+  }
+  throw std::invalid_argument("Unknown search strategy " + name + ".");
+}
+
+} // OpenCL
+} // isa
+
+#endif // SEARCH_HPP
+
@@ -0,0 +1,307 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include <utils.hpp>
+#include <Convolution.hpp>
+
+
+#ifndef SEPARABLE_HPP
+#define SEPARABLE_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// Ratio test for rank-1 filters: if filter is the outer product of columnFilter and rowFilter, it returns true and the two filters
+template< typename T > bool isSeparable(const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::vector< T > & rowFilter, std::vector< T > & columnFilter);
+// Parallel, two-pass convolution algorithm for separable filters, accumulating in A
+template< typename T, typename A = typename ConvolutionAccumulator< T >::type > void convolutionSeparable(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & rowFilter, const std::vector< T > & columnFilter);
+// OpenCL separable convolution algorithm, with fused row and column passes
+std::string getConvolutionSeparableOpenCL(const bool local, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, std::string & dataType);
+// OpenCL separable convolution algorithm for a batch of images, one image per index of the third dimension of the NDRange; both passes accumulate in accumulatorType
+std::string getConvolutionSeparableOpenCL(const bool local, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType, const std::string & accumulatorType);
+// OpenCL separable convolution algorithm, with the tunable parameters in conf; the vector width has to be 1
+std::string getConvolutionSeparableOpenCL(const ConvolutionConf & conf, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType);
+// Operations of the separable algorithm, in GFLOP, and its memory traffic with conf, in GB
+double getConvolutionSeparableGFLOP(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight);
+double getConvolutionSeparableGB(const ConvolutionConf & conf, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int elementSize);
+
+// Implementations
+template< typename T > bool isSeparable(const unsigned int filterWidth, const unsigned int filterHeight, const std::vector< T > & filter, std::vector< T > & rowFilter, std::vector< T > & columnFilter) {
+  unsigned int pivot = 0;
+  double tolerance = 0.0;
+  std::vector< double > row = std::vector< double >(filterWidth);
+  std::vector< double > column = std::vector< double >(filterHeight);
+
+  for ( unsigned int tap = 1; tap < filterWidth * filterHeight; tap++ ) {
+    if ( std::abs(static_cast< double >(filter[tap])) > std::abs(static_cast< double >(filter[pivot])) ) {
+      pivot = tap;
+    }
+  }
+  if ( filter[pivot] == 0 ) {
+    return false;
+  }
+  // The rank test is done in double, so that integer filters are not truncated: the pivot row and column, scaled so that their outer product is the filter
+  for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+    row[fX] = static_cast< double >(filter[((pivot / filterWidth) * filterWidth) + fX]) / static_cast< double >(filter[pivot]);
+  }
+  for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+    column[fY] = static_cast< double >(filter[(fY * filterWidth) + (pivot % filterWidth)]);
+  }
+  // Integer filters are exact, so only the rounding of the test itself is tolerated
+  if ( std::numeric_limits< T >::is_integer ) {
+    tolerance = std::abs(static_cast< double >(filter[pivot])) * std::numeric_limits< double >::epsilon() * 16 * (filterWidth + filterHeight);
+  } else {
+    tolerance = std::abs(static_cast< double >(filter[pivot])) * std::numeric_limits< T >::epsilon() * 16 * (filterWidth + filterHeight);
+  }
+  for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+    for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+      if ( std::abs(static_cast< double >(filter[(fY * filterWidth) + fX]) - (column[fY] * row[fX])) > tolerance ) {
+        return false;
+      }
+    }
+  }
+  // Integer filters are split in integer factors: the pivot row divided by the greatest common divisor of its elements, and the column that multiplies it
+  if ( std::numeric_limits< T >::is_integer ) {
+    long long int divisor = 0;
+
+    for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+      long long int element = std::llabs(static_cast< long long int >(filter[((pivot / filterWidth) * filterWidth) + fX]));
+
+      while ( element != 0 ) {
+        const long long int remainder = divisor % element;
+
+        divisor = element;
+        element = remainder;
+      }
+    }
+    for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+      row[fX] = static_cast< double >(filter[((pivot / filterWidth) * filterWidth) + fX]) / divisor;
+    }
+    for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+      column[fY] = static_cast< double >(filter[(fY * filterWidth) + (pivot % filterWidth)]) / row[pivot % filterWidth];
+    }
+  }
+  rowFilter = std::vector< T >(row.begin(), row.end());
+  columnFilter = std::vector< T >(column.begin(), column.end());
+  return true;
+}
+
+template< typename T, typename A > void convolutionSeparable(const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const std::vector< T > & input, std::vector< T > & output, const std::vector< T > & rowFilter, const std::vector< T > & columnFilter) {
+  const unsigned int inputStride = isa::utils::pad(width + (filterWidth - 1), padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+  const unsigned int nrTileColumns = (width + nrColumnsPerTile - 1) / nrColumnsPerTile;
+  const unsigned int nrTileRows = (height + nrRowsPerTile - 1) / nrRowsPerTile;
+  const int nrTiles = nrTileColumns * nrTileRows;
+
+  #pragma omp parallel
+  {
+    // Result of the row pass for the current tile, including the halo rows
+    std::vector< A > rows = std::vector< A >((nrRowsPerTile + (filterHeight - 1)) * nrColumnsPerTile);
+    // Result of the column pass for the current row of the tile
+    std::vector< A > sums = std::vector< A >(nrColumnsPerTile);
+
+    #pragma omp for schedule(dynamic)
+    for ( int tile = 0; tile < nrTiles; tile++ ) {
+      const unsigned int tileX = (tile % nrTileColumns) * nrColumnsPerTile;
+      const unsigned int tileY = (tile / nrTileColumns) * nrRowsPerTile;
+      const unsigned int tileWidth = std::min(nrColumnsPerTile, width - tileX);
+      const unsigned int tileHeight = std::min(nrRowsPerTile, height - tileY);
+
+      for ( unsigned int y = 0; y < tileHeight + (filterHeight - 1); y++ ) {
+        const T * inputRow = &(input[((tileY + y) * inputStride) + tileX]);
+        A * rowsRow = &(rows[y * nrColumnsPerTile]);
+
+        std::fill(rowsRow, rowsRow + tileWidth, static_cast< A >(0));
+        for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+          const A tap = static_cast< A >(rowFilter[fX]);
+
+          for ( unsigned int x = 0; x < tileWidth; x++ ) {
+            rowsRow[x] += static_cast< A >(inputRow[x + fX]) * tap;
+          }
+        }
+      }
+      for ( unsigned int y = 0; y < tileHeight; y++ ) {
+        T * outputRow = &(output[((tileY + y) * outputStride) + tileX]);
+
+        std::fill(sums.begin(), sums.begin() + tileWidth, static_cast< A >(0));
+        for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+          const A tap = static_cast< A >(columnFilter[fY]);
+          const A * rowsRow = &(rows[(y + fY) * nrColumnsPerTile]);
+
+          for ( unsigned int x = 0; x < tileWidth; x++ ) {
+            sums[x] += rowsRow[x] * tap;
+          }
+        }
+        for ( unsigned int x = 0; x < tileWidth; x++ ) {
+          outputRow[x] = convolutionAverage< T >(sums[x], filterWidth * filterHeight);
+        }
+      }
+    }
+  }
+}
+
+double getConvolutionSeparableGFLOP(const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight) {
+  return isa::utils::giga((static_cast< long long unsigned int >(width) * height * (filterWidth + filterHeight) * 2) + (static_cast< long long unsigned int >(width) * height));
+}
+
+double getConvolutionSeparableGB(const ConvolutionConf & conf, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int elementSize) {
+  const unsigned int tileWidth = conf.getNrColumnsPerBlock() * conf.getNrColumnsPerThread() * conf.getVectorWidth();
+  const unsigned int tileHeight = conf.getNrRowsPerBlock() * conf.getNrRowsPerThread();
+
+  if ( conf.getLocalMemory() ) {
+    return isa::utils::giga((static_cast< long long unsigned int >((width + tileWidth - 1) / tileWidth) * ((height + tileHeight - 1) / tileHeight) * ((tileWidth + (filterWidth - 1)) * (tileHeight + (filterHeight - 1))) * elementSize) + (static_cast< long long unsigned int >(width) * height * elementSize) + (static_cast< long long unsigned int >(width) * (height) * (filterWidth + filterHeight) * elementSize));
+  }
+  return isa::utils::giga((static_cast< long long unsigned int >((width + tileWidth - 1) / tileWidth) * ((height + tileHeight - 1) / tileHeight) * (tileWidth * (tileHeight + (filterHeight - 1))) * filterWidth * 2 * elementSize) + (static_cast< long long unsigned int >(width) * height * elementSize) + (static_cast< long long unsigned int >(width) * (height) * filterHeight * elementSize));
+}
+
+std::string getConvolutionSeparableOpenCL(const ConvolutionConf & conf, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType) {
+  if ( conf.getVectorWidth() != 1 ) {
+    throw std::invalid_argument("Vectors are not supported by the separable algorithm.");
+  }
+  const std::string accumulatorType = conf.getAccumulatorType().empty() ? getConvolutionAccumulatorType(dataType) : conf.getAccumulatorType();
+
+  return getConvolutionSeparableOpenCL(conf.getLocalMemory(), padding, width, height, filterWidth, filterHeight, conf.getNrColumnsPerBlock(), conf.getNrRowsPerBlock(), conf.getNrColumnsPerThread(), conf.getNrRowsPerThread(), inputImageStride, outputImageStride, dataType, accumulatorType);
+}
+
+std::string getConvolutionSeparableOpenCL(const bool local, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, std::string & dataType) {
+  return getConvolutionSeparableOpenCL(local, padding, width, height, filterWidth, filterHeight, nrColumnsPerBlock, nrRowsPerBlock, nrColumnsPerThread, nrRowsPerThread, getInputImageSize(padding, width, height, filterWidth, filterHeight), getOutputImageSize(padding, width, height), dataType, getConvolutionAccumulatorType(dataType));
+}
+
+std::string getConvolutionSeparableOpenCL(const bool local, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, const unsigned int inputImageStride, const unsigned int outputImageStride, std::string & dataType, const std::string & accumulatorType) {
+  // Size of the tile computed by a work-group, and of its input with the halo
+  const std::string tileWidth_s = isa::utils::toString(nrColumnsPerBlock * nrColumnsPerThread);
+  const std::string tileHeight_s = isa::utils::toString(nrRowsPerBlock * nrRowsPerThread);
+  const std::string inputTileWidth_s = isa::utils::toString((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1));
+  const std::string inputTileHeight_s = isa::utils::toString((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1));
+  const std::string inputStride_s = isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding));
+  // When the tile does not divide the image the last work-group of a dimension is a tail: its reads are clamped to the input, and its stores skip the pixels outside the image
+  const bool tails = (width % (nrColumnsPerBlock * nrColumnsPerThread) != 0) || (height % (nrRowsPerBlock * nrRowsPerThread) != 0);
+  std::string inputRow_s = "(y + fY)";
+  std::string inputColumn_s = "(x + fX)";
+  std::string inputTapColumn_s = "(x + fX + <%XOFFSET%>)";
+  if ( tails ) {
+    inputRow_s = "min(y + fY, " + isa::utils::toString(height + (filterHeight - 1) - 1) + "u)";
+    inputColumn_s = "min(x + fX, " + isa::utils::toString(width + (filterWidth - 1) - 1) + "u)";
+    inputTapColumn_s = "min(x + fX + <%XOFFSET%>, " + isa::utils::toString(width + (filterWidth - 1) - 1) + "u)";
+  }
+  // Half precision is a storage format only, so the tile in local memory is converted already; the rows of the first pass are accumulators
+  std::string localType = dataType;
+  if ( dataType == "half" ) {
+    localType = accumulatorType;
+  }
+
+  // Begin kernel's templates
+  // The taps of the row pass are the XOFFSET of its template
+  std::string rowSums_s;
+  if ( local ) {
+    rowSums_s = "sum += " + getConvolutionLoad("localInput", "(fY * " + inputTileWidth_s + ") + (fX + <%XOFFSET%>)", 1, localType, accumulatorType) + " * " + getConvolutionLoad("rowFilter", "<%XOFFSET%>", 1, dataType, accumulatorType) + ";\n";
+  } else {
+    rowSums_s = "sum += " + getConvolutionLoad("input", "(image * " + isa::utils::toString(inputImageStride) + ") + (" + inputRow_s + " * " + inputStride_s + ") + " + inputTapColumn_s, 1, dataType, accumulatorType) + " * " + getConvolutionLoad("rowFilter", "<%XOFFSET%>", 1, dataType, accumulatorType) + ";\n";
+  }
+  const ConvolutionTemplate rowSums(rowSums_s);
+  const ConvolutionTemplate defSums(accumulatorType + " sumX<%XNUM%>Y<%YNUM%> = 0;\n");
+  const ConvolutionTemplate sums("sumX<%XNUM%>Y<%YNUM%> += localRows[((get_local_id(1) + <%YOFFSET%> + fY) * " + tileWidth_s + ") + (get_local_id(0) + <%XOFFSET%>)] * " + getConvolutionLoad("columnFilter", "fY", 1, dataType, accumulatorType) + ";\n");
+  const ConvolutionTemplate average(getConvolutionAverage("sumX<%XNUM%>Y<%YNUM%>", filterWidth * filterHeight, 1, accumulatorType));
+  const std::string outputIndex_s = "(image * " + isa::utils::toString(outputImageStride) + ") + ((y + get_local_id(1) + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width, padding)) + ") + (x + get_local_id(0) + <%XOFFSET%>)";
+  std::string store_s;
+  if ( tails ) {
+    store_s = getConvolutionTailStore("sumX<%XNUM%>Y<%YNUM%>", "output", outputIndex_s, "y + get_local_id(1) + <%YOFFSET%>", "x + get_local_id(0) + <%XOFFSET%>", width, height, 1, dataType, accumulatorType);
+  } else {
+    store_s = getConvolutionStore("sumX<%XNUM%>Y<%YNUM%>", "output", outputIndex_s, 1, dataType, accumulatorType);
+  }
+  const ConvolutionTemplate store(store_s);
+  // End kernel's templates
+
+  std::string code;
+  unsigned int values[ConvolutionTemplate::COEFFICIENT] = {0};
+
+  code += "__kernel void convolution(__global const " + dataType + " * const restrict input, __global " + dataType + " * const restrict output, __constant const " + dataType + " * const restrict rowFilter, __constant const " + dataType + " * const restrict columnFilter) {\n"
+    "const unsigned int x = (get_group_id(0) * " + tileWidth_s + ");\n"
+    "const unsigned int y = (get_group_id(1) * " + tileHeight_s + ");\n"
+    "const unsigned int image = get_group_id(2);\n"
+    "__local " + accumulatorType + " localRows[" + isa::utils::toString(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) * (nrColumnsPerBlock * nrColumnsPerThread)) + "];\n";
+  if ( local ) {
+    code += "__local " + localType + " localInput[" + isa::utils::toString(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) * ((nrColumnsPerBlock * nrColumnsPerThread) + (filterWidth - 1))) + "];\n"
+      "for ( unsigned int fY = get_local_id(1); fY < " + inputTileHeight_s + "; fY += " + isa::utils::toString(nrRowsPerBlock) + " ) {\n"
+      "for ( unsigned int fX = get_local_id(0); fX < " + inputTileWidth_s + "; fX += " + isa::utils::toString(nrColumnsPerBlock) + " ) {\n"
+      "localInput[(fY * " + inputTileWidth_s + ") + fX] = " + getConvolutionLoad("input", "(image * " + isa::utils::toString(inputImageStride) + ") + (" + inputRow_s + " * " + inputStride_s + ") + " + inputColumn_s, 1, dataType, localType) + ";\n"
+      "}\n"
+      "}\n"
+      "barrier(CLK_LOCAL_MEM_FENCE);\n";
+  }
+  // Row pass, over the rows of the tile and their halo
+  code += "for ( unsigned int fY = get_local_id(1); fY < " + inputTileHeight_s + "; fY += " + isa::utils::toString(nrRowsPerBlock) + " ) {\n"
+    "for ( unsigned int fX = get_local_id(0); fX < " + tileWidth_s + "; fX += " + isa::utils::toString(nrColumnsPerBlock) + " ) {\n"
+    + accumulatorType + " sum = 0;\n";
+  for ( unsigned int tap = 0; tap < filterWidth; tap++ ) {
+    values[ConvolutionTemplate::XOFFSET] = tap;
+    rowSums.append(code, values);
+  }
+  code += "localRows[(fY * " + tileWidth_s + ") + fX] = sum;\n"
+    "}\n"
+    "}\n"
+    "barrier(CLK_LOCAL_MEM_FENCE);\n";
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      defSums.append(code, values);
+    }
+  }
+  // Column pass
+  code += "for ( unsigned int fY = 0; fY < " + isa::utils::toString(filterHeight) + "; fY++ ) {\n";
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock;
+      sums.append(code, values);
+    }
+  }
+  code += "}\n";
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      average.append(code, values);
+    }
+  }
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    values[ConvolutionTemplate::YNUM] = y;
+    values[ConvolutionTemplate::YOFFSET] = y * nrRowsPerBlock;
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      values[ConvolutionTemplate::XNUM] = x;
+      values[ConvolutionTemplate::XOFFSET] = x * nrColumnsPerBlock;
+      store.append(code, values);
+    }
+  }
+  code += "}\n";
+
+  return code;
+}
+
+} // OpenCL
+} // isa
+
+#endif // SEPARABLE_HPP
+
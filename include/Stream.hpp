@@ -0,0 +1,210 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <CL/cl.hpp>
+#include <utils.hpp>
+#include <Convolution.hpp>
+
+
+#ifndef STREAM_HPP
+#define STREAM_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// A file mapped in memory; a writable file is created, or truncated, to the requested size
+class MappedFile {
+public:
+  MappedFile(const std::string & fileName, const size_t size, const bool writable);
+  ~MappedFile();
+  // Get
+  inline char * getData() const;
+  inline size_t getSize() const;
+
+private:
+  int file;
+  char * data;
+  size_t size;
+};
+
+// Out-of-core convolution of an image stored in a file, processed in bands of nrBandRows output rows.
+// The input file contains (height + filterHeight - 1) rows of (width + filterWidth - 1) elements, the output file height rows of width elements, without padding.
+// Only the new rows of a band are read from the input, the (filterHeight - 1) rows of halo are carried forward from the previous band.
+template< typename T > void convolutionStream(const std::string & inputFileName, const std::string & outputFileName, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const unsigned int nrBandRows, const std::vector< T > & filter);
+// Same, on an OpenCL device; the kernel is generated for a height of nrBandRows, and its filter arguments are already set.
+// The last band is computed in full, but only its valid rows are stored.
+template< typename T > void convolutionStreamOpenCL(const std::string & inputFileName, const std::string & outputFileName, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrBandRows, const ConvolutionConf & conf, cl::Kernel & kernel, cl::Context & clContext, cl::CommandQueue & clQueue);
+
+// Implementations
+MappedFile::MappedFile(const std::string & fileName, const size_t size, const bool writable) : file(-1), data(0), size(size) {
+  void * pointer = 0;
+
+  if ( writable ) {
+    file = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  } else {
+    file = open(fileName.c_str(), O_RDONLY);
+  }
+  if ( file < 0 ) {
+    throw std::runtime_error("Impossible to open " + fileName + ".");
+  }
+  if ( writable && ftruncate(file, size) != 0 ) {
+    close(file);
+    throw std::runtime_error("Impossible to resize " + fileName + ".");
+  } else if ( !writable ) {
+    struct stat status;
+
+    if ( fstat(file, &status) != 0 || static_cast< size_t >(status.st_size) < size ) {
+      close(file);
+      throw std::runtime_error(fileName + " is smaller than " + isa::utils::toString(size) + " bytes.");
+    }
+  }
+  if ( writable ) {
+    pointer = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+  } else {
+    pointer = mmap(0, size, PROT_READ, MAP_SHARED, file, 0);
+  }
+  if ( pointer == MAP_FAILED ) {
+    close(file);
+    throw std::runtime_error("Impossible to map " + fileName + " in memory.");
+  }
+  data = reinterpret_cast< char * >(pointer);
+  // The file is read one band at a time, from the top
+  if ( !writable ) {
+    madvise(pointer, size, MADV_SEQUENTIAL);
+  }
+}
+
+MappedFile::~MappedFile() {
+  munmap(data, size);
+  close(file);
+}
+
+inline char * MappedFile::getData() const {
+  return data;
+}
+
+inline size_t MappedFile::getSize() const {
+  return size;
+}
+
+template< typename T > void convolutionStream(const std::string & inputFileName, const std::string & outputFileName, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrColumnsPerTile, const unsigned int nrRowsPerTile, const unsigned int nrBandRows, const std::vector< T > & filter) {
+  const unsigned int inputWidth = width + (filterWidth - 1);
+  const unsigned int inputStride = isa::utils::pad(inputWidth, padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+  const unsigned int halo = filterHeight - 1;
+  MappedFile inputFile(inputFileName, static_cast< size_t >(height + halo) * inputWidth * sizeof(T), false);
+  MappedFile outputFile(outputFileName, static_cast< size_t >(height) * width * sizeof(T), true);
+  const T * inputData = reinterpret_cast< const T * >(inputFile.getData());
+  T * outputData = reinterpret_cast< T * >(outputFile.getData());
+  std::vector< T > band = std::vector< T >(getInputImageSize(padding, width, nrBandRows, filterWidth, filterHeight));
+  std::vector< T > output = std::vector< T >(getOutputImageSize(padding, width, nrBandRows));
+
+  // The first band also reads the halo
+  for ( unsigned int y = 0; y < halo; y++ ) {
+    std::memcpy(reinterpret_cast< void * >(&(band[(nrBandRows + y) * inputStride])), reinterpret_cast< const void * >(&(inputData[static_cast< size_t >(y) * inputWidth])), inputWidth * sizeof(T));
+  }
+  for ( unsigned int bandY = 0; bandY < height; bandY += nrBandRows ) {
+    const unsigned int nrRows = std::min(nrBandRows, height - bandY);
+
+    // The bottom rows of the previous band are the top rows of this one
+    if ( halo > 0 ) {
+      std::memmove(reinterpret_cast< void * >(&(band[0])), reinterpret_cast< const void * >(&(band[nrBandRows * inputStride])), halo * inputStride * sizeof(T));
+    }
+    for ( unsigned int y = 0; y < nrRows; y++ ) {
+      std::memcpy(reinterpret_cast< void * >(&(band[(halo + y) * inputStride])), reinterpret_cast< const void * >(&(inputData[static_cast< size_t >(bandY + halo + y) * inputWidth])), inputWidth * sizeof(T));
+    }
+    convolutionParallel(padding, width, nrRows, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, band, output, filter);
+    for ( unsigned int y = 0; y < nrRows; y++ ) {
+      std::memcpy(reinterpret_cast< void * >(&(outputData[static_cast< size_t >(bandY + y) * width])), reinterpret_cast< const void * >(&(output[y * outputStride])), width * sizeof(T));
+    }
+  }
+}
+
+template< typename T > void convolutionStreamOpenCL(const std::string & inputFileName, const std::string & outputFileName, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrBandRows, const ConvolutionConf & conf, cl::Kernel & kernel, cl::Context & clContext, cl::CommandQueue & clQueue) {
+  const unsigned int inputWidth = width + (filterWidth - 1);
+  const unsigned int inputStride = isa::utils::pad(inputWidth, padding);
+  const unsigned int outputStride = isa::utils::pad(width, padding);
+  const unsigned int halo = filterHeight - 1;
+  MappedFile inputFile(inputFileName, static_cast< size_t >(height + halo) * inputWidth * sizeof(T), false);
+  MappedFile outputFile(outputFileName, static_cast< size_t >(height) * width * sizeof(T), true);
+  const T * inputData = reinterpret_cast< const T * >(inputFile.getData());
+  T * outputData = reinterpret_cast< T * >(outputFile.getData());
+  // Host staging buffers, with the padded row stride of the kernel
+  std::vector< T > rows = std::vector< T >(std::max(nrBandRows, halo) * inputStride);
+  std::vector< T > output = std::vector< T >(getOutputImageSize(padding, width, nrBandRows));
+  // Two device bands, so that the halo is copied on the device from one to the other
+  cl::Buffer band_d[2];
+  cl::Buffer output_d;
+  unsigned int current = 0;
+
+  try {
+    band_d[0] = cl::Buffer(clContext, CL_MEM_READ_ONLY, getInputImageSize(padding, width, nrBandRows, filterWidth, filterHeight) * sizeof(T), 0, 0);
+    band_d[1] = cl::Buffer(clContext, CL_MEM_READ_ONLY, getInputImageSize(padding, width, nrBandRows, filterWidth, filterHeight) * sizeof(T), 0, 0);
+    output_d = cl::Buffer(clContext, CL_MEM_WRITE_ONLY, output.size() * sizeof(T), 0, 0);
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error allocating memory: " + isa::utils::toString(err.err()) + ".");
+  }
+
+  cl::NDRange global(getConvolutionGlobalColumns(conf, width), getConvolutionGlobalRows(conf, nrBandRows), 1);
+  cl::NDRange local(conf.getNrColumnsPerBlock(), conf.getNrRowsPerBlock(), 1);
+
+  kernel.setArg(1, output_d);
+  try {
+    // The first band also reads the halo
+    for ( unsigned int y = 0; y < halo; y++ ) {
+      std::memcpy(reinterpret_cast< void * >(&(rows[y * inputStride])), reinterpret_cast< const void * >(&(inputData[static_cast< size_t >(y) * inputWidth])), inputWidth * sizeof(T));
+    }
+    if ( halo > 0 ) {
+      clQueue.enqueueWriteBuffer(band_d[current], CL_TRUE, 0, halo * inputStride * sizeof(T), reinterpret_cast< void * >(rows.data()));
+    }
+    for ( unsigned int bandY = 0; bandY < height; bandY += nrBandRows ) {
+      const unsigned int nrRows = std::min(nrBandRows, height - bandY);
+
+      for ( unsigned int y = 0; y < nrRows; y++ ) {
+        std::memcpy(reinterpret_cast< void * >(&(rows[y * inputStride])), reinterpret_cast< const void * >(&(inputData[static_cast< size_t >(bandY + halo + y) * inputWidth])), inputWidth * sizeof(T));
+      }
+      clQueue.enqueueWriteBuffer(band_d[current], CL_TRUE, halo * inputStride * sizeof(T), nrRows * inputStride * sizeof(T), reinterpret_cast< void * >(rows.data()));
+      kernel.setArg(0, band_d[current]);
+      clQueue.enqueueNDRangeKernel(kernel, cl::NullRange, global, local);
+      // The bottom rows of this band are the top rows of the next one, and never leave the device
+      if ( halo > 0 && nrRows == nrBandRows ) {
+        clQueue.enqueueCopyBuffer(band_d[current], band_d[1 - current], nrBandRows * inputStride * sizeof(T), 0, halo * inputStride * sizeof(T));
+      }
+      clQueue.enqueueReadBuffer(output_d, CL_TRUE, 0, nrRows * outputStride * sizeof(T), reinterpret_cast< void * >(output.data()));
+      for ( unsigned int y = 0; y < nrRows; y++ ) {
+        std::memcpy(reinterpret_cast< void * >(&(outputData[static_cast< size_t >(bandY + y) * width])), reinterpret_cast< const void * >(&(output[y * outputStride])), width * sizeof(T));
+      }
+      current = 1 - current;
+    }
+  } catch ( cl::Error & err ) {
+    throw std::runtime_error("OpenCL error streaming: " + isa::utils::toString(err.err()) + ".");
+  }
+}
+
+} // OpenCL
+} // isa
+
+#endif // STREAM_HPP
+
@@ -0,0 +1,219 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+
+#include <utils.hpp>
+#include <Convolution.hpp>
+
+
+#ifndef TUNING_DATABASE_HPP
+#define TUNING_DATABASE_HPP
+
+namespace isa {
+namespace OpenCL {
+
+// One tuned configuration, with its key and performance
+class TuningEntry {
+public:
+  TuningEntry();
+  ~TuningEntry();
+
+  // Key
+  std::string device;
+  std::string dataType;
+  unsigned int width;
+  unsigned int height;
+  unsigned int filterWidth;
+  unsigned int filterHeight;
+  unsigned int nrFilters;
+  bool separable;
+  // Value
+  ConvolutionConf conf;
+  double gflops;
+};
+
+// Database of the fastest configuration for every tuned problem
+class TuningDatabase {
+public:
+  TuningDatabase();
+  ~TuningDatabase();
+  // Add a measured configuration, keeping only the fastest one for each key
+  void insert(const TuningEntry & entry);
+  // Fastest configuration; for sizes that were never tuned, the configuration of the nearest tuned size that can run them
+  ConvolutionConf getConf(const std::string & device, const std::string & dataType, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const bool separable) const;
+  // Entry of the configuration returned by getConf, with its measured performance
+  const TuningEntry & getEntry(const std::string & device, const std::string & dataType, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const bool separable) const;
+  inline unsigned int getNrEntries() const;
+  // Tab separated file, one entry per line, lines starting with # are ignored; the options of the kernel are stored with the configuration
+  void read(const std::string & fileName);
+  void write(const std::string & fileName) const;
+
+private:
+  std::vector< TuningEntry > entries;
+};
+
+// Implementations
+TuningEntry::TuningEntry() : width(0), height(0), filterWidth(0), filterHeight(0), nrFilters(1), separable(false), gflops(0.0) {}
+
+TuningEntry::~TuningEntry() {}
+
+TuningDatabase::TuningDatabase() {}
+
+TuningDatabase::~TuningDatabase() {}
+
+void TuningDatabase::insert(const TuningEntry & entry) {
+  for ( std::vector< TuningEntry >::iterator item = entries.begin(); item != entries.end(); ++item ) {
+    if ( item->device == entry.device && item->dataType == entry.dataType && item->width == entry.width && item->height == entry.height && item->filterWidth == entry.filterWidth && item->filterHeight == entry.filterHeight && item->nrFilters == entry.nrFilters && item->separable == entry.separable ) {
+      if ( entry.gflops > item->gflops ) {
+        *item = entry;
+      }
+      return;
+    }
+  }
+  entries.push_back(entry);
+}
+
+ConvolutionConf TuningDatabase::getConf(const std::string & device, const std::string & dataType, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const bool separable) const {
+  return getEntry(device, dataType, width, height, filterWidth, filterHeight, nrFilters, separable).conf;
+}
+
+const TuningEntry & TuningDatabase::getEntry(const std::string & device, const std::string & dataType, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const bool separable) const {
+  const TuningEntry * nearest = 0;
+  double nearestDistance = std::numeric_limits< double >::max();
+
+  for ( std::vector< TuningEntry >::const_iterator item = entries.begin(); item != entries.end(); ++item ) {
+    double distance = 0.0;
+
+    if ( item->device != device || item->dataType != dataType || item->separable != separable ) {
+      continue;
+    }
+    // The tiles need not divide the image, the filters per work-item must divide the bank
+    if ( nrFilters % item->conf.getNrFiltersPerThread() != 0 ) {
+      continue;
+    }
+    // Sizes are compared on a logarithmic scale, so that doubling a size costs the same at every size
+    distance += std::fabs(std::log(static_cast< double >(item->width) / width));
+    distance += std::fabs(std::log(static_cast< double >(item->height) / height));
+    distance += std::fabs(std::log(static_cast< double >(item->filterWidth) / filterWidth));
+    distance += std::fabs(std::log(static_cast< double >(item->filterHeight) / filterHeight));
+    distance += std::fabs(std::log(static_cast< double >(item->nrFilters) / nrFilters));
+    if ( distance < nearestDistance ) {
+      nearest = &(*item);
+      nearestDistance = distance;
+    }
+  }
+  if ( nearest == 0 ) {
+    throw std::out_of_range("No tuned configuration for " + dataType + " on " + device + ".");
+  }
+  return *nearest;
+}
+
+inline unsigned int TuningDatabase::getNrEntries() const {
+  return entries.size();
+}
+
+void TuningDatabase::read(const std::string & fileName) {
+  std::ifstream file;
+  std::string line;
+
+  file.open(fileName.c_str());
+  if ( !file ) {
+    throw std::runtime_error("Impossible to open " + fileName + ".");
+  }
+  while ( std::getline(file, line) ) {
+    std::istringstream items(line);
+    TuningEntry entry;
+    bool local = false;
+    unsigned int nrColumnsPerBlock = 0;
+    unsigned int nrRowsPerBlock = 0;
+    unsigned int nrColumnsPerThread = 0;
+    unsigned int nrRowsPerThread = 0;
+    unsigned int nrFiltersPerThread = 0;
+    unsigned int vectorWidth = 0;
+    std::vector< std::string > options;
+    std::string option;
+
+    if ( line.empty() || line[0] == '#' ) {
+      continue;
+    }
+    // Device names can contain spaces, so the first two fields are only delimited by tabs
+    std::getline(items, entry.device, '\t');
+    std::getline(items, entry.dataType, '\t');
+    items >> entry.width >> entry.height >> entry.filterWidth >> entry.filterHeight >> entry.nrFilters >> entry.separable;
+    items >> local >> nrColumnsPerBlock >> nrRowsPerBlock >> nrColumnsPerThread >> nrRowsPerThread >> nrFiltersPerThread >> vectorWidth;
+    // The options of the kernel (window, boundary, accumulator type) are missing in the files written before they were stored
+    while ( items >> option ) {
+      options.push_back(option);
+    }
+    if ( options.size() == 4 ) {
+      if ( options[0] != "0" && options[0] != "1" ) {
+        throw std::runtime_error("Malformed line in " + fileName + ": " + line);
+      }
+      entry.conf.setWindow(options[0] == "1");
+      try {
+        entry.conf.setBoundary(getConvolutionBoundary(options[1]));
+      } catch ( std::invalid_argument & err ) {
+        throw std::runtime_error("Malformed line in " + fileName + ": " + line);
+      }
+      if ( options[2] != "default" ) {
+        entry.conf.setAccumulatorType(options[2]);
+      }
+    } else if ( options.size() != 1 ) {
+      throw std::runtime_error("Malformed line in " + fileName + ": " + line);
+    }
+    std::istringstream gflops(options.back());
+    if ( !(gflops >> entry.gflops) ) {
+      throw std::runtime_error("Malformed line in " + fileName + ": " + line);
+    }
+    entry.conf.setLocalMemory(local);
+    entry.conf.setNrColumnsPerBlock(nrColumnsPerBlock);
+    entry.conf.setNrRowsPerBlock(nrRowsPerBlock);
+    entry.conf.setNrColumnsPerThread(nrColumnsPerThread);
+    entry.conf.setNrRowsPerThread(nrRowsPerThread);
+    entry.conf.setNrFiltersPerThread(nrFiltersPerThread);
+    entry.conf.setVectorWidth(vectorWidth);
+    insert(entry);
+  }
+  file.close();
+}
+
+void TuningDatabase::write(const std::string & fileName) const {
+  std::ofstream file;
+
+  file.open(fileName.c_str());
+  if ( !file ) {
+    throw std::runtime_error("Impossible to open " + fileName + ".");
+  }
+  file << "# device\tdataType\twidth\theight\tfilterWidth\tfilterHeight\tfilters\tseparable\tlocal\tcolumnsPerBlock\trowsPerBlock\tcolumnsPerThread\trowsPerThread\tfiltersPerThread\tvectorWidth\twindow\tboundary\taccumulatorType\tGFLOP/s" << std::endl;
+  for ( std::vector< TuningEntry >::const_iterator item = entries.begin(); item != entries.end(); ++item ) {
+    file << item->device << "\t" << item->dataType << "\t" << item->width << "\t" << item->height << "\t" << item->filterWidth << "\t" << item->filterHeight << "\t" << item->nrFilters << "\t" << item->separable << "\t";
+    file << item->conf.getLocalMemory() << "\t" << item->conf.getNrColumnsPerBlock() << "\t" << item->conf.getNrRowsPerBlock() << "\t" << item->conf.getNrColumnsPerThread() << "\t" << item->conf.getNrRowsPerThread() << "\t" << item->conf.getNrFiltersPerThread() << "\t" << item->conf.getVectorWidth() << "\t";
+    file << item->conf.getWindow() << "\t" << toString(item->conf.getBoundary()) << "\t" << (item->conf.getAccumulatorType().empty() ? "default" : item->conf.getAccumulatorType()) << "\t";
+    file << item->gflops << std::endl;
+  }
+  file.close();
+}
+
+} // OpenCL
+} // isa
+
+#endif // TUNING_DATABASE_HPP
+
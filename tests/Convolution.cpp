@@ -20,12 +20,20 @@
 #include <iomanip>
 #include <limits>
 #include <ctime>
+#include <cstdio>
 
 #include <ArgumentList.hpp>
 #include <InitializeOpenCL.hpp>
 #include <Kernel.hpp>
+#include <KernelCache.hpp>
 #include <utils.hpp>
 #include <Convolution.hpp>
+#include <HostMemory.hpp>
+#include <Separable.hpp>
+#include <BoxFilter.hpp>
+#include <Stream.hpp>
+#include <Channels.hpp>
+#include <Partition.hpp>
 
 typedef float dataType;
 std::string typeName("float");
@@ -35,25 +43,50 @@ int main(int argc, char *argv[]) {
   bool print = false;
   bool random = false;
   bool localMem = false;
+  bool window = false;
+  bool separable = false;
+  bool box = false;
+  bool constant = false;
+  bool copy = false;
+  bool interleaved = false;
   unsigned int padding = 0;
+  std::string cacheDirectory;
 	unsigned int clPlatformID = 0;
 	unsigned int clDeviceID = 0;
 	unsigned int nrColumnsPerBlock = 0;
 	unsigned int nrRowsPerBlock = 0;
   unsigned int nrColumnsPerThread = 0;
   unsigned int nrRowsPerThread = 0;
+  unsigned int nrFiltersPerThread = 0;
+  unsigned int vectorWidth = 1;
+  unsigned int nrColumnsPerTile = 0;
+  unsigned int nrRowsPerTile = 0;
   long long unsigned int wrongItems = 0;
   // I/O size
   unsigned int width = 0;
   unsigned int height = 0;
   unsigned int filterWidth = 0;
   unsigned int filterHeight = 0;
+  unsigned int nrImages = 0;
+  unsigned int nrFilters = 0;
+  // Streaming
+  unsigned int nrBandRows = 0;
+  // Partitioning
+  unsigned int nrPartitions = 0;
+  // Boundary
+  isa::OpenCL::ConvolutionBoundary boundary = isa::OpenCL::VALID;
 
   try {
     isa::utils::ArgumentList args(argc, argv);
     print = args.getSwitch("-print");
     random = args.getSwitch("-random");
     localMem = args.getSwitch("-local");
+    window = args.getSwitch("-window");
+    separable = args.getSwitch("-separable");
+    box = args.getSwitch("-box");
+    constant = args.getSwitch("-constant");
+    copy = args.getSwitch("-copy");
+    interleaved = args.getSwitch("-interleaved");
 		clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
 		clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
     padding = args.getSwitchArgument< unsigned int >("-padding");
@@ -61,18 +94,94 @@ int main(int argc, char *argv[]) {
 		nrRowsPerBlock = args.getSwitchArgument< unsigned int >("-rb");
 		nrColumnsPerThread = args.getSwitchArgument< unsigned int >("-ct");
 		nrRowsPerThread = args.getSwitchArgument< unsigned int >("-rt");
+    nrFiltersPerThread = args.getSwitchArgument< unsigned int >("-ft");
     width = args.getSwitchArgument< unsigned int >("-width");
     height = args.getSwitchArgument< unsigned int >("-height");
     filterWidth = args.getSwitchArgument< unsigned int >("-filter_width");
     filterHeight = args.getSwitchArgument< unsigned int >("-filter_height");
+    nrImages = args.getSwitchArgument< unsigned int >("-images");
+    nrFilters = args.getSwitchArgument< unsigned int >("-filters");
+    // The kernel cache directory is optional
+    try {
+      cacheDirectory = args.getSwitchArgument< std::string >("-cache");
+    } catch ( isa::utils::SwitchNotFound & err ) {
+      cacheDirectory = std::string();
+    }
+    // Scalar kernels unless a vector width is given
+    try {
+      vectorWidth = args.getSwitchArgument< unsigned int >("-vector");
+    } catch ( isa::utils::SwitchNotFound & err ) {
+      vectorWidth = 1;
+    }
+    // The streaming check is optional
+    try {
+      nrBandRows = args.getSwitchArgument< unsigned int >("-band_rows");
+    } catch ( isa::utils::SwitchNotFound & err ) {
+      nrBandRows = 0;
+    }
+    // The partitioned check is optional
+    try {
+      nrPartitions = args.getSwitchArgument< unsigned int >("-partitions");
+    } catch ( isa::utils::SwitchNotFound & err ) {
+      nrPartitions = 0;
+    }
+    // Padded inputs unless a boundary mode is given
+    try {
+      boundary = isa::OpenCL::getConvolutionBoundary(args.getSwitchArgument< std::string >("-boundary"));
+    } catch ( isa::utils::SwitchNotFound & err ) {
+      boundary = isa::OpenCL::VALID;
+    }
 
 	} catch  ( isa::utils::SwitchNotFound &err ) {
     std::cerr << err.what() << std::endl;
     return 1;
   }catch ( std::exception &err ) {
-    std::cerr << "Usage: " << argv[0] << " [-print] [-random] [-local] -opencl_platform ... -opencl_device ... -padding ... -cb ... -rb ... -ct ... -rt ... -width ... -height ... -filter_width ... -filter_height ..." << std::endl;
+    std::cerr << "Usage: " << argv[0] << " [-print] [-random] [-local] [-window] [-separable] [-box] [-constant] [-copy] [-cache ...] [-vector ...] [-band_rows ...] [-interleaved] [-partitions ...] [-boundary valid|zero|clamp|mirror|wrap] -opencl_platform ... -opencl_device ... -padding ... -cb ... -rb ... -ct ... -rt ... -ft ... -width ... -height ... -filter_width ... -filter_height ... -images ... -filters ..." << std::endl;
 		return 1;
 	}
+  if ( separable && nrFilters > 1 ) {
+    std::cerr << "Filter banks are not supported by the separable algorithm." << std::endl;
+    return 1;
+  } else if ( separable && vectorWidth > 1 ) {
+    std::cerr << "Vectors are not supported by the separable algorithm." << std::endl;
+    return 1;
+  } else if ( separable && constant ) {
+    std::cerr << "Constant coefficients are not supported by the separable algorithm." << std::endl;
+    return 1;
+  } else if ( nrFiltersPerThread == 0 || nrFilters % nrFiltersPerThread != 0 ) {
+    std::cerr << "The filters per work-item have to divide the filters." << std::endl;
+    return 1;
+  } else if ( constant && nrFiltersPerThread != nrFilters ) {
+    std::cerr << "Constant coefficients need all the filters in every work-item." << std::endl;
+    return 1;
+  } else if ( separable && boundary != isa::OpenCL::VALID ) {
+    std::cerr << "Boundary modes are not supported by the separable algorithm." << std::endl;
+    return 1;
+  } else if ( nrBandRows > 0 && boundary != isa::OpenCL::VALID ) {
+    std::cerr << "Boundary modes are not supported by the streaming algorithm." << std::endl;
+    return 1;
+  } else if ( nrBandRows > 0 && nrFilters > 1 ) {
+    std::cerr << "Filter banks are not supported by the streaming algorithm." << std::endl;
+    return 1;
+  } else if ( window && (!localMem || separable) ) {
+    std::cerr << "The sliding window needs local memory, and the direct algorithm." << std::endl;
+    return 1;
+  } else if ( box && (separable || window || constant) ) {
+    std::cerr << "The box algorithm does not use the separable algorithm, the sliding window, or constant coefficients." << std::endl;
+    return 1;
+  } else if ( box && (nrFilters > 1 || vectorWidth > 1 || boundary != isa::OpenCL::VALID) ) {
+    std::cerr << "Filter banks, vectors, and boundary modes are not supported by the box algorithm." << std::endl;
+    return 1;
+  } else if ( (interleaved || nrPartitions > 0) && (separable || box || window || constant) ) {
+    std::cerr << "The interleaved and partitioned checks use the direct algorithm." << std::endl;
+    return 1;
+  } else if ( (interleaved || nrPartitions > 0) && (nrFilters > 1 || boundary != isa::OpenCL::VALID) ) {
+    std::cerr << "Filter banks and boundary modes are not supported by the interleaved and partitioned checks." << std::endl;
+    return 1;
+  } else if ( interleaved && vectorWidth > 1 ) {
+    std::cerr << "Vectors are not supported by the interleaved layout." << std::endl;
+    return 1;
+  }
 
 	// Initialize OpenCL
 	cl::Context * clContext = new cl::Context();
@@ -81,52 +190,110 @@ int main(int argc, char *argv[]) {
 	std::vector< std::vector< cl::CommandQueue > > * clQueues = new std::vector< std::vector < cl::CommandQueue > >();
 
   isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, clContext, clDevices, clQueues);
+  isa::OpenCL::ConvolutionBufferMode bufferMode = isa::OpenCL::COPY;
+  if ( !copy ) {
+    bufferMode = isa::OpenCL::getConvolutionBufferMode(clDevices->at(clDeviceID));
+  }
 
-	// Allocate host memory
-  std::vector< dataType > input = std::vector< dataType >((height + (filterHeight - 1)) * isa::utils::pad(width + (filterWidth - 1), padding));
-  std::vector< dataType > output = std::vector< dataType >(height * isa::utils::pad(width, padding));
-  std::vector< dataType > output_c = std::vector< dataType >(height * isa::utils::pad(width, padding));
-  std::vector< dataType > filter = std::vector< dataType >(filterWidth * filterHeight);
+	// Allocate host memory, the images of the batch are contiguous
+  const unsigned int inputImageStride = isa::OpenCL::getInputImageSize(boundary, padding, width, height, filterWidth, filterHeight);
+  const unsigned int outputImageStride = isa::OpenCL::getOutputImageSize(padding, width, height);
+  std::vector< dataType > input = std::vector< dataType >(nrImages * inputImageStride);
+  isa::OpenCL::HostVector< dataType >::type output = isa::OpenCL::HostVector< dataType >::type(nrImages * nrFilters * outputImageStride);
+  std::vector< dataType > output_c = std::vector< dataType >(nrImages * nrFilters * outputImageStride);
+  std::vector< dataType > filter = std::vector< dataType >(nrFilters * filterWidth * filterHeight);
+  std::vector< dataType > rowFilter = std::vector< dataType >(filterWidth);
+  std::vector< dataType > columnFilter = std::vector< dataType >(filterHeight);
   if ( random ) {
     std::srand(time(0));
   } else {
     std::srand(42);
   }
-  for ( unsigned int i = 0; i < filter.size(); i++ ) {
-    filter[i] = std::rand() % 100;
+  if ( separable ) {
+    // The filter is the outer product of the column and row filters
+    for ( unsigned int i = 0; i < rowFilter.size(); i++ ) {
+      rowFilter[i] = (std::rand() % 10) + 1;
+    }
+    for ( unsigned int i = 0; i < columnFilter.size(); i++ ) {
+      columnFilter[i] = (std::rand() % 10) + 1;
+    }
+    for ( unsigned int i = 0; i < filter.size(); i++ ) {
+      filter[i] = columnFilter[i / filterWidth] * rowFilter[i % filterWidth];
+    }
+  } else if ( box ) {
+    // All the coefficients of a box filter are equal
+    std::fill(filter.begin(), filter.end(), (std::rand() % 10) + 1);
+  } else {
+    for ( unsigned int i = 0; i < filter.size(); i++ ) {
+      filter[i] = std::rand() % 100;
+    }
   }
   for ( unsigned int i = 0; i < input.size(); i++ ) {
     input[i] = std::rand() % 1000;
   }
 
   // Allocate device memory
-  cl::Buffer input_d, output_d, filter_d;
+  cl::Buffer input_d, output_d, filter_d, rowFilter_d, columnFilter_d;
   try {
-    input_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, input.size() * sizeof(dataType), 0, 0);
-    output_d = cl::Buffer(*clContext, CL_MEM_WRITE_ONLY, output.size() * sizeof(dataType), 0, 0);
+    input_d = isa::OpenCL::getConvolutionBuffer(*clContext, CL_MEM_READ_ONLY, bufferMode, input.size() * sizeof(dataType), reinterpret_cast< void * >(input.data()));
+    output_d = isa::OpenCL::getConvolutionBuffer(*clContext, CL_MEM_WRITE_ONLY, bufferMode, output.size() * sizeof(dataType), reinterpret_cast< void * >(output.data()));
     filter_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, filter.size() * sizeof(dataType), 0, 0);
+    rowFilter_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, rowFilter.size() * sizeof(dataType), 0, 0);
+    columnFilter_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, columnFilter.size() * sizeof(dataType), 0, 0);
   } catch ( cl::Error & err ) {
     std::cerr << "OpenCL error allocating memory: " << isa::utils::toString(err.err()) << "." << std::endl;
     return 1;
+  } catch ( std::runtime_error & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
   }
 
   // Copy data structures to device
   try {
     clQueues->at(clDeviceID)[0].enqueueWriteBuffer(filter_d, CL_FALSE, 0, filter.size() * sizeof(float), reinterpret_cast< void * >(filter.data()));
-    clQueues->at(clDeviceID)[0].enqueueWriteBuffer(input_d, CL_FALSE, 0, input.size() * sizeof(dataType), reinterpret_cast< void * >(input.data()));
+    clQueues->at(clDeviceID)[0].enqueueWriteBuffer(rowFilter_d, CL_FALSE, 0, rowFilter.size() * sizeof(dataType), reinterpret_cast< void * >(rowFilter.data()));
+    clQueues->at(clDeviceID)[0].enqueueWriteBuffer(columnFilter_d, CL_FALSE, 0, columnFilter.size() * sizeof(dataType), reinterpret_cast< void * >(columnFilter.data()));
+    isa::OpenCL::writeConvolutionBuffer(clQueues->at(clDeviceID)[0], input_d, bufferMode, input.size() * sizeof(dataType), reinterpret_cast< const void * >(input.data()), 0);
   } catch ( cl::Error & err ) {
     std::cerr << "OpenCL error H2D transfer: " << isa::utils::toString(err.err()) << "." << std::endl;
     return 1;
+  } catch ( std::runtime_error & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
   }
 
 	// Generate kernel
-  std::string * code = isa::OpenCL::getConvolutionOpenCL(localMem, padding, width, height, filterWidth, filterHeight, nrColumnsPerBlock, nrRowsPerBlock, nrColumnsPerThread, nrRowsPerThread, typeName);
+  isa::OpenCL::ConvolutionConf conf;
+  conf.setLocalMemory(localMem);
+  conf.setNrColumnsPerBlock(nrColumnsPerBlock);
+  conf.setNrRowsPerBlock(nrRowsPerBlock);
+  conf.setNrColumnsPerThread(nrColumnsPerThread);
+  conf.setNrRowsPerThread(nrRowsPerThread);
+  conf.setVectorWidth(vectorWidth);
+  std::string code;
+  if ( separable ) {
+    code = isa::OpenCL::getConvolutionSeparableOpenCL(localMem, padding, width, height, filterWidth, filterHeight, nrColumnsPerBlock, nrRowsPerBlock, nrColumnsPerThread, nrRowsPerThread, inputImageStride, outputImageStride, typeName, isa::OpenCL::getConvolutionAccumulatorType(typeName));
+  } else if ( box ) {
+    code = isa::OpenCL::getConvolutionBoxOpenCL(padding, width, height, filterWidth, filterHeight, nrColumnsPerBlock, nrRowsPerBlock, nrColumnsPerThread, nrRowsPerThread, inputImageStride, outputImageStride, typeName, isa::OpenCL::getConvolutionAccumulatorType(typeName));
+  } else {
+    isa::OpenCL::ConvolutionConf kernelConf = conf;
+    std::vector< double > coefficients;
+
+    kernelConf.setNrFiltersPerThread(nrFiltersPerThread);
+    kernelConf.setWindow(window);
+    kernelConf.setBoundary(boundary);
+    if ( constant ) {
+      coefficients = std::vector< double >(filter.begin(), filter.end());
+    }
+    code = isa::OpenCL::getConvolutionOpenCLSource(kernelConf, padding, width, height, filterWidth, filterHeight, nrFilters, inputImageStride, outputImageStride, typeName, coefficients);
+  }
   cl::Kernel * kernel;
+  isa::OpenCL::KernelCache kernelCache(cacheDirectory, 1);
   if ( print ) {
-    std::cout << *code << std::endl;
+    std::cout << code << std::endl;
   }
 	try {
-    kernel = isa::OpenCL::compile("convolution", *code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+    kernel = kernelCache.getKernel("convolution", code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
 	} catch ( isa::OpenCL::OpenCLError &err ) {
     std::cerr << err.what() << std::endl;
 		return 1;
@@ -134,30 +301,195 @@ int main(int argc, char *argv[]) {
 
   // Run OpenCL kernel and CPU control
   try {
-    cl::NDRange global(width / nrColumnsPerThread, height / nrRowsPerThread);
-    cl::NDRange local(nrColumnsPerBlock, nrRowsPerBlock);
+    cl::NDRange global(isa::OpenCL::getConvolutionGlobalColumns(conf, width), isa::OpenCL::getConvolutionGlobalRows(conf, height), nrImages);
+    cl::NDRange local(nrColumnsPerBlock, nrRowsPerBlock, 1);
 
     kernel->setArg(0, input_d);
     kernel->setArg(1, output_d);
-    kernel->setArg(2, filter_d);
+    if ( separable ) {
+      kernel->setArg(2, rowFilter_d);
+      kernel->setArg(3, columnFilter_d);
+    } else {
+      kernel->setArg(2, filter_d);
+    }
     clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local);
-    isa::OpenCL::convolution< dataType >(padding, width, height, filterWidth, filterHeight, input, output_c, filter);
-    clQueues->at(clDeviceID)[0].enqueueReadBuffer(output_d, CL_TRUE, 0, output.size() * sizeof(dataType), reinterpret_cast< void * >(output.data()));
+    if ( boundary != isa::OpenCL::VALID ) {
+      std::vector< dataType > imageInput = std::vector< dataType >(inputImageStride);
+      std::vector< dataType > imageOutput = std::vector< dataType >(outputImageStride);
+      std::vector< dataType > imageFilter = std::vector< dataType >(filterWidth * filterHeight);
+
+      for ( unsigned int image = 0; image < nrImages; image++ ) {
+        std::copy(input.begin() + (image * inputImageStride), input.begin() + ((image + 1) * inputImageStride), imageInput.begin());
+        for ( unsigned int bankFilter = 0; bankFilter < nrFilters; bankFilter++ ) {
+          std::copy(filter.begin() + (bankFilter * imageFilter.size()), filter.begin() + ((bankFilter + 1) * imageFilter.size()), imageFilter.begin());
+          isa::OpenCL::convolution< dataType >(boundary, padding, width, height, filterWidth, filterHeight, imageInput, imageOutput, imageFilter);
+          std::copy(imageOutput.begin(), imageOutput.end(), output_c.begin() + (((image * nrFilters) + bankFilter) * outputImageStride));
+        }
+      }
+    } else if ( nrFilters > 1 ) {
+      std::vector< dataType > imageInput = std::vector< dataType >(inputImageStride);
+      std::vector< dataType > imageOutput = std::vector< dataType >(nrFilters * outputImageStride);
+
+      isa::OpenCL::getConvolutionTile< dataType >(width, height, filterWidth, filterHeight, 32 * 1024, 256 * 1024, nrColumnsPerTile, nrRowsPerTile);
+      for ( unsigned int image = 0; image < nrImages; image++ ) {
+        std::copy(input.begin() + (image * inputImageStride), input.begin() + ((image + 1) * inputImageStride), imageInput.begin());
+        isa::OpenCL::convolutionBank< dataType >(padding, width, height, filterWidth, filterHeight, nrFilters, nrColumnsPerTile, nrRowsPerTile, imageInput, imageOutput, filter);
+        std::copy(imageOutput.begin(), imageOutput.end(), output_c.begin() + (image * nrFilters * outputImageStride));
+      }
+    } else {
+      isa::OpenCL::convolutionBatched< dataType >(nrImages, inputImageStride, outputImageStride, padding, width, height, filterWidth, filterHeight, input, output_c, filter);
+    }
+    isa::OpenCL::readConvolutionBuffer(clQueues->at(clDeviceID)[0], output_d, bufferMode, output.size() * sizeof(dataType), reinterpret_cast< void * >(output.data()), 0);
   } catch ( cl::Error &err ) {
     std::cerr << "OpenCL error kernel execution: " << isa::utils::toString< cl_int >(err.err()) << "." << std::endl;
     return 1;
+  } catch ( std::runtime_error & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  for ( unsigned int image = 0; image < nrImages * nrFilters; image++ ) {
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(output[(image * outputImageStride) + (y * isa::utils::pad(width, padding)) + x], output_c[(image * outputImageStride) + (y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
   }
 
-  for ( unsigned int y = 0; y < height; y++ ) {
-    for ( unsigned int x = 0; x < width; x++ ) {
-      if ( !isa::utils::same(output[(y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
-        wrongItems++;
+  // Stream the first image from a file, in bands of nrBandRows rows
+  if ( wrongItems == 0 && nrBandRows > 0 ) {
+    const std::string streamInputName("ConvolutionStreamInput.bin");
+    const std::string streamOutputName("ConvolutionStreamOutput.bin");
+    std::ofstream streamInput(streamInputName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+    for ( unsigned int y = 0; y < height + (filterHeight - 1); y++ ) {
+      streamInput.write(reinterpret_cast< const char * >(&(input[y * isa::utils::pad(width + (filterWidth - 1), padding)])), (width + (filterWidth - 1)) * sizeof(dataType));
+    }
+    streamInput.close();
+    if ( separable ) {
+      code = isa::OpenCL::getConvolutionSeparableOpenCL(conf, padding, width, nrBandRows, filterWidth, filterHeight, isa::OpenCL::getInputImageSize(padding, width, nrBandRows, filterWidth, filterHeight), isa::OpenCL::getOutputImageSize(padding, width, nrBandRows), typeName);
+    } else {
+      code = isa::OpenCL::getConvolutionOpenCLSource(conf, padding, width, nrBandRows, filterWidth, filterHeight, 1, isa::OpenCL::getInputImageSize(padding, width, nrBandRows, filterWidth, filterHeight), isa::OpenCL::getOutputImageSize(padding, width, nrBandRows), typeName);
+    }
+    try {
+      kernel = kernelCache.getKernel("convolution", code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+      if ( separable ) {
+        kernel->setArg(2, rowFilter_d);
+        kernel->setArg(3, columnFilter_d);
+      } else {
+        kernel->setArg(2, filter_d);
       }
+      isa::OpenCL::convolutionStreamOpenCL< dataType >(streamInputName, streamOutputName, padding, width, height, filterWidth, filterHeight, nrBandRows, conf, *kernel, *clContext, clQueues->at(clDeviceID)[0]);
+      isa::OpenCL::MappedFile streamOutput(streamOutputName, height * width * sizeof(dataType), false);
+      const dataType * streamData = reinterpret_cast< const dataType * >(streamOutput.getData());
+
+      for ( unsigned int y = 0; y < height; y++ ) {
+        for ( unsigned int x = 0; x < width; x++ ) {
+          if ( !isa::utils::same(streamData[(y * width) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+            wrongItems++;
+          }
+        }
+      }
+    } catch ( std::exception & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    }
+    std::remove(streamInputName.c_str());
+    std::remove(streamOutputName.c_str());
+    if ( wrongItems > 0 ) {
+      std::cout << "Wrong items (stream): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+      return 1;
+    }
+  }
+
+  // Convolve the images of the batch again, as the channels of one interleaved image
+  if ( wrongItems == 0 && interleaved ) {
+    const unsigned int inputStride = isa::utils::pad(width + (filterWidth - 1), padding);
+    const unsigned int outputStride = isa::utils::pad(width, padding);
+    const unsigned int interleavedInputStride = isa::utils::pad((width + (filterWidth - 1)) * nrImages, padding);
+    const unsigned int interleavedOutputStride = isa::utils::pad(width * nrImages, padding);
+    std::vector< dataType > interleavedInput = std::vector< dataType >(isa::OpenCL::getChannelsInputSize(isa::OpenCL::INTERLEAVED, nrImages, padding, width, height, filterWidth, filterHeight));
+    std::vector< dataType > interleavedOutput = std::vector< dataType >(isa::OpenCL::getChannelsOutputSize(isa::OpenCL::INTERLEAVED, nrImages, padding, width, height));
+
+    for ( unsigned int channel = 0; channel < nrImages; channel++ ) {
+      for ( unsigned int y = 0; y < height + (filterHeight - 1); y++ ) {
+        for ( unsigned int x = 0; x < width + (filterWidth - 1); x++ ) {
+          interleavedInput[(y * interleavedInputStride) + (x * nrImages) + channel] = input[(channel * inputImageStride) + (y * inputStride) + x];
+        }
+      }
+    }
+    code = isa::OpenCL::getConvolutionChannelsOpenCL(isa::OpenCL::INTERLEAVED, conf, nrImages, padding, width, height, filterWidth, filterHeight, typeName);
+    if ( print ) {
+      std::cout << code << std::endl;
+    }
+    try {
+      cl::Buffer interleavedInput_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, interleavedInput.size() * sizeof(dataType), 0, 0);
+      cl::Buffer interleavedOutput_d = cl::Buffer(*clContext, CL_MEM_WRITE_ONLY, interleavedOutput.size() * sizeof(dataType), 0, 0);
+      cl::NDRange global(isa::OpenCL::getChannelsGlobalColumns(isa::OpenCL::INTERLEAVED, conf, nrImages, width), isa::OpenCL::getConvolutionGlobalRows(conf, height), isa::OpenCL::getChannelsGlobalImages(isa::OpenCL::INTERLEAVED, nrImages));
+      cl::NDRange local(nrColumnsPerBlock, nrRowsPerBlock, 1);
+
+      kernel = kernelCache.getKernel("convolution", code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+      clQueues->at(clDeviceID)[0].enqueueWriteBuffer(interleavedInput_d, CL_FALSE, 0, interleavedInput.size() * sizeof(dataType), reinterpret_cast< void * >(interleavedInput.data()));
+      kernel->setArg(0, interleavedInput_d);
+      kernel->setArg(1, interleavedOutput_d);
+      kernel->setArg(2, filter_d);
+      clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local);
+      clQueues->at(clDeviceID)[0].enqueueReadBuffer(interleavedOutput_d, CL_TRUE, 0, interleavedOutput.size() * sizeof(dataType), reinterpret_cast< void * >(interleavedOutput.data()));
+    } catch ( isa::OpenCL::OpenCLError & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    } catch ( cl::Error & err ) {
+      std::cerr << "OpenCL error kernel execution: " << isa::utils::toString< cl_int >(err.err()) << "." << std::endl;
+      return 1;
+    }
+    for ( unsigned int channel = 0; channel < nrImages; channel++ ) {
+      for ( unsigned int y = 0; y < height; y++ ) {
+        for ( unsigned int x = 0; x < width; x++ ) {
+          if ( !isa::utils::same(interleavedOutput[(y * interleavedOutputStride) + (x * nrImages) + channel], output_c[(channel * outputImageStride) + (y * outputStride) + x]) ) {
+            wrongItems++;
+          }
+        }
+      }
+    }
+    if ( wrongItems > 0 ) {
+      std::cout << "Wrong items (interleaved): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height * nrImages) << "%)." << std::endl;
+      return 1;
+    }
+  }
+
+  // Convolve the first image again, split by rows in nrPartitions equal partitions of the device
+  if ( wrongItems == 0 && nrPartitions > 0 ) {
+    std::vector< cl::Device > partitionDevices(nrPartitions, clDevices->at(clDeviceID));
+    std::vector< isa::OpenCL::ConvolutionConf > partitionConfs(nrPartitions, conf);
+    std::vector< double > weights(nrPartitions, 1.0);
+    std::vector< dataType > partitionInput = std::vector< dataType >(input.begin(), input.begin() + inputImageStride);
+    std::vector< dataType > partitionOutput = std::vector< dataType >(outputImageStride);
+
+    try {
+      isa::OpenCL::PartitionedConvolver< dataType > convolver(*clContext, partitionDevices, partitionConfs, weights, padding, width, height, filterWidth, filterHeight, filter, typeName);
+
+      convolver.convolve(partitionInput, partitionOutput);
+    } catch ( std::exception & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    }
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(partitionOutput[(y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
+    if ( wrongItems > 0 ) {
+      std::cout << "Wrong items (partitioned): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+      return 1;
     }
   }
 
   if ( wrongItems > 0 ) {
-    std::cout << "Wrong items: " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+    std::cout << "Wrong items: " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height * nrImages * nrFilters) << "%)." << std::endl;
   } else {
     std::cout << "TEST PASSED." << std::endl;
   }
@@ -0,0 +1,463 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <ctime>
+#include <cstdio>
+#include <fstream>
+
+#include <ArgumentList.hpp>
+#include <utils.hpp>
+#include <Convolution.hpp>
+#include <ConvolutionSIMD.hpp>
+#include <Separable.hpp>
+#include <FFT.hpp>
+#include <BoxFilter.hpp>
+#include <Channels.hpp>
+#include <CostModel.hpp>
+#include <Stream.hpp>
+
+typedef float dataType;
+
+
+int main(int argc, char *argv[]) {
+  bool random = false;
+  unsigned int padding = 0;
+  unsigned int nrColumnsPerTile = 0;
+  unsigned int nrRowsPerTile = 0;
+  long long unsigned int wrongItems = 0;
+  // I/O size
+  unsigned int width = 0;
+  unsigned int height = 0;
+  unsigned int filterWidth = 0;
+  unsigned int filterHeight = 0;
+
+  try {
+    isa::utils::ArgumentList args(argc, argv);
+    random = args.getSwitch("-random");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    nrColumnsPerTile = args.getSwitchArgument< unsigned int >("-tile_columns");
+    nrRowsPerTile = args.getSwitchArgument< unsigned int >("-tile_rows");
+    width = args.getSwitchArgument< unsigned int >("-width");
+    height = args.getSwitchArgument< unsigned int >("-height");
+    filterWidth = args.getSwitchArgument< unsigned int >("-filter_width");
+    filterHeight = args.getSwitchArgument< unsigned int >("-filter_height");
+  } catch  ( isa::utils::SwitchNotFound &err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  } catch ( std::exception &err ) {
+    std::cerr << "Usage: " << argv[0] << " [-random] -padding ... -tile_columns ... -tile_rows ... -width ... -height ... -filter_width ... -filter_height ..." << std::endl;
+    return 1;
+  }
+
+  // Allocate host memory
+  std::vector< dataType > input = std::vector< dataType >((height + (filterHeight - 1)) * isa::utils::pad(width + (filterWidth - 1), padding));
+  std::vector< dataType > output = std::vector< dataType >(height * isa::utils::pad(width, padding));
+  std::vector< dataType > output_c = std::vector< dataType >(height * isa::utils::pad(width, padding));
+  std::vector< dataType > filter = std::vector< dataType >(filterWidth * filterHeight);
+  if ( random ) {
+    std::srand(time(0));
+  } else {
+    std::srand(42);
+  }
+  for ( unsigned int i = 0; i < filter.size(); i++ ) {
+    filter[i] = std::rand() % 100;
+  }
+  for ( unsigned int i = 0; i < input.size(); i++ ) {
+    input[i] = std::rand() % 1000;
+  }
+
+  // Run the sequential control
+  isa::OpenCL::convolution< dataType >(padding, width, height, filterWidth, filterHeight, input, output_c, filter);
+
+  // Run and check the parallel algorithms
+  for ( unsigned int algorithm = 0; algorithm <= static_cast< unsigned int >(isa::OpenCL::getConvolutionISA()) + 4; algorithm++ ) {
+    std::string name;
+
+    std::fill(output.begin(), output.end(), 0);
+    if ( algorithm == 0 ) {
+      name = "parallel";
+      isa::OpenCL::convolutionParallel< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+    } else if ( algorithm == 1 ) {
+      name = "specialized";
+      isa::OpenCL::convolutionSpecialized< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+    } else if ( algorithm == 2 ) {
+      name = "FFT";
+      isa::OpenCL::convolutionFFT< dataType >(padding, width, height, filterWidth, filterHeight, isa::OpenCL::getFFTSize(width, height, filterWidth, filterHeight, 64), input, output, filter);
+    } else if ( algorithm == 3 ) {
+      isa::OpenCL::ConvolutionCostModel model;
+
+      name = "auto (" + isa::OpenCL::toString(isa::OpenCL::convolutionAuto< dataType >(model, padding, width, height, filterWidth, filterHeight, input, output, filter)) + ")";
+    } else {
+      isa::OpenCL::ConvolutionISA simd = static_cast< isa::OpenCL::ConvolutionISA >(algorithm - 4);
+
+      name = isa::OpenCL::toString(simd);
+      isa::OpenCL::convolutionSIMD< dataType >(simd, padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+    }
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(output[(y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
+    if ( wrongItems > 0 ) {
+      std::cout << "Wrong items (" << name << "): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+      return 1;
+    }
+  }
+
+  // Check the batched algorithm, with a gap between consecutive images
+  const unsigned int nrImages = 3;
+  const unsigned int inputImageStride = input.size() + padding;
+  const unsigned int outputImageStride = output.size() + padding;
+  std::vector< dataType > batchInput = std::vector< dataType >(nrImages * inputImageStride);
+  std::vector< dataType > batchOutput = std::vector< dataType >(nrImages * outputImageStride);
+  for ( unsigned int image = 0; image < nrImages; image++ ) {
+    std::copy(input.begin(), input.end(), batchInput.begin() + (image * inputImageStride));
+  }
+  isa::OpenCL::convolutionBatched< dataType >(nrImages, inputImageStride, outputImageStride, padding, width, height, filterWidth, filterHeight, batchInput, batchOutput, filter);
+  for ( unsigned int image = 0; image < nrImages; image++ ) {
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(batchOutput[(image * outputImageStride) + (y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
+  }
+  if ( wrongItems > 0 ) {
+    std::cout << "Wrong items (batched): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height * nrImages) << "%)." << std::endl;
+    return 1;
+  }
+
+  // Check the multi-channel algorithm in both layouts, against one sequential run per channel
+  const unsigned int nrChannels = 3;
+  std::vector< dataType > channelInput = std::vector< dataType >(input.size());
+  std::vector< std::vector< dataType > > channelOutput_c = std::vector< std::vector< dataType > >(nrChannels, std::vector< dataType >(output.size()));
+  std::vector< dataType > planarInput = std::vector< dataType >(isa::OpenCL::getChannelsInputSize(isa::OpenCL::PLANAR, nrChannels, padding, width, height, filterWidth, filterHeight));
+  std::vector< dataType > interleavedInput = std::vector< dataType >(isa::OpenCL::getChannelsInputSize(isa::OpenCL::INTERLEAVED, nrChannels, padding, width, height, filterWidth, filterHeight));
+  const unsigned int interleavedInputStride = isa::utils::pad((width + (filterWidth - 1)) * nrChannels, padding);
+  const unsigned int interleavedOutputStride = isa::utils::pad(width * nrChannels, padding);
+  for ( unsigned int channel = 0; channel < nrChannels; channel++ ) {
+    for ( unsigned int i = 0; i < channelInput.size(); i++ ) {
+      channelInput[i] = input[i] + (channel * 100);
+    }
+    isa::OpenCL::convolution< dataType >(padding, width, height, filterWidth, filterHeight, channelInput, channelOutput_c[channel], filter);
+    std::copy(channelInput.begin(), channelInput.end(), planarInput.begin() + (channel * channelInput.size()));
+    for ( unsigned int y = 0; y < height + (filterHeight - 1); y++ ) {
+      for ( unsigned int x = 0; x < width + (filterWidth - 1); x++ ) {
+        interleavedInput[(y * interleavedInputStride) + (x * nrChannels) + channel] = channelInput[(y * isa::utils::pad(width + (filterWidth - 1), padding)) + x];
+      }
+    }
+  }
+  for ( unsigned int layout = isa::OpenCL::PLANAR; layout <= isa::OpenCL::INTERLEAVED; layout++ ) {
+    std::vector< dataType > channelOutput = std::vector< dataType >(isa::OpenCL::getChannelsOutputSize(static_cast< isa::OpenCL::ConvolutionLayout >(layout), nrChannels, padding, width, height));
+
+    if ( layout == isa::OpenCL::PLANAR ) {
+      isa::OpenCL::convolutionChannels< dataType >(isa::OpenCL::PLANAR, nrChannels, padding, width, height, filterWidth, filterHeight, planarInput, channelOutput, filter);
+    } else {
+      isa::OpenCL::convolutionChannels< dataType >(isa::OpenCL::INTERLEAVED, nrChannels, padding, width, height, filterWidth, filterHeight, interleavedInput, channelOutput, filter);
+    }
+    for ( unsigned int channel = 0; channel < nrChannels; channel++ ) {
+      for ( unsigned int y = 0; y < height; y++ ) {
+        for ( unsigned int x = 0; x < width; x++ ) {
+          unsigned int item = (channel * output.size()) + (y * isa::utils::pad(width, padding)) + x;
+
+          if ( layout == isa::OpenCL::INTERLEAVED ) {
+            item = (y * interleavedOutputStride) + (x * nrChannels) + channel;
+          }
+          if ( !isa::utils::same(channelOutput[item], channelOutput_c[channel][(y * isa::utils::pad(width, padding)) + x]) ) {
+            wrongItems++;
+          }
+        }
+      }
+    }
+    if ( wrongItems > 0 ) {
+      std::cout << "Wrong items (" << isa::OpenCL::toString(static_cast< isa::OpenCL::ConvolutionLayout >(layout)) << " channels): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height * nrChannels) << "%)." << std::endl;
+      return 1;
+    }
+  }
+
+  // Check the streaming algorithm, with bands that do not divide the image
+  const std::string streamInputName("ConvolutionCPUStreamInput.bin");
+  const std::string streamOutputName("ConvolutionCPUStreamOutput.bin");
+  const unsigned int nrBandRows = 7;
+  std::ofstream streamInput(streamInputName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  for ( unsigned int y = 0; y < height + (filterHeight - 1); y++ ) {
+    streamInput.write(reinterpret_cast< const char * >(&(input[y * isa::utils::pad(width + (filterWidth - 1), padding)])), (width + (filterWidth - 1)) * sizeof(dataType));
+  }
+  streamInput.close();
+  try {
+    isa::OpenCL::convolutionStream< dataType >(streamInputName, streamOutputName, padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, nrBandRows, filter);
+    isa::OpenCL::MappedFile streamOutput(streamOutputName, height * width * sizeof(dataType), false);
+    const dataType * streamData = reinterpret_cast< const dataType * >(streamOutput.getData());
+
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(streamData[(y * width) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
+  } catch ( std::runtime_error & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+  std::remove(streamInputName.c_str());
+  std::remove(streamOutputName.c_str());
+  if ( wrongItems > 0 ) {
+    std::cout << "Wrong items (stream): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+    return 1;
+  }
+
+  // Check the filter bank algorithm, against one sequential run per filter
+  const unsigned int nrFilters = 4;
+  std::vector< dataType > filters = std::vector< dataType >(nrFilters * filterWidth * filterHeight);
+  std::vector< dataType > bankOutput = std::vector< dataType >(nrFilters * output.size());
+  for ( unsigned int i = 0; i < filters.size(); i++ ) {
+    filters[i] = std::rand() % 100;
+  }
+  isa::OpenCL::convolutionBank< dataType >(padding, width, height, filterWidth, filterHeight, nrFilters, nrColumnsPerTile, nrRowsPerTile, input, bankOutput, filters);
+  for ( unsigned int bankFilter = 0; bankFilter < nrFilters; bankFilter++ ) {
+    std::copy(filters.begin() + (bankFilter * filter.size()), filters.begin() + ((bankFilter + 1) * filter.size()), filter.begin());
+    isa::OpenCL::convolution< dataType >(padding, width, height, filterWidth, filterHeight, input, output_c, filter);
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(bankOutput[(bankFilter * output.size()) + (y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
+  }
+  if ( wrongItems > 0 ) {
+    std::cout << "Wrong items (bank): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height * nrFilters) << "%)." << std::endl;
+    return 1;
+  }
+
+  // Check the boundary modes, against the sequential algorithm on a copy of the image with the border written in memory
+  std::vector< dataType > image = std::vector< dataType >(output.size());
+  for ( unsigned int i = 0; i < image.size(); i++ ) {
+    image[i] = std::rand() % 1000;
+  }
+  for ( unsigned int mode = isa::OpenCL::ZERO; mode <= isa::OpenCL::WRAP; mode++ ) {
+    const isa::OpenCL::ConvolutionBoundary boundary = static_cast< isa::OpenCL::ConvolutionBoundary >(mode);
+
+    std::fill(input.begin(), input.end(), 0);
+    for ( unsigned int y = 0; y < height + (filterHeight - 1); y++ ) {
+      const int row = isa::OpenCL::getConvolutionBoundaryIndex(boundary, static_cast< int >(y) - static_cast< int >(filterHeight / 2), height);
+
+      for ( unsigned int x = 0; x < width + (filterWidth - 1); x++ ) {
+        const int column = isa::OpenCL::getConvolutionBoundaryIndex(boundary, static_cast< int >(x) - static_cast< int >(filterWidth / 2), width);
+
+        if ( row >= 0 && column >= 0 ) {
+          input[(y * isa::utils::pad(width + (filterWidth - 1), padding)) + x] = image[(row * isa::utils::pad(width, padding)) + column];
+        }
+      }
+    }
+    isa::OpenCL::convolution< dataType >(padding, width, height, filterWidth, filterHeight, input, output_c, filter);
+    std::fill(output.begin(), output.end(), 0);
+    isa::OpenCL::convolution< dataType >(boundary, padding, width, height, filterWidth, filterHeight, image, output, filter);
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(output[(y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
+    if ( wrongItems > 0 ) {
+      std::cout << "Wrong items (" << isa::OpenCL::toString(boundary) << " boundary): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+      return 1;
+    }
+  }
+  if ( isa::OpenCL::getConvolutionBoundaryIndex(isa::OpenCL::MIRROR, -1, 5) != 0 || isa::OpenCL::getConvolutionBoundaryIndex(isa::OpenCL::MIRROR, 6, 5) != 3 || isa::OpenCL::getConvolutionBoundaryIndex(isa::OpenCL::WRAP, -2, 5) != 3 || isa::OpenCL::getConvolutionBoundaryIndex(isa::OpenCL::CLAMP, 9, 5) != 4 || isa::OpenCL::getConvolutionBoundaryIndex(isa::OpenCL::ZERO, 5, 5) != -1 ) {
+    std::cout << "Wrong boundary indices." << std::endl;
+    return 1;
+  }
+
+  // Check 8 bit images, accumulated in int, and the rounding and saturation of integer results
+  std::vector< unsigned char > input8 = std::vector< unsigned char >(input.size());
+  std::vector< unsigned char > output8 = std::vector< unsigned char >(output.size());
+  std::vector< unsigned char > output8_c = std::vector< unsigned char >(output.size());
+  std::vector< unsigned char > filter8 = std::vector< unsigned char >(filter.size());
+  for ( unsigned int i = 0; i < input8.size(); i++ ) {
+    input8[i] = std::rand() % 256;
+  }
+  for ( unsigned int i = 0; i < filter8.size(); i++ ) {
+    filter8[i] = std::rand() % 4;
+  }
+  isa::OpenCL::convolution< unsigned char >(padding, width, height, filterWidth, filterHeight, input8, output8_c, filter8);
+  for ( unsigned int algorithm = 0; algorithm < 4; algorithm++ ) {
+    std::string name;
+
+    std::fill(output8.begin(), output8.end(), 0);
+    if ( algorithm == 0 ) {
+      name = "parallel";
+      isa::OpenCL::convolutionParallel< unsigned char >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input8, output8, filter8);
+    } else if ( algorithm == 1 ) {
+      name = "specialized";
+      isa::OpenCL::convolutionSpecialized< unsigned char >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input8, output8, filter8);
+    } else if ( algorithm == 2 ) {
+      name = "SIMD";
+      isa::OpenCL::convolutionSIMD< unsigned char >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input8, output8, filter8);
+    } else {
+      // FFT is not selected for integers, even when it costs nothing
+      isa::OpenCL::ConvolutionCostModel model;
+      model.setCost(isa::OpenCL::FFT, 0.0);
+      const isa::OpenCL::ConvolutionAlgorithm selected = isa::OpenCL::convolutionAuto< unsigned char >(model, padding, width, height, filterWidth, filterHeight, input8, output8, filter8);
+
+      name = "auto (" + isa::OpenCL::toString(selected) + ")";
+      if ( selected == isa::OpenCL::FFT ) {
+        std::cout << "FFT algorithm selected for 8 bit images." << std::endl;
+        return 1;
+      }
+    }
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( output8[(y * isa::utils::pad(width, padding)) + x] != output8_c[(y * isa::utils::pad(width, padding)) + x] ) {
+          wrongItems++;
+        }
+      }
+    }
+    if ( wrongItems > 0 ) {
+      std::cout << "Wrong items (8 bit " << name << "): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+      return 1;
+    }
+  }
+  if ( isa::OpenCL::convolutionAverage< unsigned char >(13, 2) != 7 || isa::OpenCL::convolutionAverage< unsigned char >(1000, 1) != 255 || isa::OpenCL::convolutionAverage< unsigned char >(-5, 1) != 0 || isa::OpenCL::convolutionAverage< short >(-7, 2) != -4 || isa::OpenCL::convolutionAverage< unsigned char >(2.5f, 1) != 2 || isa::OpenCL::convolutionAverage< unsigned char >(3.5f, 1) != 4 ) {
+    std::cout << "Wrong rounding or saturation of integer results." << std::endl;
+    return 1;
+  }
+
+  // Check the separable algorithm, using the outer product of two random filters
+  std::vector< dataType > rowFilter = std::vector< dataType >(filterWidth);
+  std::vector< dataType > columnFilter = std::vector< dataType >(filterHeight);
+  std::vector< dataType > detectedRowFilter, detectedColumnFilter;
+  for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+    rowFilter[fX] = (std::rand() % 10) + 1;
+  }
+  for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+    columnFilter[fY] = (std::rand() % 10) + 1;
+    for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+      filter[(fY * filterWidth) + fX] = columnFilter[fY] * rowFilter[fX];
+    }
+  }
+  if ( !isa::OpenCL::isSeparable(filterWidth, filterHeight, filter, detectedRowFilter, detectedColumnFilter) ) {
+    std::cout << "Separable filter not detected." << std::endl;
+    return 1;
+  }
+  isa::OpenCL::convolution< dataType >(padding, width, height, filterWidth, filterHeight, input, output_c, filter);
+  std::fill(output.begin(), output.end(), 0);
+  isa::OpenCL::convolutionSeparable< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, rowFilter, columnFilter);
+  for ( unsigned int y = 0; y < height; y++ ) {
+    for ( unsigned int x = 0; x < width; x++ ) {
+      if ( !isa::utils::same(output[(y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+        wrongItems++;
+      }
+    }
+  }
+  if ( wrongItems > 0 ) {
+    std::cout << "Wrong items (separable): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+    return 1;
+  }
+  // The factors of an 8 bit filter are integers, and both passes accumulate in int
+  std::vector< unsigned char > rowFilter8, columnFilter8;
+  for ( unsigned int fY = 0; fY < filterHeight; fY++ ) {
+    for ( unsigned int fX = 0; fX < filterWidth; fX++ ) {
+      filter8[(fY * filterWidth) + fX] = ((static_cast< unsigned int >(columnFilter[fY]) % 4) + 1) * ((static_cast< unsigned int >(rowFilter[fX]) % 4) + 1);
+    }
+  }
+  if ( !isa::OpenCL::isSeparable(filterWidth, filterHeight, filter8, rowFilter8, columnFilter8) ) {
+    std::cout << "Separable 8 bit filter not detected." << std::endl;
+    return 1;
+  }
+  isa::OpenCL::convolution< unsigned char >(padding, width, height, filterWidth, filterHeight, input8, output8_c, filter8);
+  std::fill(output8.begin(), output8.end(), 0);
+  isa::OpenCL::convolutionSeparable< unsigned char >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input8, output8, rowFilter8, columnFilter8);
+  for ( unsigned int y = 0; y < height; y++ ) {
+    for ( unsigned int x = 0; x < width; x++ ) {
+      if ( output8[(y * isa::utils::pad(width, padding)) + x] != output8_c[(y * isa::utils::pad(width, padding)) + x] ) {
+        wrongItems++;
+      }
+    }
+  }
+  if ( wrongItems > 0 ) {
+    std::cout << "Wrong items (8 bit separable): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+    return 1;
+  }
+
+  // Check the box algorithm, and its selection by the default cost model, with equal coefficients in 32 and 8 bit images
+  dataType coefficient = 0;
+  unsigned char coefficient8 = 0;
+  std::fill(filter.begin(), filter.end(), (std::rand() % 10) + 1);
+  std::fill(filter8.begin(), filter8.end(), (std::rand() % 4) + 1);
+  if ( !isa::OpenCL::isBox(filterWidth, filterHeight, filter, coefficient) || coefficient != filter[0] ) {
+    std::cout << "Box filter not detected." << std::endl;
+    return 1;
+  }
+  isa::OpenCL::convolution< dataType >(padding, width, height, filterWidth, filterHeight, input, output_c, filter);
+  for ( unsigned int algorithm = 0; algorithm < 2; algorithm++ ) {
+    std::string name;
+
+    std::fill(output.begin(), output.end(), 0);
+    if ( algorithm == 0 ) {
+      name = "box";
+      isa::OpenCL::convolutionBox< dataType >(padding, width, height, filterWidth, filterHeight, input, output, coefficient);
+    } else {
+      isa::OpenCL::ConvolutionCostModel model;
+      const isa::OpenCL::ConvolutionAlgorithm selected = isa::OpenCL::convolutionAuto< dataType >(model, padding, width, height, filterWidth, filterHeight, input, output, filter);
+
+      name = "auto (" + isa::OpenCL::toString(selected) + ")";
+      if ( filterWidth * filterHeight > 4 && selected != isa::OpenCL::BOX ) {
+        std::cout << "Box algorithm not selected." << std::endl;
+        return 1;
+      }
+    }
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(output[(y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
+    if ( wrongItems > 0 ) {
+      std::cout << "Wrong items (" << name << "): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+      return 1;
+    }
+  }
+  if ( !isa::OpenCL::isBox(filterWidth, filterHeight, filter8, coefficient8) ) {
+    std::cout << "Box filter not detected (8 bit)." << std::endl;
+    return 1;
+  }
+  isa::OpenCL::convolution< unsigned char >(padding, width, height, filterWidth, filterHeight, input8, output8_c, filter8);
+  std::fill(output8.begin(), output8.end(), 0);
+  isa::OpenCL::convolutionBox< unsigned char >(padding, width, height, filterWidth, filterHeight, input8, output8, coefficient8);
+  for ( unsigned int y = 0; y < height; y++ ) {
+    for ( unsigned int x = 0; x < width; x++ ) {
+      if ( output8[(y * isa::utils::pad(width, padding)) + x] != output8_c[(y * isa::utils::pad(width, padding)) + x] ) {
+        wrongItems++;
+      }
+    }
+  }
+  if ( wrongItems > 0 ) {
+    std::cout << "Wrong items (8 bit box): " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+    return 1;
+  }
+  std::cout << "TEST PASSED." << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,523 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+#include <utils.hpp>
+#include <Convolution.hpp>
+
+// The generator before it wrote the code in a single pass, replacing placeholders in templates
+std::string * getReferenceOpenCL(const bool local, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, const unsigned int nrFiltersPerThread, const unsigned int vectorWidth, const unsigned int inputImageStride, const unsigned int outputImageStride, const std::vector< double > & coefficients, std::string & dataType, const std::string & accumulatorType);
+// Number of non-overlapping occurrences of a pattern in the code
+unsigned int count(const std::string & code, const std::string & pattern);
+
+int main(int argc, char *argv[]) {
+  const unsigned int padding = 32;
+  const unsigned int width = 384;
+  const unsigned int height = 24;
+  const unsigned int nrBankFilters = 4;
+  long long unsigned int nrKernels = 0;
+  std::vector< std::string > dataTypes;
+  std::vector< std::string > accumulatorTypes;
+
+  dataTypes.push_back("float");
+  accumulatorTypes.push_back("float");
+  dataTypes.push_back("uchar");
+  accumulatorTypes.push_back("int");
+  dataTypes.push_back("uchar");
+  accumulatorTypes.push_back("float");
+  dataTypes.push_back("half");
+  accumulatorTypes.push_back("float");
+  // The single pass generator writes the same code as the reference for every configuration
+  for ( unsigned int type = 0; type < dataTypes.size(); type++ ) {
+    for ( unsigned int filterWidth = 3; filterWidth <= 5; filterWidth += 2 ) {
+      const unsigned int filterHeight = 3;
+
+      for ( unsigned int nrFilters = 1; nrFilters <= nrBankFilters; nrFilters *= nrBankFilters ) {
+        std::vector< double > coefficients = std::vector< double >(nrFilters * filterWidth * filterHeight);
+
+        // Every third coefficient is zero, and skipped by the constant kernels
+        for ( unsigned int i = 0; i < coefficients.size(); i++ ) {
+          coefficients[i] = (i % 3 == 0) ? 0 : (i * 0.25) - 1;
+        }
+        for ( unsigned int local = 0; local < 2; local++ ) {
+          for ( unsigned int vectorWidth = 1; vectorWidth <= 4; vectorWidth *= 2 ) {
+            for ( unsigned int nrColumnsPerBlock = 4; nrColumnsPerBlock <= padding; nrColumnsPerBlock *= 8 ) {
+              for ( unsigned int nrColumnsPerThread = 1; nrColumnsPerThread <= 3; nrColumnsPerThread += 2 ) {
+                for ( unsigned int nrRowsPerThread = 1; nrRowsPerThread <= 2; nrRowsPerThread++ ) {
+                  for ( unsigned int nrFiltersPerThread = 1; nrFiltersPerThread <= nrFilters; nrFiltersPerThread *= nrBankFilters ) {
+                    for ( unsigned int constant = 0; constant < 2; constant++ ) {
+                      std::vector< double > kernelCoefficients;
+
+                      if ( constant == 1 ) {
+                        if ( local == 1 || nrFiltersPerThread != nrFilters ) {
+                          continue;
+                        }
+                        kernelCoefficients = coefficients;
+                      }
+                      const unsigned int inputImageStride = isa::OpenCL::getInputImageSize(padding, width, height, filterWidth, filterHeight);
+                      const unsigned int outputImageStride = isa::OpenCL::getOutputImageSize(padding, width, height);
+                      std::string * reference = getReferenceOpenCL(local == 1, padding, width, height, filterWidth, filterHeight, nrFilters, nrColumnsPerBlock, 2, nrColumnsPerThread, nrRowsPerThread, nrFiltersPerThread, vectorWidth, inputImageStride, outputImageStride, kernelCoefficients, dataTypes[type], accumulatorTypes[type]);
+                      isa::OpenCL::ConvolutionConf conf;
+
+                      conf.setLocalMemory(local == 1);
+                      conf.setNrColumnsPerBlock(nrColumnsPerBlock);
+                      conf.setNrRowsPerBlock(2);
+                      conf.setNrColumnsPerThread(nrColumnsPerThread);
+                      conf.setNrRowsPerThread(nrRowsPerThread);
+                      conf.setNrFiltersPerThread(nrFiltersPerThread);
+                      conf.setVectorWidth(vectorWidth);
+                      conf.setAccumulatorType(accumulatorTypes[type]);
+                      std::string code = isa::OpenCL::getConvolutionOpenCLSource(conf, padding, width, height, filterWidth, filterHeight, nrFilters, inputImageStride, outputImageStride, dataTypes[type], kernelCoefficients);
+
+                      if ( code != *reference ) {
+                        std::cout << "Different code for " << dataTypes[type] << " " << accumulatorTypes[type] << " " << filterWidth << "x" << filterHeight << " " << nrFilters << " " << local << " " << nrColumnsPerBlock << " 2 " << nrColumnsPerThread << " " << nrRowsPerThread << " " << nrFiltersPerThread << " " << vectorWidth << " " << constant << "." << std::endl;
+                        delete reference;
+                        return 1;
+                      }
+                      delete reference;
+                      nrKernels++;
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // The compatibility overload returning a pointer produces the same code
+  isa::OpenCL::ConvolutionConf conf;
+  conf.setLocalMemory(true);
+  conf.setNrColumnsPerBlock(8);
+  conf.setNrRowsPerBlock(4);
+  conf.setNrColumnsPerThread(2);
+  std::string * code = isa::OpenCL::getConvolutionOpenCL(conf.getLocalMemory(), padding, width, height, 7, 5, conf.getNrColumnsPerBlock(), conf.getNrRowsPerBlock(), conf.getNrColumnsPerThread(), conf.getNrRowsPerThread(), dataTypes[0]);
+  if ( *code != isa::OpenCL::getConvolutionOpenCLSource(conf, padding, width, height, 7, 5, 1, isa::OpenCL::getInputImageSize(padding, width, height, 7, 5), isa::OpenCL::getOutputImageSize(padding, width, height), dataTypes[0]) ) {
+    std::cout << "Different code from the overload returning a pointer." << std::endl;
+    delete code;
+    return 1;
+  }
+  delete code;
+
+  // Sizes not divided by the tiles guard the loads and stores of the last tiles, divided sizes do not
+  const unsigned int tailWidth = 100;
+  const unsigned int tailHeight = 37;
+  for ( unsigned int local = 0; local < 2; local++ ) {
+    for ( unsigned int vectorWidth = 1; vectorWidth <= 2; vectorWidth *= 2 ) {
+      isa::OpenCL::ConvolutionConf tailConf;
+
+      tailConf.setLocalMemory(local == 1);
+      tailConf.setNrColumnsPerBlock(8);
+      tailConf.setNrRowsPerBlock(4);
+      tailConf.setNrColumnsPerThread(2);
+      tailConf.setNrRowsPerThread(2);
+      tailConf.setVectorWidth(vectorWidth);
+      std::string tail = isa::OpenCL::getConvolutionOpenCLSource(tailConf, padding, tailWidth, tailHeight, 3, 3, 1, isa::OpenCL::getInputImageSize(padding, tailWidth, tailHeight, 3, 3), isa::OpenCL::getOutputImageSize(padding, tailWidth, tailHeight), dataTypes[0]);
+      std::string full = isa::OpenCL::getConvolutionOpenCLSource(tailConf, padding, width, height, 3, 3, 1, isa::OpenCL::getInputImageSize(padding, width, height, 3, 3), isa::OpenCL::getOutputImageSize(padding, width, height), dataTypes[0]);
+
+      if ( count(tail, "const bool interior") != 1 || count(tail, "loadInput(") == 0 || count(tail, "< " + isa::utils::toString(tailHeight)) == 0 || count(tail, "< " + isa::utils::toString(tailWidth)) == 0 ) {
+        std::cout << "Missing tail guards for " << local << " " << vectorWidth << "." << std::endl;
+        return 1;
+      } else if ( count(full, "interior") != 0 || count(full, "loadInput(") != 0 ) {
+        std::cout << "Tail guards in a divided image for " << local << " " << vectorWidth << "." << std::endl;
+        return 1;
+      }
+      nrKernels += 2;
+    }
+  }
+
+  // Every boundary mode writes its own code, and all but VALID map the indices outside the image
+  std::vector< std::string > boundaries;
+  for ( unsigned int boundary = isa::OpenCL::VALID; boundary <= isa::OpenCL::WRAP; boundary++ ) {
+    isa::OpenCL::ConvolutionConf boundaryConf;
+
+    boundaryConf.setLocalMemory(true);
+    boundaryConf.setNrColumnsPerBlock(8);
+    boundaryConf.setNrRowsPerBlock(4);
+    boundaryConf.setNrColumnsPerThread(2);
+    boundaryConf.setBoundary(static_cast< isa::OpenCL::ConvolutionBoundary >(boundary));
+    boundaries.push_back(isa::OpenCL::getConvolutionOpenCLSource(boundaryConf, padding, width, height, 3, 3, 1, isa::OpenCL::getInputImageSize(padding, width, height, 3, 3), isa::OpenCL::getOutputImageSize(padding, width, height), dataTypes[0]));
+    if ( boundary == isa::OpenCL::VALID ) {
+      if ( count(boundaries.back(), "getBoundaryIndex") != 0 ) {
+        std::cout << "Boundary mapping in a VALID kernel." << std::endl;
+        return 1;
+      }
+    } else if ( count(boundaries.back(), "getBoundaryIndex") == 0 || count(boundaries.back(), "const bool interior") != 1 ) {
+      std::cout << "Missing boundary mapping for mode " << boundary << "." << std::endl;
+      return 1;
+    }
+    for ( unsigned int previous = 0; previous < boundaries.size() - 1; previous++ ) {
+      if ( boundaries[previous] == boundaries.back() ) {
+        std::cout << "Same code for the boundary modes " << previous << " and " << boundary << "." << std::endl;
+        return 1;
+      }
+    }
+    nrKernels++;
+  }
+
+  // The sliding window loads only the rows and columns of the local tile that some accumulator uses
+  for ( unsigned int filterHeight = 1; filterHeight <= 5; filterHeight += 2 ) {
+    for ( unsigned int nrRowsPerBlock = 2; nrRowsPerBlock <= 4; nrRowsPerBlock *= 2 ) {
+      for ( unsigned int nrRowsPerThread = 1; nrRowsPerThread <= 3; nrRowsPerThread++ ) {
+        for ( unsigned int nrColumnsPerThread = 1; nrColumnsPerThread <= 2; nrColumnsPerThread++ ) {
+          const unsigned int filterWidth = 3;
+          const unsigned int windowRows = filterHeight + ((nrRowsPerThread - 1) * std::min(nrRowsPerBlock, filterHeight));
+          unsigned int windowColumns = 0;
+          isa::OpenCL::ConvolutionConf windowConf;
+
+          windowConf.setLocalMemory(true);
+          windowConf.setNrColumnsPerBlock(4);
+          windowConf.setNrRowsPerBlock(nrRowsPerBlock);
+          windowConf.setNrColumnsPerThread(nrColumnsPerThread);
+          windowConf.setNrRowsPerThread(nrRowsPerThread);
+          windowConf.setWindow(true);
+          for ( unsigned int column = 0; column < ((nrColumnsPerThread - 1) * 4) + filterWidth; column++ ) {
+            for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+              if ( column >= x * 4 && column - (x * 4) < filterWidth ) {
+                windowColumns++;
+                break;
+              }
+            }
+          }
+          std::string window = isa::OpenCL::getConvolutionOpenCLSource(windowConf, padding, width, height, filterWidth, filterHeight, 1, isa::OpenCL::getInputImageSize(padding, width, height, filterWidth, filterHeight), isa::OpenCL::getOutputImageSize(padding, width, height), dataTypes[0]);
+
+          if ( count(window, " = localInput[") != windowRows * windowColumns ) {
+            std::cout << "Window loads for " << filterWidth << "x" << filterHeight << " " << nrRowsPerBlock << " " << nrColumnsPerThread << " " << nrRowsPerThread << ": " << count(window, " = localInput[") << " instead of " << windowRows * windowColumns << "." << std::endl;
+            return 1;
+          }
+          nrKernels++;
+        }
+      }
+    }
+  }
+  // The filters per work-item divide the filter bank
+  try {
+    isa::OpenCL::ConvolutionConf bankConf;
+
+    bankConf.setNrFiltersPerThread(2);
+    isa::OpenCL::getConvolutionOpenCLSource(bankConf, padding, width, height, 3, 3, 3, isa::OpenCL::getInputImageSize(padding, width, height, 3, 3), isa::OpenCL::getOutputImageSize(padding, width, height), dataTypes[0]);
+    std::cout << "Filters per work-item not dividing the filter bank." << std::endl;
+    return 1;
+  } catch ( std::invalid_argument & err ) {
+  }
+  // The sliding window needs local memory
+  try {
+    isa::OpenCL::ConvolutionConf windowConf;
+
+    windowConf.setWindow(true);
+    isa::OpenCL::getConvolutionOpenCLSource(windowConf, padding, width, height, 3, 3, 1, isa::OpenCL::getInputImageSize(padding, width, height, 3, 3), isa::OpenCL::getOutputImageSize(padding, width, height), dataTypes[0]);
+    std::cout << "Sliding window without local memory." << std::endl;
+    return 1;
+  } catch ( std::invalid_argument & err ) {
+  }
+
+  std::cout << "Kernels compared: " << nrKernels << "." << std::endl;
+  std::cout << "TEST PASSED." << std::endl;
+
+  return 0;
+}
+
+std::string * getReferenceOpenCL(const bool local, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, const unsigned int nrFilters, const unsigned int nrColumnsPerBlock, const unsigned int nrRowsPerBlock, const unsigned int nrColumnsPerThread, const unsigned int nrRowsPerThread, const unsigned int nrFiltersPerThread, const unsigned int vectorWidth, const unsigned int inputImageStride, const unsigned int outputImageStride, const std::vector< double > & coefficients, std::string & dataType, const std::string & accumulatorType) {
+  const bool constant = !coefficients.empty();
+  const bool integerAccumulator = accumulatorType != "float" && accumulatorType != "double";
+  if ( integerAccumulator && (dataType == "float" || dataType == "double" || dataType == "half") ) {
+    throw std::invalid_argument("Floating point data cannot be accumulated in " + accumulatorType + ".");
+  } else if ( accumulatorType == "half" ) {
+    throw std::invalid_argument("Half precision data is accumulated in float.");
+  } else if ( constant && nrFiltersPerThread != nrFilters ) {
+    throw std::invalid_argument("Constant coefficients need all the filters of the bank in every work-item.");
+  } else if ( constant && coefficients.size() != static_cast< size_t >(nrFilters) * filterWidth * filterHeight ) {
+    throw std::invalid_argument("The number of coefficients does not match the filter bank.");
+  }
+  std::string * code = new std::string();
+  // Columns computed by a work-group, and the local index of the first column of a work-item
+  const unsigned int tileWidth = nrColumnsPerBlock * nrColumnsPerThread * vectorWidth;
+  std::string accumulatorVectorType = accumulatorType;
+  std::string localX_s = "get_local_id(0)";
+  if ( vectorWidth > 1 ) {
+    accumulatorVectorType += isa::utils::toString(vectorWidth);
+    localX_s = "(get_local_id(0) * " + isa::utils::toString(vectorWidth) + ")";
+  }
+  // Half precision is a storage format only, so the tile in local memory is converted already
+  std::string localType = dataType;
+  if ( dataType == "half" ) {
+    localType = accumulatorType;
+  }
+
+  // Begin kernel's template
+  // A bank of filters can exceed the 64 KB guaranteed for __constant memory
+  if ( nrFilters > 1 ) {
+    *code = "__kernel void convolution(__global const " + dataType + " * const restrict input, __global " + dataType + " * const restrict output, __global const " + dataType + " * const restrict filter) {\n";
+  } else {
+    *code = "__kernel void convolution(__global const " + dataType + " * const restrict input, __global " + dataType + " * const restrict output, __constant const " + dataType + " * const restrict filter) {\n";
+  }
+  *code += "const unsigned int image = get_group_id(2);\n";
+  if ( local ) {
+    *code += "const unsigned int x = (get_group_id(0) * " + isa::utils::toString(tileWidth) + ");\n"
+      "const unsigned int y = (get_group_id(1) * " + isa::utils::toString(nrRowsPerBlock * nrRowsPerThread) + ");\n"
+      "unsigned int fX = 0;\n"
+      "unsigned int fY = 0;\n";
+    if ( nrColumnsPerBlock < padding ) {
+      *code += "__local " + localType + " localInput[" + isa::utils::toString(isa::utils::pad(tileWidth + (filterWidth - 1), padding) * ((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1))) + "];\n";
+    } else {
+      *code += "__local " + localType + " localInput[" + isa::utils::toString((tileWidth + (filterWidth - 1)) * ((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1))) + "];\n";
+    }
+  } else {
+    *code += "const unsigned int x = (get_group_id(0) * " + isa::utils::toString(tileWidth) + ") + " + localX_s + ";\n"
+      "const unsigned int y = (get_group_id(1) * " + isa::utils::toString(nrRowsPerBlock * nrRowsPerThread) + ") + get_local_id(1);\n";
+  }
+  if ( local ) {
+    *code += "fY = get_local_id(1);\n"
+      "fX = get_local_id(0);\n"
+      "<%LOAD%>"
+      "barrier(CLK_LOCAL_MEM_FENCE);\n";
+  }
+  // The input is reused by all the filters of the bank, nrFiltersPerThread at a time
+  if ( nrFilters > nrFiltersPerThread ) {
+    *code += "for ( unsigned int filterBlock = 0; filterBlock < " + isa::utils::toString(nrFilters) + "; filterBlock += " + isa::utils::toString(nrFiltersPerThread) + " ) {\n";
+  } else {
+    *code += "{\n"
+      "const unsigned int filterBlock = 0;\n";
+  }
+  *code += "<%DEF_SUMS%>";
+  if ( local ) {
+    *code += "fY = get_local_id(1);\n"
+      "fX = " + localX_s + ";\n"
+      "<%SUMS%>";
+  } else if ( constant ) {
+    *code += "<%SUMS%>";
+  } else {
+    *code += "for ( unsigned int fY = y; fY < y + " + isa::utils::toString(filterHeight) + "; fY++ ) {\n"
+      "for ( unsigned int fX = x; fX < x + " + isa::utils::toString(filterWidth) + "; fX++ ) {\n"
+      "<%SUMS%>"
+      "}\n"
+      "}\n";
+  }
+  *code += "<%AVERAGE%>"
+    "<%STORE%>"
+    "}\n"
+    "}\n";
+  std::string defSumsTemplate = accumulatorVectorType + " sumX<%XNUM%>Y<%YNUM%>F<%FNUM%> = 0;\n";
+  std::string loadTemplate;
+  std::string sumsTemplate;
+  std::string localStride_s = isa::utils::toString(tileWidth + (filterWidth - 1));
+  if ( local && nrColumnsPerBlock < padding ) {
+    localStride_s = isa::utils::toString(isa::utils::pad(tileWidth + (filterWidth - 1), padding));
+  }
+  const std::string localIndex_s = "((fY + <%YOFFSET%>) * " + localStride_s + ") + (fX + <%XOFFSET%>)";
+  std::string input_s;
+  std::string filter_s;
+  // Vectors are loaded and stored with vloadN and vstoreN, that only need the alignment of the elements
+  if ( local ) {
+    loadTemplate = "localInput[" + localIndex_s + "] = " + isa::OpenCL::getConvolutionLoad("input", "(image * " + isa::utils::toString(inputImageStride) + ") + ((y + fY + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding)) + ") + (x + fX + <%XOFFSET%>)", 1, dataType, localType) + ";\n";
+    input_s = isa::OpenCL::getConvolutionLoad("localInput", localIndex_s, vectorWidth, localType, accumulatorType);
+    filter_s = isa::OpenCL::getConvolutionLoad("filter", "((filterBlock + <%FNUM%>) * " + isa::utils::toString(filterWidth * filterHeight) + ") + ((fY - get_local_id(1)) * " + isa::utils::toString(filterWidth) + ") + (fX - " + localX_s + ")", 1, dataType, accumulatorType);
+  } else if ( constant ) {
+    input_s = isa::OpenCL::getConvolutionLoad("input", "(image * " + isa::utils::toString(inputImageStride) + ") + ((y + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding)) + ") + (x + <%XOFFSET%>)", vectorWidth, dataType, accumulatorType);
+  } else {
+    input_s = isa::OpenCL::getConvolutionLoad("input", "(image * " + isa::utils::toString(inputImageStride) + ") + ((fY + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width + (filterWidth - 1), padding)) + ") + (fX + <%XOFFSET%>)", vectorWidth, dataType, accumulatorType);
+    filter_s = isa::OpenCL::getConvolutionLoad("filter", "((filterBlock + <%FNUM%>) * " + isa::utils::toString(filterWidth * filterHeight) + ") + ((fY - y) * " + isa::utils::toString(filterWidth) + ") + (fX - x)", 1, dataType, accumulatorType);
+  }
+  if ( constant ) {
+    filter_s = "<%COEFFICIENT%>";
+  }
+  sumsTemplate = "sumX<%XNUM%>Y<%YNUM%>F<%FNUM%> += " + input_s + " * " + filter_s + ";\n";
+  std::string loadYIncTemplate = "fY += " + isa::utils::toString(nrRowsPerBlock * nrRowsPerThread) + ";\n";
+  std::string loadXIncTemplate = "fX += " + isa::utils::toString(nrColumnsPerBlock * nrColumnsPerThread) + ";\n";
+  std::string xResetTemplate = "fX = get_local_id(0);\n";
+  std::string sumYIncTemplate = "fY++;\n";
+  std::string sumXIncTemplate = "fX++;\n";
+  std::string sumXResetTemplate = "fX = " + localX_s + ";\n";
+  std::string averageTemplate;
+  if ( integerAccumulator ) {
+    // Halves are rounded away from zero, like convolutionAverage
+    averageTemplate = "sumX<%XNUM%>Y<%YNUM%>F<%FNUM%> = (sumX<%XNUM%>Y<%YNUM%>F<%FNUM%> + select((" + accumulatorVectorType + ")(-" + isa::utils::toString((filterWidth * filterHeight) / 2) + "), (" + accumulatorVectorType + ")(" + isa::utils::toString((filterWidth * filterHeight) / 2) + "), sumX<%XNUM%>Y<%YNUM%>F<%FNUM%> >= 0)) / " + isa::utils::toString(filterWidth * filterHeight) + ";\n";
+  } else {
+    averageTemplate = "sumX<%XNUM%>Y<%YNUM%>F<%FNUM%> *= " + isa::OpenCL::getConvolutionLiteral(1.0 / (filterWidth * filterHeight), accumulatorType) + ";\n";
+  }
+  std::string storeTemplate;
+  std::string outputIndex_s;
+  if ( local ) {
+    outputIndex_s = "(((image * " + isa::utils::toString(nrFilters) + ") + filterBlock + <%FNUM%>) * " + isa::utils::toString(outputImageStride) + ") + ((y + get_local_id(1) + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width, padding)) + ") + (x + " + localX_s + " + <%XOFFSET%>)";
+  } else {
+    outputIndex_s = "(((image * " + isa::utils::toString(nrFilters) + ") + filterBlock + <%FNUM%>) * " + isa::utils::toString(outputImageStride) + ") + ((y + <%YOFFSET%>) * " + isa::utils::toString(isa::utils::pad(width, padding)) + ") + (x + <%XOFFSET%>)";
+  }
+  storeTemplate = isa::OpenCL::getConvolutionStore("sumX<%XNUM%>Y<%YNUM%>F<%FNUM%>", "output", outputIndex_s, vectorWidth, dataType, accumulatorType);
+  // End kernel's template
+
+  std::string * defSums_s = new std::string();
+  std::string * load_s = new std::string();
+  std::string * sums_s = new std::string();
+  std::string * average_s = new std::string();
+  std::string * store_s = new std::string();
+
+  for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+    std::string y_s = isa::utils::toString(y);
+    std::string yOffset_s = isa::utils::toString(y * nrRowsPerBlock);
+
+    for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+      std::string x_s = isa::utils::toString(x);
+      std::string xOffset_s = isa::utils::toString(x * nrColumnsPerBlock * vectorWidth);
+
+      for ( unsigned int f = 0; f < nrFiltersPerThread; f++ ) {
+        std::string f_s = isa::utils::toString(f);
+        std::string * temp_s = 0;
+
+        temp_s = isa::utils::replace(&defSumsTemplate, "<%XNUM%>", x_s);
+        temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
+        temp_s = isa::utils::replace(temp_s, "<%FNUM%>", f_s, true);
+        defSums_s->append(*temp_s);
+        delete temp_s;
+        if ( !local && !constant ) {
+          temp_s = isa::utils::replace(&sumsTemplate, "<%XNUM%>", x_s);
+          temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
+          temp_s = isa::utils::replace(temp_s, "<%FNUM%>", f_s, true);
+          temp_s = isa::utils::replace(temp_s, "<%XOFFSET%>", xOffset_s, true);
+          temp_s = isa::utils::replace(temp_s, "<%YOFFSET%>", yOffset_s, true);
+          sums_s->append(*temp_s);
+          delete temp_s;
+        }
+        temp_s = isa::utils::replace(&averageTemplate, "<%XNUM%>", x_s);
+        temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
+        temp_s = isa::utils::replace(temp_s, "<%FNUM%>", f_s, true);
+        average_s->append(*temp_s);
+        delete temp_s;
+        temp_s = isa::utils::replace(&storeTemplate, "<%XNUM%>", x_s);
+        temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
+        temp_s = isa::utils::replace(temp_s, "<%FNUM%>", f_s, true);
+        temp_s = isa::utils::replace(temp_s, "<%XOFFSET%>", xOffset_s, true);
+        temp_s = isa::utils::replace(temp_s, "<%YOFFSET%>", yOffset_s, true);
+        store_s->append(*temp_s);
+        delete temp_s;
+      }
+    }
+  }
+  
+  for ( unsigned int j = 0; j < static_cast< unsigned int >(std::ceil(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) / static_cast< float >(nrRowsPerBlock * nrRowsPerThread))); j++ ) {
+    const unsigned int rows = (nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1);
+
+    for ( unsigned int i = 0; i < static_cast< unsigned int >(std::ceil((tileWidth + (filterWidth - 1)) / static_cast< float >(nrColumnsPerBlock * nrColumnsPerThread))); i++ ) {
+      const unsigned int columns = tileWidth + (filterWidth - 1);
+
+      for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+        std::string yOffset_s = isa::utils::toString(y * nrRowsPerBlock);
+
+        for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+          std::string xOffset_s = isa::utils::toString(x * nrColumnsPerBlock);
+          std::string * temp_s = new std::string();
+
+          if ( (j == static_cast< unsigned int >(std::ceil(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) / static_cast< float >(nrRowsPerBlock * nrRowsPerThread))) - 1) && (i == static_cast< unsigned int >(std::ceil((tileWidth + (filterWidth - 1)) / static_cast< float >(nrColumnsPerBlock * nrColumnsPerThread))) - 1) ){
+            temp_s->append("if ( (fY + <%YOFFSET%>) < " + isa::utils::toString(rows) + " && (fX + <%XOFFSET%>) < " + isa::utils::toString(columns) + " ) {\n" + loadTemplate + "}\n");
+          } else if ( j == static_cast< unsigned int >(std::ceil(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) / static_cast< float >(nrRowsPerBlock * nrRowsPerThread))) - 1 ) {
+            temp_s->append("if ( (fY + <%YOFFSET%>) < " + isa::utils::toString(rows) + " ) {\n" + loadTemplate + "}\n");
+          } else if ( i == static_cast< unsigned int >(std::ceil((tileWidth + (filterWidth - 1)) / static_cast< float >(nrColumnsPerBlock * nrColumnsPerThread))) - 1 ) {
+            temp_s->append("if ( (fX + <%XOFFSET%>) < " + isa::utils::toString(columns) + " ) {\n" + loadTemplate + "}\n");
+          } else {
+            temp_s->append(loadTemplate);
+          }
+          temp_s = isa::utils::replace(temp_s, "<%XOFFSET%>", xOffset_s, true);
+          temp_s = isa::utils::replace(temp_s, "<%YOFFSET%>", yOffset_s, true);
+          load_s->append(*temp_s);
+          delete temp_s;
+        }
+      }
+      if ( i != static_cast< unsigned int >(std::ceil((tileWidth + (filterWidth - 1)) / static_cast< float >(nrColumnsPerBlock * nrColumnsPerThread))) - 1 ) {
+        load_s->append(loadXIncTemplate);
+      }
+    }
+    if ( j != static_cast< unsigned int >(std::ceil(((nrRowsPerBlock * nrRowsPerThread) + (filterHeight - 1)) / static_cast< float >(nrRowsPerBlock * nrRowsPerThread))) - 1 ) {
+      load_s->append(loadYIncTemplate);
+      load_s->append(xResetTemplate);
+    }
+  }
+
+  // With constant coefficients every tap has its own offsets, instead of moving fX and fY
+  if ( local || constant ) {
+    for ( unsigned int j = 0; j < filterHeight; j++ ) {
+      for ( unsigned int i = 0; i < filterWidth; i++ ) {
+        for ( unsigned int y = 0; y < nrRowsPerThread; y++ ) {
+          std::string y_s = isa::utils::toString(y);
+          std::string yOffset_s = isa::utils::toString(y * nrRowsPerBlock);
+
+          if ( constant ) {
+            yOffset_s = isa::utils::toString((y * nrRowsPerBlock) + j);
+          }
+          for ( unsigned int x = 0; x < nrColumnsPerThread; x++ ) {
+            std::string x_s = isa::utils::toString(x);
+            std::string xOffset_s = isa::utils::toString(x * nrColumnsPerBlock * vectorWidth);
+
+            if ( constant ) {
+              xOffset_s = isa::utils::toString((x * nrColumnsPerBlock * vectorWidth) + i);
+            }
+            for ( unsigned int f = 0; f < nrFiltersPerThread; f++ ) {
+              std::string f_s = isa::utils::toString(f);
+              std::string * temp_s = 0;
+
+              if ( constant && coefficients[(((f * filterHeight) + j) * filterWidth) + i] == 0 ) {
+                continue;
+              }
+              temp_s = isa::utils::replace(&sumsTemplate, "<%XNUM%>", x_s);
+              temp_s = isa::utils::replace(temp_s, "<%YNUM%>", y_s, true);
+              temp_s = isa::utils::replace(temp_s, "<%FNUM%>", f_s, true);
+              temp_s = isa::utils::replace(temp_s, "<%XOFFSET%>", xOffset_s, true);
+              temp_s = isa::utils::replace(temp_s, "<%YOFFSET%>", yOffset_s, true);
+              if ( constant ) {
+                temp_s = isa::utils::replace(temp_s, "<%COEFFICIENT%>", isa::OpenCL::getConvolutionLiteral(coefficients[(((f * filterHeight) + j) * filterWidth) + i], accumulatorType), true);
+              }
+              sums_s->append(*temp_s);
+              delete temp_s;
+            }
+          }
+        }
+        if ( !constant && i != filterWidth - 1 ) {
+          sums_s->append(sumXIncTemplate);
+        }
+      }
+      if ( !constant && j != filterHeight - 1 ) {
+        sums_s->append(sumYIncTemplate);
+        sums_s->append(sumXResetTemplate);
+      }
+    }
+  }
+
+  code = isa::utils::replace(code, "<%DEF_SUMS%>", *defSums_s, true);
+  code = isa::utils::replace(code, "<%LOAD%>", *load_s, true);
+  code = isa::utils::replace(code, "<%SUMS%>", *sums_s, true);
+  code = isa::utils::replace(code, "<%AVERAGE%>", *average_s, true);
+  code = isa::utils::replace(code, "<%STORE%>", *store_s, true);
+  delete defSums_s;
+  delete load_s;
+  delete sums_s;
+  delete average_s;
+  delete store_s;
+
+  return code;
+}
+
+unsigned int count(const std::string & code, const std::string & pattern) {
+  unsigned int occurrences = 0;
+
+  for ( size_t position = code.find(pattern); position != std::string::npos; position = code.find(pattern, position + pattern.size()) ) {
+    occurrences++;
+  }
+  return occurrences;
+}
@@ -0,0 +1,129 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <set>
+#include <cstdlib>
+#include <ctime>
+
+#include <Convolution.hpp>
+#include <Search.hpp>
+
+
+int main(int argc, char *argv[]) {
+  const unsigned int width = 256;
+  const unsigned int height = 64;
+  const unsigned int filterWidth = 5;
+  const unsigned int filterHeight = 5;
+  const unsigned int nrFilters = 4;
+  const unsigned int maxItems = 16;
+  const std::string typeName("float");
+  std::vector< std::string > strategies;
+
+  std::srand(std::time(0));
+  std::vector< isa::OpenCL::ConvolutionConf > space = isa::OpenCL::getConvolutionSpace(true, width, height, nrFilters, 32, 16, 256, 16, 128, 16, maxItems, 4);
+  if ( space.empty() ) {
+    std::cout << "Empty search space." << std::endl;
+    return 1;
+  }
+  // The tiles need not divide the image, but no work-item has a whole column or row of elements outside it
+  unsigned int nrTails = 0;
+  for ( std::vector< isa::OpenCL::ConvolutionConf >::const_iterator conf = space.begin(); conf != space.end(); ++conf ) {
+    if ( nrFilters % conf->getNrFiltersPerThread() != 0 ) {
+      std::cout << "Configuration not dividing the filters: " << conf->print() << "." << std::endl;
+      return 1;
+    } else if ( conf->getNrColumnsPerBlock() * (conf->getNrColumnsPerThread() - 1) * conf->getVectorWidth() >= width || conf->getNrRowsPerBlock() * (conf->getNrRowsPerThread() - 1) >= height ) {
+      std::cout << "Configuration with idle elements: " << conf->print() << "." << std::endl;
+      return 1;
+    }
+    if ( isa::OpenCL::getConvolutionTailFraction(*conf, width, height) > 0.0 ) {
+      nrTails++;
+    }
+  }
+  if ( nrTails == 0 || nrTails == space.size() ) {
+    std::cout << "Wrong number of configurations with tail work-groups: " << nrTails << "." << std::endl;
+    return 1;
+  }
+
+  // A device with 4 KB of local memory rejects the largest tiles
+  const unsigned int spaceSize = space.size();
+  const unsigned int nrPruned = isa::OpenCL::pruneConvolutionSpace(space, false, 0, filterWidth, filterHeight, typeName, 4096, 256, maxItems);
+  if ( nrPruned == 0 || space.size() + nrPruned != spaceSize ) {
+    std::cout << "Wrong number of pruned configurations: " << nrPruned << "." << std::endl;
+    return 1;
+  }
+  for ( std::vector< isa::OpenCL::ConvolutionConf >::const_iterator conf = space.begin(); conf != space.end(); ++conf ) {
+    if ( isa::OpenCL::getConvolutionLocalMemory(*conf, false, 0, filterWidth, filterHeight, typeName) > 4096 || isa::OpenCL::getConvolutionRegisters(*conf) > maxItems ) {
+      std::cout << "Configuration over the device limits: " << conf->print() << "." << std::endl;
+      return 1;
+    }
+  }
+  std::vector< isa::OpenCL::ConvolutionConf > empty = space;
+  isa::OpenCL::pruneConvolutionSpace(empty, false, 0, filterWidth, filterHeight, typeName, 0, 256, maxItems);
+  if ( !empty.empty() ) {
+    std::cout << "Configurations using local memory on a device without it." << std::endl;
+    return 1;
+  }
+  // Half precision is converted to the accumulator type in local memory
+  for ( std::vector< isa::OpenCL::ConvolutionConf >::const_iterator conf = space.begin(); conf != space.end(); ++conf ) {
+    if ( isa::OpenCL::getConvolutionLocalMemory(*conf, false, 0, filterWidth, filterHeight, "half") != isa::OpenCL::getConvolutionLocalMemory(*conf, false, 0, filterWidth, filterHeight, typeName) ) {
+      std::cout << "Wrong local memory for half precision: " << conf->print() << "." << std::endl;
+      return 1;
+    }
+  }
+
+  // Every strategy proposes each configuration exactly once
+  strategies.push_back("exhaustive");
+  strategies.push_back("random");
+  strategies.push_back("annealing");
+  strategies.push_back("model");
+  for ( std::vector< std::string >::const_iterator name = strategies.begin(); name != strategies.end(); ++name ) {
+    isa::OpenCL::SearchStrategy * strategy = isa::OpenCL::getSearchStrategy(*name, space, filterWidth, filterHeight);
+    isa::OpenCL::ConvolutionConf conf;
+    std::set< std::string > proposed;
+
+    while ( strategy->next(conf) ) {
+      if ( !proposed.insert(conf.print()).second ) {
+        std::cout << "Configuration proposed twice by " << *name << ": " << conf.print() << "." << std::endl;
+        return 1;
+      }
+      // Fake performance, higher for more work per item
+      strategy->report(conf.getNrColumnsPerThread() * conf.getNrRowsPerThread() * conf.getNrFiltersPerThread());
+    }
+    delete strategy;
+    if ( proposed.size() != space.size() ) {
+      std::cout << "Wrong number of configurations proposed by " << *name << ": " << proposed.size() << "." << std::endl;
+      return 1;
+    }
+  }
+
+  // The model starts from the configuration with the least traffic
+  isa::OpenCL::SearchStrategy * model = isa::OpenCL::getSearchStrategy("model", space, filterWidth, filterHeight);
+  isa::OpenCL::ConvolutionConf first;
+  model->next(first);
+  for ( std::vector< isa::OpenCL::ConvolutionConf >::const_iterator conf = space.begin(); conf != space.end(); ++conf ) {
+    if ( isa::OpenCL::getConvolutionTraffic(*conf, filterWidth, filterHeight) < isa::OpenCL::getConvolutionTraffic(first, filterWidth, filterHeight) ) {
+      std::cout << "Wrong first configuration for the model: " << first.print() << "." << std::endl;
+      return 1;
+    }
+  }
+  delete model;
+
+  std::cout << "TEST PASSED." << std::endl;
+
+  return 0;
+}
+
@@ -0,0 +1,122 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <exception>
+#include <stdexcept>
+
+#include <ArgumentList.hpp>
+#include <Convolution.hpp>
+#include <TuningDatabase.hpp>
+
+
+int main(int argc, char *argv[]) {
+  std::string fileName;
+  std::string device("Test Device 1.0");
+  std::string dataType("float");
+
+  try {
+    isa::utils::ArgumentList args(argc, argv);
+    fileName = args.getSwitchArgument< std::string >("-database");
+  } catch  ( isa::utils::SwitchNotFound &err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  } catch ( std::exception &err ) {
+    std::cerr << "Usage: " << argv[0] << " -database ..." << std::endl;
+    return 1;
+  }
+
+  // Two configurations for 1024x1024 with a 3x3 filter, only the fastest is kept
+  isa::OpenCL::TuningDatabase database;
+  isa::OpenCL::TuningEntry entry;
+  entry.device = device;
+  entry.dataType = dataType;
+  entry.width = 1024;
+  entry.height = 1024;
+  entry.filterWidth = 3;
+  entry.filterHeight = 3;
+  entry.conf.setNrColumnsPerBlock(32);
+  entry.conf.setNrRowsPerBlock(4);
+  entry.gflops = 10.0;
+  database.insert(entry);
+  entry.conf.setNrColumnsPerThread(2);
+  entry.conf.setVectorWidth(2);
+  entry.gflops = 20.0;
+  database.insert(entry);
+  // A configuration for 256x256 with a 7x7 filter
+  entry.width = 256;
+  entry.height = 256;
+  entry.filterWidth = 7;
+  entry.filterHeight = 7;
+  entry.conf.setLocalMemory(true);
+  entry.conf.setNrColumnsPerBlock(16);
+  entry.conf.setNrRowsPerBlock(16);
+  entry.conf.setNrColumnsPerThread(1);
+  entry.conf.setVectorWidth(1);
+  entry.conf.setWindow(true);
+  entry.conf.setBoundary(isa::OpenCL::MIRROR);
+  entry.conf.setAccumulatorType("double");
+  entry.gflops = 15.0;
+  database.insert(entry);
+  if ( database.getNrEntries() != 2 ) {
+    std::cout << "Wrong number of entries: " << database.getNrEntries() << "." << std::endl;
+    return 1;
+  }
+
+  // The database survives a round trip through the file
+  isa::OpenCL::TuningDatabase loaded;
+  try {
+    database.write(fileName);
+    loaded.read(fileName);
+  } catch ( std::runtime_error & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+  if ( loaded.getNrEntries() != database.getNrEntries() ) {
+    std::cout << "Wrong number of entries after reading: " << loaded.getNrEntries() << "." << std::endl;
+    return 1;
+  }
+
+  // Exact match
+  isa::OpenCL::ConvolutionConf conf = loaded.getConf(device, dataType, 1024, 1024, 3, 3, 1, false);
+  if ( conf.getLocalMemory() || conf.getNrColumnsPerBlock() != 32 || conf.getNrRowsPerBlock() != 4 || conf.getNrColumnsPerThread() != 2 || conf.getVectorWidth() != 2 || conf.getWindow() || conf.getBoundary() != isa::OpenCL::VALID || !conf.getAccumulatorType().empty() ) {
+    std::cout << "Wrong configuration for an exact match: " << conf.print() << "." << std::endl;
+    return 1;
+  }
+  // Nearest neighbour
+  conf = loaded.getConf(device, dataType, 320, 320, 5, 5, 1, false);
+  if ( !conf.getLocalMemory() || conf.getNrColumnsPerBlock() != 16 || !conf.getWindow() || conf.getBoundary() != isa::OpenCL::MIRROR || conf.getAccumulatorType() != "double" ) {
+    std::cout << "Wrong configuration for the nearest neighbour: " << conf.print() << "." << std::endl;
+    return 1;
+  }
+  // The nearest neighbour does not divide 1008, and is used with tail work-groups
+  conf = loaded.getConf(device, dataType, 1008, 1008, 3, 3, 1, false);
+  if ( conf.getLocalMemory() || conf.getNrColumnsPerBlock() != 32 ) {
+    std::cout << "Wrong configuration for an indivisible size: " << conf.print() << "." << std::endl;
+    return 1;
+  }
+  // No configuration for other devices
+  try {
+    loaded.getConf("Other Device", dataType, 1024, 1024, 3, 3, 1, false);
+    std::cout << "Configuration found for an unknown device." << std::endl;
+    return 1;
+  } catch ( std::out_of_range & err ) {
+  }
+
+  std::cout << "TEST PASSED." << std::endl;
+
+  return 0;
+}
+
@@ -21,23 +21,44 @@
 #include <limits>
 #include <ctime>
 #include <algorithm>
+#include <deque>
+#include <future>
+#include <utility>
 
 #include <ArgumentList.hpp>
 #include <InitializeOpenCL.hpp>
 #include <Kernel.hpp>
+#include <KernelCache.hpp>
+#include <TuningDatabase.hpp>
+#include <Search.hpp>
 #include <Convolution.hpp>
+#include <Separable.hpp>
+#include <FFT.hpp>
+#include <CostModel.hpp>
 #include <utils.hpp>
 #include <Timer.hpp>
 #include <Stats.hpp>
+#include <Profiling.hpp>
+#include <HostMemory.hpp>
 
 typedef float dataType;
 std::string typeName("float");
 
+// Optional arguments keep their default value when missing
+template< typename T > void getOptionalArgument(isa::utils::ArgumentList & args, const std::string & option, T & value);
 
 int main(int argc, char * argv[]) {
   bool localMem = false;
+  bool window = false;
+  bool separable = false;
+  bool fft = false;
+  bool constant = false;
+  bool profile = false;
+  bool copy = false;
 	unsigned int nrIterations = 0;
   unsigned int padding = 0;
+  std::string cacheDirectory;
+  std::string databaseName;
 	unsigned int clPlatformID = 0;
 	unsigned int clDeviceID = 0;
 	unsigned int minThreads = 0;
@@ -47,16 +68,30 @@ int main(int argc, char * argv[]) {
   unsigned int threadUnit = 0;
   unsigned int threadIncrement = 0;
   unsigned int maxItems = 0;
+  unsigned int maxVectorWidth = 8;
   // I/O size
   unsigned int width = 0;
   unsigned int height = 0;
   unsigned int filterWidth = 0;
   unsigned int filterHeight = 0;
+  unsigned int nrImages = 0;
+  unsigned int nrFilters = 0;
+  // Search
+  std::string strategyName("exhaustive");
+  unsigned int maxEvaluations = 0;
+  unsigned int maxSeconds = 0;
+  unsigned int nrCompilers = 1;
 
 	try {
     isa::utils::ArgumentList args(argc, argv);
 
     localMem = args.getSwitch("-local");
+    window = args.getSwitch("-window");
+    separable = args.getSwitch("-separable");
+    fft = args.getSwitch("-fft");
+    constant = args.getSwitch("-constant");
+    profile = args.getSwitch("-profile");
+    copy = args.getSwitch("-copy");
 		nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
 		clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
 		clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
@@ -72,13 +107,42 @@ int main(int argc, char * argv[]) {
     height = args.getSwitchArgument< unsigned int >("-height");
     filterWidth = args.getSwitchArgument< unsigned int >("-filter_width");
     filterHeight = args.getSwitchArgument< unsigned int >("-filter_height");
+    nrImages = args.getSwitchArgument< unsigned int >("-images");
+    nrFilters = args.getSwitchArgument< unsigned int >("-filters");
+    getOptionalArgument(args, "-cache", cacheDirectory);
+    getOptionalArgument(args, "-database", databaseName);
+    // A budget of 0 evaluations or seconds means no limit
+    getOptionalArgument(args, "-search", strategyName);
+    getOptionalArgument(args, "-evaluations", maxEvaluations);
+    getOptionalArgument(args, "-time", maxSeconds);
+    getOptionalArgument(args, "-compilers", nrCompilers);
+    getOptionalArgument(args, "-max_vector", maxVectorWidth);
 	} catch ( isa::utils::EmptyCommandLine & err ) {
-		std::cerr << argv[0] << " -iterations ... [-local] -opencl_platform ... -opencl_device ... -padding ... -thread_unit ... -min_threads ... -max_threads ... -max_items ... -max_columns ... -max_rows ... -thread_increment ... -width ... -height ... -filter_width ... -filter_height ..." << std::endl;
+		std::cerr << argv[0] << " -iterations ... [-local] [-window] [-separable] [-fft] [-constant] [-profile] [-copy] [-cache ...] [-database ...] [-search exhaustive|random|annealing|model] [-evaluations ...] [-time ...] [-compilers ...] [-max_vector ...] -opencl_platform ... -opencl_device ... -padding ... -thread_unit ... -min_threads ... -max_threads ... -max_items ... -max_columns ... -max_rows ... -thread_increment ... -width ... -height ... -filter_width ... -filter_height ... -images ... -filters ..." << std::endl;
 		return 1;
 	} catch ( std::exception & err ) {
 		std::cerr << err.what() << std::endl;
 		return 1;
 	}
+  if ( (separable || fft) && nrFilters > 1 ) {
+    std::cerr << "Filter banks are only supported by the direct algorithm." << std::endl;
+    return 1;
+  } else if ( nrCompilers == 0 ) {
+    std::cerr << "At least one compiler thread is necessary." << std::endl;
+    return 1;
+  } else if ( (separable || fft) && constant ) {
+    std::cerr << "Constant coefficients are only supported by the direct algorithm." << std::endl;
+    return 1;
+  } else if ( fft && profile ) {
+    std::cerr << "Profiling is only supported by the direct and separable algorithms." << std::endl;
+    return 1;
+  } else if ( maxVectorWidth == 0 || maxVectorWidth > 16 ) {
+    std::cerr << "OpenCL vectors have between 1 and 16 elements." << std::endl;
+    return 1;
+  } else if ( window && (!localMem || separable || fft) ) {
+    std::cerr << "The sliding window is only supported by the direct algorithm with local memory." << std::endl;
+    return 1;
+  }
 
 	// Initialize OpenCL
 	cl::Context * clContext = new cl::Context();
@@ -87,140 +151,397 @@ int main(int argc, char * argv[]) {
 	std::vector< std::vector< cl::CommandQueue > > * clQueues = new std::vector< std::vector < cl::CommandQueue > >();
 
   isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, clContext, clDevices, clQueues);
+  // The kernels being compiled must never be evicted before they are benchmarked
+  isa::OpenCL::KernelCache kernelCache(cacheDirectory, nrCompilers + 16);
+  std::string deviceName;
+  cl_ulong localMemorySize = 0;
+  size_t maxWorkGroupSize = 0;
+  clDevices->at(clDeviceID).getInfo(CL_DEVICE_NAME, &deviceName);
+  clDevices->at(clDeviceID).getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &localMemorySize);
+  clDevices->at(clDeviceID).getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &maxWorkGroupSize);
+  // Devices sharing the memory of the host use the host images in place, unless -copy is given
+  isa::OpenCL::ConvolutionBufferMode bufferMode = isa::OpenCL::COPY;
+  if ( !copy ) {
+    bufferMode = isa::OpenCL::getConvolutionBufferMode(clDevices->at(clDeviceID));
+  }
 
-	// Allocate host memory
-  std::vector< dataType > input = std::vector< dataType >((height + (filterHeight - 1)) * isa::utils::pad(width + (filterWidth - 1), padding));
-  std::vector< dataType > output = std::vector< dataType >(height * isa::utils::pad(width, padding));
-  std::vector< dataType > filter = std::vector< dataType >(filterWidth * filterHeight);
+  // Results are merged with the configurations already in the database
+  isa::OpenCL::TuningDatabase database;
+  if ( !databaseName.empty() && std::ifstream(databaseName.c_str()) ) {
+    try {
+      database.read(databaseName);
+    } catch ( std::runtime_error & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    }
+  }
+
+	// Allocate host memory, the images of the batch are contiguous and page-aligned
+  const unsigned int inputImageStride = isa::OpenCL::getInputImageSize(padding, width, height, filterWidth, filterHeight);
+  const unsigned int outputImageStride = isa::OpenCL::getOutputImageSize(padding, width, height);
+  isa::OpenCL::HostVector< dataType >::type input = isa::OpenCL::HostVector< dataType >::type(nrImages * inputImageStride);
+  isa::OpenCL::HostVector< dataType >::type output = isa::OpenCL::HostVector< dataType >::type(nrImages * nrFilters * outputImageStride);
+  std::vector< dataType > filter = std::vector< dataType >(nrFilters * filterWidth * filterHeight);
+  std::vector< dataType > rowFilter = std::vector< dataType >(filterWidth);
+  std::vector< dataType > columnFilter = std::vector< dataType >(filterHeight);
   std::srand(time(0));
   std::fill(filter.begin(), filter.end(), std::rand() % 100);
+  std::fill(rowFilter.begin(), rowFilter.end(), std::rand() % 10);
+  std::fill(columnFilter.begin(), columnFilter.end(), std::rand() % 10);
   std::fill(input.begin(), input.end(), std::rand() % 1000);
 
   // Allocate device memory
-  cl::Buffer input_d, output_d, filter_d;
+  cl::Buffer input_d, output_d, filter_d, rowFilter_d, columnFilter_d;
   try {
-    input_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, input.size() * sizeof(dataType), 0, 0);
-    output_d = cl::Buffer(*clContext, CL_MEM_WRITE_ONLY, output.size() * sizeof(dataType), 0, 0);
+    input_d = isa::OpenCL::getConvolutionBuffer(*clContext, CL_MEM_READ_ONLY, bufferMode, input.size() * sizeof(dataType), reinterpret_cast< void * >(input.data()));
+    output_d = isa::OpenCL::getConvolutionBuffer(*clContext, CL_MEM_WRITE_ONLY, bufferMode, output.size() * sizeof(dataType), reinterpret_cast< void * >(output.data()));
     filter_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, filter.size() * sizeof(dataType), 0, 0);
+    rowFilter_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, rowFilter.size() * sizeof(dataType), 0, 0);
+    columnFilter_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, columnFilter.size() * sizeof(dataType), 0, 0);
   } catch ( cl::Error & err ) {
     std::cerr << "OpenCL error allocating memory: " << isa::utils::toString(err.err()) << "." << std::endl;
     return 1;
+  } catch ( std::runtime_error & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
   }
 
   // Copy data structures to device
   try {
     clQueues->at(clDeviceID)[0].enqueueWriteBuffer(filter_d, CL_FALSE, 0, filter.size() * sizeof(float), reinterpret_cast< void * >(filter.data()));
-    clQueues->at(clDeviceID)[0].enqueueWriteBuffer(input_d, CL_FALSE, 0, input.size() * sizeof(dataType), reinterpret_cast< void * >(input.data()));
+    clQueues->at(clDeviceID)[0].enqueueWriteBuffer(rowFilter_d, CL_FALSE, 0, rowFilter.size() * sizeof(dataType), reinterpret_cast< void * >(rowFilter.data()));
+    clQueues->at(clDeviceID)[0].enqueueWriteBuffer(columnFilter_d, CL_FALSE, 0, columnFilter.size() * sizeof(dataType), reinterpret_cast< void * >(columnFilter.data()));
+    isa::OpenCL::writeConvolutionBuffer(clQueues->at(clDeviceID)[0], input_d, bufferMode, input.size() * sizeof(dataType), reinterpret_cast< const void * >(input.data()), 0);
   } catch ( cl::Error & err ) {
     std::cerr << "OpenCL error H2D transfer: " << isa::utils::toString(err.err()) << "." << std::endl;
     return 1;
+  } catch ( std::runtime_error & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+  // With -profile the configurations run on a queue with profiling enabled, after the transfers above
+  cl::CommandQueue queue = clQueues->at(clDeviceID)[0];
+  isa::OpenCL::ConvolutionProfiler profiler;
+  if ( profile ) {
+    try {
+      clQueues->at(clDeviceID)[0].finish();
+      queue = isa::OpenCL::getProfilingQueue(*clContext, clDevices->at(clDeviceID));
+    } catch ( std::exception & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    }
   }
 
-	// Find the parameters
-	std::vector< unsigned int > columnsPerBlock;
-	for ( unsigned int columns = minThreads; columns <= maxColumns; columns += threadIncrement ) {
-		if ( (width % columns) == 0 ) {
-			columnsPerBlock.push_back(columns);
-		}
-	}
-	std::vector< unsigned int > rowsPerBlock;
-	for ( unsigned int rows = 1; rows <= maxRows; rows++ ) {
-		if ( (height % rows) == 0 ) {
-			rowsPerBlock.push_back(rows);
-		}
-	}
+  // The FFT algorithm has one parameter, the size of the FFT, that is also the number of work-items; it is not batched, only the first image is used
+  if ( fft ) {
+    double bestCost = std::numeric_limits< double >::max();
 
-	std::cout << std::fixed << std::endl;
-	std::cout << "# width height filterWidth filterHeight local columnsPerBlock rowsPerBlock columnsPerThread rowsPerThread GFLOP/s GB/s time stdDeviation COV" << std::endl << std::endl;
+    std::cout << std::fixed << std::endl;
+    std::cout << "# width height filterWidth filterHeight fftSize GFLOP/s GB/s time stdDeviation COV" << std::endl << std::endl;
 
-	for ( std::vector< unsigned int >::iterator columns = columnsPerBlock.begin(); columns != columnsPerBlock.end(); ++columns ) {
-		for ( std::vector< unsigned int >::iterator rows = rowsPerBlock.begin(); rows != rowsPerBlock.end(); ++rows ) {
-			if ( ((*columns) * (*rows)) > maxThreads ) {
-				break;
-			} else if ( ((*columns) * (*rows)) % threadUnit != 0 ) {
+    for ( unsigned int size = 2; size <= maxThreads; size <<= 1 ) {
+      if ( size < filterWidth || size < filterHeight || size % threadUnit != 0 ) {
         continue;
       }
+      const unsigned int nrTileColumns = (width + (size - filterWidth)) / (size - (filterWidth - 1));
+      const unsigned int nrTileRows = (height + (size - filterHeight)) / (size - (filterHeight - 1));
+      const double log2Size = std::log(static_cast< double >(size)) / std::log(2.0);
+      double gflops = isa::utils::giga(static_cast< long long unsigned int >(nrTileColumns * nrTileRows * ((10 * size * size * log2Size) + (6 * size * size))));
+      double gbs = isa::utils::giga((static_cast< long long unsigned int >(nrTileColumns) * nrTileRows * size * size * 3 * sizeof(dataType)) + (static_cast< long long unsigned int >(width) * height * sizeof(dataType)));
+      isa::utils::Timer timer;
+      cl::Event event;
+      cl::Kernel * kernel;
+      cl::Buffer spectrum_d;
+      std::vector< dataType > spectrum;
+      std::string code = isa::OpenCL::getConvolutionFFTOpenCL(padding, width, height, filterWidth, filterHeight, size, typeName);
 
-			for ( unsigned int columnsPerThread = 1; columnsPerThread <= maxItems; columnsPerThread++ ) {
-				if ( (width % ((*columns) * columnsPerThread)) != 0 ) {
-					continue;
-				}
-
-				for ( unsigned int rowsPerThread = 1; rowsPerThread <= maxItems; rowsPerThread++ ) {
-					if ( (height % ((*rows) * rowsPerThread)) != 0 ) {
-						continue;
-					} else if ( !localMem && (columnsPerThread * rowsPerThread) + 2 > maxItems ) {
-						break;
-					} else if ( localMem  && (columnsPerThread * rowsPerThread) + 5 > maxItems ) {
-            break;
-          }
-
-          // Generate kernel
-          double gflops = isa::utils::giga((static_cast< long long unsigned int >(width) * height * filterWidth * filterHeight * 2) + (static_cast< long long unsigned int >(width) * height));
-          double gbs;
-          if ( localMem ) {
-            gbs = isa::utils::giga((static_cast< long long unsigned int >(width / (*columns * columnsPerThread)) * (height / (*rows * rowsPerThread)) * (((*columns * columnsPerThread) + (filterWidth - 1)) * ((*rows * rowsPerThread) + (filterHeight - 1))) * sizeof(dataType)) + (static_cast< long long unsigned int >(width) * height * sizeof(dataType)) + (static_cast< long long unsigned int >(width) * (height) * filterWidth * filterHeight * sizeof(dataType)));
-          } else {
-            gbs = isa::utils::giga((static_cast< long long unsigned int >(width) * height * filterWidth * filterHeight * 2 * sizeof(dataType)) + (static_cast< long long unsigned int >(width) * height * sizeof(dataType)));
-          }
-          isa::utils::Timer timer;
-          cl::Event event;
-          cl::Kernel * kernel;
-          std::string * code = isa::OpenCL::getConvolutionOpenCL(localMem, padding, width, height, filterWidth, filterHeight, *columns, *rows, columnsPerThread, rowsPerThread, typeName);
-
-          try {
-            kernel = isa::OpenCL::compile("convolution", *code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
-          } catch ( isa::OpenCL::OpenCLError & err ) {
-            std::cerr << *columns << ", " << *rows << ", " << columnsPerThread << ", " << rowsPerThread << std::endl;
-            std::cerr << err.what() << std::endl;
-            continue;
-          }
-
-          cl::NDRange global(width / columnsPerThread, height / rowsPerThread);
-          cl::NDRange local(*columns, *rows);
-
-          kernel->setArg(0, input_d);
-          kernel->setArg(1, output_d);
-          kernel->setArg(2, filter_d);
-
-          // Warm-up run
-          try {
-            clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
-            event.wait();
-          } catch ( cl::Error & err ) {
-            std::cerr << *columns << ", " << *rows << ", " << columnsPerThread << ", " << rowsPerThread << std::endl;
-            std::cerr << "OpenCL error kernel execution: " << isa::utils::toString(err.err()) << "." << std::endl;
-            continue;
-          }
-          // Tuning runs
-          try {
-            for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
-              timer.start();
-              clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
-              event.wait();
-              timer.stop();
-            }
-          } catch ( cl::Error & err ) {
-            std::cerr << *columns << ", " << *rows << ", " << columnsPerThread << ", " << rowsPerThread << std::endl;
-            std::cerr << "OpenCL error kernel execution: " << isa::utils::toString(err.err()) << "." << std::endl;
-            continue;
-          }
-
-          std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " ";
-          std::cout << localMem << " " << *columns << " " << *rows << " " << columnsPerThread << " " << rowsPerThread << " ";
-          std::cout << std::setprecision(3);
-          std::cout << gflops / timer.getAverageTime() << " ";
-          std::cout << gbs / timer.getAverageTime() << " ";
-          std::cout << std::setprecision(6);
-          std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " ";
-          std::cout << timer.getCoefficientOfVariation() <<  std::endl;
-				}
-			}
-		}
-	}
+      isa::OpenCL::getFilterSpectrumOpenCL(size, filterWidth, filterHeight, filter, spectrum);
+      try {
+        spectrum_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, spectrum.size() * sizeof(dataType), 0, 0);
+        clQueues->at(clDeviceID)[0].enqueueWriteBuffer(spectrum_d, CL_TRUE, 0, spectrum.size() * sizeof(dataType), reinterpret_cast< void * >(spectrum.data()));
+        kernel = kernelCache.getKernel("convolution", code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+      } catch ( isa::OpenCL::OpenCLError & err ) {
+        std::cerr << size << std::endl;
+        std::cerr << err.what() << std::endl;
+        continue;
+      } catch ( cl::Error & err ) {
+        std::cerr << size << std::endl;
+        std::cerr << "OpenCL error: " << isa::utils::toString(err.err()) << "." << std::endl;
+        continue;
+      }
+
+      cl::NDRange global(nrTileColumns * size, nrTileRows);
+      cl::NDRange local(size, 1);
+
+      kernel->setArg(0, input_d);
+      kernel->setArg(1, output_d);
+      kernel->setArg(2, spectrum_d);
+
+      // Warm-up run
+      try {
+        clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+        event.wait();
+      } catch ( cl::Error & err ) {
+        std::cerr << size << std::endl;
+        std::cerr << "OpenCL error kernel execution: " << isa::utils::toString(err.err()) << "." << std::endl;
+        continue;
+      }
+      // Tuning runs
+      try {
+        for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+          timer.start();
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+          event.wait();
+          timer.stop();
+        }
+      } catch ( cl::Error & err ) {
+        std::cerr << size << std::endl;
+        std::cerr << "OpenCL error kernel execution: " << isa::utils::toString(err.err()) << "." << std::endl;
+        continue;
+      }
+      bestCost = std::min(bestCost, timer.getAverageTime() / isa::OpenCL::getFFTWork(size, width, height, filterWidth, filterHeight));
+
+      std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " " << size << " ";
+      std::cout << std::setprecision(3);
+      std::cout << gflops / timer.getAverageTime() << " ";
+      std::cout << gbs / timer.getAverageTime() << " ";
+      std::cout << std::setprecision(6);
+      std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " ";
+      std::cout << timer.getCoefficientOfVariation() <<  std::endl;
+    }
+
+    // Calibrated cost, in the format of isa::OpenCL::readCostModel
+    std::cout << std::endl;
+    std::cout << isa::OpenCL::toString(isa::OpenCL::FFT) << " " << std::scientific << bestCost << std::endl;
+    std::cout << "# kernelCache hits diskHits misses" << std::endl;
+    std::cout << "# " << kernelCache.getHits() << " " << kernelCache.getDiskHits() << " " << kernelCache.getMisses() << std::endl;
+    std::cout << std::endl;
+
+    return 0;
+  }
+
+  // Configurations that the device cannot run are rejected before compiling them
+  std::vector< isa::OpenCL::ConvolutionConf > space = isa::OpenCL::getConvolutionSpace(localMem, width, height, nrFilters, threadUnit, minThreads, maxThreads, threadIncrement, maxColumns, maxRows, maxItems, separable ? 1 : maxVectorWidth);
+  // Constant coefficients need all the filters of the bank in every work-item
+  if ( constant ) {
+    space.erase(std::remove_if(space.begin(), space.end(), [nrFilters](const isa::OpenCL::ConvolutionConf & conf) {
+      return conf.getNrFiltersPerThread() != nrFilters;
+    }), space.end());
+  }
+  // The sliding window is an option of the kernel, the same for every configuration
+  for ( std::vector< isa::OpenCL::ConvolutionConf >::iterator conf = space.begin(); conf != space.end(); ++conf ) {
+    conf->setWindow(window);
+  }
+  const unsigned int nrPruned = isa::OpenCL::pruneConvolutionSpace(space, separable, padding, filterWidth, filterHeight, typeName, localMemorySize, maxWorkGroupSize, maxItems);
+  isa::OpenCL::SearchStrategy * strategy = 0;
+  try {
+    strategy = isa::OpenCL::getSearchStrategy(strategyName, space, filterWidth, filterHeight);
+  } catch ( std::invalid_argument & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  double bestCost = std::numeric_limits< double >::max();
+  unsigned int nrEvaluations = 0;
+  const std::time_t startTime = std::time(0);
+  // Kernels are compiled by up to nrCompilers threads while the device benchmarks the oldest one
+  std::deque< std::pair< isa::OpenCL::ConvolutionConf, std::future< cl::Kernel * > > > pending;
+
+	std::cout << std::fixed << std::endl;
+  std::cout << "# search configurations pruned buffers" << std::endl;
+  std::cout << "# " << strategyName << " " << space.size() << " " << nrPruned << " " << isa::OpenCL::toString(bufferMode) << std::endl;
+	std::cout << "# width height filterWidth filterHeight images filters local window separable columnsPerBlock rowsPerBlock columnsPerThread rowsPerThread filtersPerThread vectorWidth tail(%) GFLOP/s GB/s localGB/s images/s time stdDeviation COV";
+  if ( profile ) {
+    std::cout << " queued(us) submit(us) upload(us) kernel(us) download(us) bound";
+  }
+  std::cout << std::endl << std::endl;
+
+  while ( true ) {
+    isa::OpenCL::ConvolutionConf conf;
+    const bool inTime = maxSeconds == 0 || std::difftime(std::time(0), startTime) < maxSeconds;
+
+    while ( inTime && pending.size() < nrCompilers && (maxEvaluations == 0 || nrEvaluations + pending.size() < maxEvaluations) && strategy->next(conf) ) {
+      std::string source;
+      if ( separable ) {
+        source = isa::OpenCL::getConvolutionSeparableOpenCL(conf, padding, width, height, filterWidth, filterHeight, inputImageStride, outputImageStride, typeName);
+      } else {
+        std::vector< double > coefficients;
+
+        if ( constant ) {
+          coefficients.assign(filter.begin(), filter.end());
+        }
+        source = isa::OpenCL::getConvolutionOpenCLSource(conf, padding, width, height, filterWidth, filterHeight, nrFilters, inputImageStride, outputImageStride, typeName, coefficients);
+      }
+
+      pending.push_back(std::make_pair(conf, std::async(std::launch::async, [&kernelCache, source, clContext, clDevices, clDeviceID]() {
+        return kernelCache.getKernel("convolution", source, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+      })));
+    }
+    if ( pending.empty() ) {
+      break;
+    }
+    conf = pending.front().first;
+    const unsigned int columns = conf.getNrColumnsPerBlock();
+    const unsigned int rows = conf.getNrRowsPerBlock();
+    const unsigned int columnsPerThread = conf.getNrColumnsPerThread();
+    const unsigned int rowsPerThread = conf.getNrRowsPerThread();
+    const unsigned int filtersPerThread = conf.getNrFiltersPerThread();
+    const unsigned int vectorWidth = conf.getVectorWidth();
+    cl::Kernel * kernel;
+
+    nrEvaluations++;
+    try {
+      kernel = pending.front().second.get();
+      pending.pop_front();
+    } catch ( isa::OpenCL::OpenCLError & err ) {
+      pending.pop_front();
+      strategy->report(0.0);
+      std::cerr << conf.print() << std::endl;
+      std::cerr << err.what() << std::endl;
+      continue;
+    }
+
+    // Operations and memory traffic of the configuration
+    double gflops = isa::OpenCL::getConvolutionGFLOP(width, height, filterWidth, filterHeight, nrFilters);
+    double gbs = isa::OpenCL::getConvolutionGB(conf, width, height, filterWidth, filterHeight, nrFilters, sizeof(dataType));
+    if ( separable ) {
+      gflops = isa::OpenCL::getConvolutionSeparableGFLOP(width, height, filterWidth, filterHeight);
+      gbs = isa::OpenCL::getConvolutionSeparableGB(conf, width, height, filterWidth, filterHeight, sizeof(dataType));
+    }
+    double localGbs = 0.0;
+    if ( !separable ) {
+      localGbs = isa::OpenCL::getConvolutionLocalGB(conf, width, height, filterWidth, filterHeight, nrFilters, sizeof(dataType));
+    }
+    gflops *= nrImages;
+    gbs *= nrImages;
+    localGbs *= nrImages;
+    isa::utils::Timer timer;
+    cl::Event event;
+
+    cl::NDRange global(isa::OpenCL::getConvolutionGlobalColumns(conf, width), isa::OpenCL::getConvolutionGlobalRows(conf, height), nrImages);
+    cl::NDRange local(columns, rows, 1);
+
+    kernel->setArg(0, input_d);
+    kernel->setArg(1, output_d);
+    if ( separable ) {
+      kernel->setArg(2, rowFilter_d);
+      kernel->setArg(3, columnFilter_d);
+    } else {
+      kernel->setArg(2, filter_d);
+    }
+
+    // Warm-up run
+    try {
+      queue.enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+      event.wait();
+    } catch ( cl::Error & err ) {
+      strategy->report(0.0);
+      std::cerr << conf.print() << std::endl;
+      std::cerr << "OpenCL error kernel execution: " << isa::utils::toString(err.err()) << "." << std::endl;
+      continue;
+    }
+    // Tuning runs
+    profiler.reset();
+    try {
+      for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+        timer.start();
+        queue.enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+        event.wait();
+        timer.stop();
+        if ( profile ) {
+          profiler.record(isa::OpenCL::COMPUTE, event);
+        }
+      }
+      // The transfers of the batch are profiled once per configuration
+      if ( profile ) {
+        isa::OpenCL::writeConvolutionBuffer(queue, input_d, bufferMode, input.size() * sizeof(dataType), reinterpret_cast< const void * >(input.data()), &event);
+        event.wait();
+        profiler.record(isa::OpenCL::UPLOAD, event);
+        isa::OpenCL::readConvolutionBuffer(queue, output_d, bufferMode, output.size() * sizeof(dataType), reinterpret_cast< void * >(output.data()), &event);
+        event.wait();
+        profiler.record(isa::OpenCL::DOWNLOAD, event);
+      }
+    } catch ( cl::Error & err ) {
+      strategy->report(0.0);
+      std::cerr << conf.print() << std::endl;
+      std::cerr << "OpenCL error kernel execution: " << isa::utils::toString(err.err()) << "." << std::endl;
+      continue;
+    } catch ( std::runtime_error & err ) {
+      strategy->report(0.0);
+      std::cerr << conf.print() << std::endl;
+      std::cerr << err.what() << std::endl;
+      continue;
+    }
+    strategy->report(gflops / timer.getAverageTime());
+    if ( separable ) {
+      bestCost = std::min(bestCost, timer.getAverageTime() / (nrImages * isa::OpenCL::getConvolutionWork(isa::OpenCL::SEPARABLE, width, height, filterWidth, filterHeight)));
+    } else {
+      bestCost = std::min(bestCost, timer.getAverageTime() / (nrImages * nrFilters * isa::OpenCL::getConvolutionWork(isa::OpenCL::DIRECT, width, height, filterWidth, filterHeight)));
+    }
+
+    isa::OpenCL::TuningEntry entry;
+    entry.device = deviceName;
+    entry.dataType = typeName;
+    entry.width = width;
+    entry.height = height;
+    entry.filterWidth = filterWidth;
+    entry.filterHeight = filterHeight;
+    entry.nrFilters = nrFilters;
+    entry.separable = separable;
+    entry.conf = conf;
+    entry.gflops = gflops / timer.getAverageTime();
+    // Kernels with constant coefficients are only valid for this filter
+    if ( !constant ) {
+      database.insert(entry);
+    }
+
+    std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " " << nrImages << " " << nrFilters << " ";
+    std::cout << localMem << " " << window << " " << separable << " " << columns << " " << rows << " " << columnsPerThread << " " << rowsPerThread << " " << filtersPerThread << " " << vectorWidth << " ";
+    std::cout << std::setprecision(3);
+    std::cout << isa::OpenCL::getConvolutionTailFraction(conf, width, height) * 100.0 << " ";
+    std::cout << gflops / timer.getAverageTime() << " ";
+    std::cout << gbs / timer.getAverageTime() << " ";
+    std::cout << localGbs / timer.getAverageTime() << " ";
+    std::cout << nrImages / timer.getAverageTime() << " ";
+    std::cout << std::setprecision(6);
+    std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " ";
+    std::cout << timer.getCoefficientOfVariation();
+    if ( profile ) {
+      std::cout << " " << std::setprecision(3);
+      std::cout << profiler.getQueuedTime(isa::OpenCL::COMPUTE) * 1.0e6 << " " << profiler.getSubmitTime(isa::OpenCL::COMPUTE) * 1.0e6 << " ";
+      std::cout << profiler.getExecutionTime(isa::OpenCL::UPLOAD) * 1.0e6 << " " << profiler.getExecutionTime(isa::OpenCL::COMPUTE) * 1.0e6 << " " << profiler.getExecutionTime(isa::OpenCL::DOWNLOAD) * 1.0e6 << " ";
+      std::cout << profiler.getBound();
+    }
+    std::cout << std::endl;
+  }
+  delete strategy;
 
 	std::cout << std::endl;
+  // Calibrated cost, in the format of isa::OpenCL::readCostModel
+  if ( separable ) {
+    std::cout << isa::OpenCL::toString(isa::OpenCL::SEPARABLE) << " " << std::scientific << bestCost << std::endl;
+  } else {
+    std::cout << isa::OpenCL::toString(isa::OpenCL::DIRECT) << " " << std::scientific << bestCost << std::endl;
+  }
+  std::cout << "# kernelCache hits diskHits misses" << std::endl;
+  std::cout << "# " << kernelCache.getHits() << " " << kernelCache.getDiskHits() << " " << kernelCache.getMisses() << std::endl;
+	std::cout << std::endl;
+  if ( !databaseName.empty() ) {
+    try {
+      database.write(databaseName);
+    } catch ( std::runtime_error & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    }
+  }
 
 	return 0;
 }
 
+template< typename T > void getOptionalArgument(isa::utils::ArgumentList & args, const std::string & option, T & value) {
+  try {
+    value = args.getSwitchArgument< T >(option);
+  } catch ( isa::utils::SwitchNotFound & err ) {
+  }
+}
+
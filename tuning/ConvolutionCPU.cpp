@@ -0,0 +1,182 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iomanip>
+#include <ctime>
+#include <algorithm>
+
+#include <ArgumentList.hpp>
+#include <Convolution.hpp>
+#include <ConvolutionSIMD.hpp>
+#include <Separable.hpp>
+#include <FFT.hpp>
+#include <BoxFilter.hpp>
+#include <CostModel.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+
+typedef float dataType;
+
+
+int main(int argc, char * argv[]) {
+  bool simd = false;
+  bool calibrate = false;
+	unsigned int nrIterations = 0;
+  unsigned int padding = 0;
+  unsigned int columnIncrement = 0;
+	unsigned int maxColumns = 0;
+	unsigned int maxRows = 0;
+  // I/O size
+  unsigned int width = 0;
+  unsigned int height = 0;
+  unsigned int filterWidth = 0;
+  unsigned int filterHeight = 0;
+
+	try {
+    isa::utils::ArgumentList args(argc, argv);
+
+    simd = args.getSwitch("-simd");
+    calibrate = args.getSwitch("-calibrate");
+		nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    columnIncrement = args.getSwitchArgument< unsigned int >("-column_increment");
+		maxColumns = args.getSwitchArgument< unsigned int >("-max_columns");
+		maxRows = args.getSwitchArgument< unsigned int >("-max_rows");
+    width = args.getSwitchArgument< unsigned int >("-width");
+    height = args.getSwitchArgument< unsigned int >("-height");
+    filterWidth = args.getSwitchArgument< unsigned int >("-filter_width");
+    filterHeight = args.getSwitchArgument< unsigned int >("-filter_height");
+	} catch ( isa::utils::EmptyCommandLine & err ) {
+		std::cerr << argv[0] << " -iterations ... [-simd] [-calibrate] -padding ... -column_increment ... -max_columns ... -max_rows ... -width ... -height ... -filter_width ... -filter_height ..." << std::endl;
+		return 1;
+	} catch ( std::exception & err ) {
+		std::cerr << err.what() << std::endl;
+		return 1;
+	}
+
+	// Allocate host memory
+  std::vector< dataType > input = std::vector< dataType >((height + (filterHeight - 1)) * isa::utils::pad(width + (filterWidth - 1), padding));
+  std::vector< dataType > output = std::vector< dataType >(height * isa::utils::pad(width, padding));
+  std::vector< dataType > filter = std::vector< dataType >(filterWidth * filterHeight);
+  std::srand(time(0));
+  std::fill(filter.begin(), filter.end(), std::rand() % 100);
+  std::fill(input.begin(), input.end(), std::rand() % 1000);
+
+  double gflops = isa::OpenCL::getConvolutionGFLOP(width, height, filterWidth, filterHeight, 1);
+  isa::utils::Timer timer;
+
+  // Calibrate the cost model, in the format of isa::OpenCL::readCostModel
+  if ( calibrate ) {
+    unsigned int nrColumnsPerTile = 0;
+    unsigned int nrRowsPerTile = 0;
+    const unsigned int fftSize = isa::OpenCL::getFFTSize(width, height, filterWidth, filterHeight, isa::OpenCL::maxFFTSize);
+    std::vector< dataType > rowFilter = std::vector< dataType >(filterWidth, 1);
+    std::vector< dataType > columnFilter = std::vector< dataType >(filterHeight, 1);
+    isa::utils::Timer directTimer, separableTimer, fftTimer, boxTimer;
+
+    isa::OpenCL::getConvolutionTile< dataType >(width, height, filterWidth, filterHeight, 32 * 1024, 256 * 1024, nrColumnsPerTile, nrRowsPerTile);
+    // Warm-up runs
+    isa::OpenCL::convolutionSIMD< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+    isa::OpenCL::convolutionSeparable< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, rowFilter, columnFilter);
+    isa::OpenCL::convolutionFFT< dataType >(padding, width, height, filterWidth, filterHeight, fftSize, input, output, filter);
+    isa::OpenCL::convolutionBox< dataType >(padding, width, height, filterWidth, filterHeight, input, output, filter[0]);
+    // Calibration runs
+    for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+      directTimer.start();
+      isa::OpenCL::convolutionSIMD< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+      directTimer.stop();
+      separableTimer.start();
+      isa::OpenCL::convolutionSeparable< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, rowFilter, columnFilter);
+      separableTimer.stop();
+      fftTimer.start();
+      isa::OpenCL::convolutionFFT< dataType >(padding, width, height, filterWidth, filterHeight, fftSize, input, output, filter);
+      fftTimer.stop();
+      boxTimer.start();
+      isa::OpenCL::convolutionBox< dataType >(padding, width, height, filterWidth, filterHeight, input, output, filter[0]);
+      boxTimer.stop();
+    }
+
+    std::cout << std::endl;
+    std::cout << "# width height filterWidth filterHeight fftSize" << std::endl;
+    std::cout << "# " << width << " " << height << " " << filterWidth << " " << filterHeight << " " << fftSize << std::endl;
+    std::cout << "# algorithm cost" << std::endl;
+    std::cout << std::scientific;
+    std::cout << isa::OpenCL::toString(isa::OpenCL::DIRECT) << " " << directTimer.getAverageTime() / isa::OpenCL::getConvolutionWork(isa::OpenCL::DIRECT, width, height, filterWidth, filterHeight) << std::endl;
+    std::cout << isa::OpenCL::toString(isa::OpenCL::SEPARABLE) << " " << separableTimer.getAverageTime() / isa::OpenCL::getConvolutionWork(isa::OpenCL::SEPARABLE, width, height, filterWidth, filterHeight) << std::endl;
+    std::cout << isa::OpenCL::toString(isa::OpenCL::FFT) << " " << fftTimer.getAverageTime() / isa::OpenCL::getConvolutionWork(isa::OpenCL::FFT, width, height, filterWidth, filterHeight) << std::endl;
+    std::cout << isa::OpenCL::toString(isa::OpenCL::BOX) << " " << boxTimer.getAverageTime() / isa::OpenCL::getConvolutionWork(isa::OpenCL::BOX, width, height, filterWidth, filterHeight) << std::endl;
+    std::cout << std::endl;
+
+    return 0;
+  }
+
+	std::cout << std::fixed << std::endl;
+  if ( simd ) {
+    std::cout << "# ISA: " << isa::OpenCL::toString(isa::OpenCL::getConvolutionISA()) << std::endl;
+  }
+	std::cout << "# width height filterWidth filterHeight columnsPerTile rowsPerTile GFLOP/s time stdDeviation COV" << std::endl << std::endl;
+
+  // Sequential algorithm, reported with a 0x0 tile
+  for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+    timer.start();
+    isa::OpenCL::convolution< dataType >(padding, width, height, filterWidth, filterHeight, input, output, filter);
+    timer.stop();
+  }
+  std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " ";
+  std::cout << 0 << " " << 0 << " ";
+  std::cout << std::setprecision(3);
+  std::cout << gflops / timer.getAverageTime() << " ";
+  std::cout << std::setprecision(6);
+  std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " ";
+  std::cout << timer.getCoefficientOfVariation() <<  std::endl;
+
+	for ( unsigned int columns = columnIncrement; columns <= std::min(maxColumns, width); columns += columnIncrement ) {
+		for ( unsigned int rows = 1; rows <= std::min(maxRows, height); rows++ ) {
+      timer.reset();
+
+      // Warm-up run
+      if ( simd ) {
+        isa::OpenCL::convolutionSIMD< dataType >(padding, width, height, filterWidth, filterHeight, columns, rows, input, output, filter);
+      } else {
+        isa::OpenCL::convolutionParallel< dataType >(padding, width, height, filterWidth, filterHeight, columns, rows, input, output, filter);
+      }
+      // Tuning runs
+      for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+        timer.start();
+        if ( simd ) {
+          isa::OpenCL::convolutionSIMD< dataType >(padding, width, height, filterWidth, filterHeight, columns, rows, input, output, filter);
+        } else {
+          isa::OpenCL::convolutionParallel< dataType >(padding, width, height, filterWidth, filterHeight, columns, rows, input, output, filter);
+        }
+        timer.stop();
+      }
+
+      std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " ";
+      std::cout << columns << " " << rows << " ";
+      std::cout << std::setprecision(3);
+      std::cout << gflops / timer.getAverageTime() << " ";
+      std::cout << std::setprecision(6);
+      std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " ";
+      std::cout << timer.getCoefficientOfVariation() <<  std::endl;
+		}
+	}
+
+	std::cout << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,213 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iomanip>
+#include <ctime>
+#include <algorithm>
+
+#include <ArgumentList.hpp>
+#include <InitializeOpenCL.hpp>
+#include <Kernel.hpp>
+#include <KernelCache.hpp>
+#include <Search.hpp>
+#include <Convolution.hpp>
+#include <Channels.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+
+typedef float dataType;
+std::string typeName("float");
+
+
+int main(int argc, char * argv[]) {
+  bool localMem = false;
+	unsigned int nrIterations = 0;
+  unsigned int padding = 0;
+	unsigned int clPlatformID = 0;
+	unsigned int clDeviceID = 0;
+	unsigned int minThreads = 0;
+  unsigned int maxThreads = 0;
+	unsigned int maxRows = 0;
+	unsigned int maxColumns = 0;
+  unsigned int threadUnit = 0;
+  unsigned int threadIncrement = 0;
+  unsigned int maxItems = 0;
+  std::vector< isa::OpenCL::ConvolutionLayout > layouts;
+  // I/O size
+  unsigned int width = 0;
+  unsigned int height = 0;
+  unsigned int filterWidth = 0;
+  unsigned int filterHeight = 0;
+  unsigned int nrChannels = 0;
+
+	try {
+    isa::utils::ArgumentList args(argc, argv);
+
+    localMem = args.getSwitch("-local");
+		nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
+		clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
+		clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    threadUnit = args.getSwitchArgument< unsigned int >("-thread_unit");
+		minThreads = args.getSwitchArgument< unsigned int >("-min_threads");
+		maxThreads = args.getSwitchArgument< unsigned int >("-max_threads");
+		maxRows = args.getSwitchArgument< unsigned int >("-max_rows");
+		maxColumns = args.getSwitchArgument< unsigned int >("-max_columns");
+    threadIncrement = args.getSwitchArgument< unsigned int >("-thread_increment");
+		maxItems = args.getSwitchArgument< unsigned int >("-max_items");
+    width = args.getSwitchArgument< unsigned int >("-width");
+    height = args.getSwitchArgument< unsigned int >("-height");
+    filterWidth = args.getSwitchArgument< unsigned int >("-filter_width");
+    filterHeight = args.getSwitchArgument< unsigned int >("-filter_height");
+    nrChannels = args.getSwitchArgument< unsigned int >("-channels");
+    // Both layouts are tuned, unless one is given
+    try {
+      layouts.push_back(isa::OpenCL::getConvolutionLayout(args.getSwitchArgument< std::string >("-layout")));
+    } catch ( isa::utils::SwitchNotFound & err ) {
+      layouts.push_back(isa::OpenCL::PLANAR);
+      layouts.push_back(isa::OpenCL::INTERLEAVED);
+    }
+	} catch ( isa::utils::EmptyCommandLine & err ) {
+		std::cerr << argv[0] << " -iterations ... [-local] [-layout planar|interleaved] -opencl_platform ... -opencl_device ... -padding ... -thread_unit ... -min_threads ... -max_threads ... -max_items ... -max_columns ... -max_rows ... -thread_increment ... -width ... -height ... -filter_width ... -filter_height ... -channels ..." << std::endl;
+		return 1;
+	} catch ( std::exception & err ) {
+		std::cerr << err.what() << std::endl;
+		return 1;
+	}
+  if ( nrChannels == 0 ) {
+    std::cerr << "At least one channel is necessary." << std::endl;
+    return 1;
+  }
+
+	// Initialize OpenCL
+	cl::Context * clContext = new cl::Context();
+	std::vector< cl::Platform > * clPlatforms = new std::vector< cl::Platform >();
+	std::vector< cl::Device > * clDevices = new std::vector< cl::Device >();
+	std::vector< std::vector< cl::CommandQueue > > * clQueues = new std::vector< std::vector < cl::CommandQueue > >();
+
+  isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, clContext, clDevices, clQueues);
+  isa::OpenCL::KernelCache kernelCache(std::string(), 16);
+  cl_ulong localMemorySize = 0;
+  size_t maxWorkGroupSize = 0;
+  clDevices->at(clDeviceID).getInfo(CL_DEVICE_LOCAL_MEM_SIZE, &localMemorySize);
+  clDevices->at(clDeviceID).getInfo(CL_DEVICE_MAX_WORK_GROUP_SIZE, &maxWorkGroupSize);
+
+  std::vector< dataType > filter = std::vector< dataType >(filterWidth * filterHeight);
+  std::srand(time(0));
+  std::fill(filter.begin(), filter.end(), std::rand() % 100);
+  cl::Buffer filter_d;
+  try {
+    filter_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, filter.size() * sizeof(dataType), 0, 0);
+    clQueues->at(clDeviceID)[0].enqueueWriteBuffer(filter_d, CL_TRUE, 0, filter.size() * sizeof(dataType), reinterpret_cast< void * >(filter.data()));
+  } catch ( cl::Error & err ) {
+    std::cerr << "OpenCL error H2D transfer: " << isa::utils::toString(err.err()) << "." << std::endl;
+    return 1;
+  }
+
+  // Operations are the same in both layouts, the traffic is one read and one write of every channel
+  const double gflops = nrChannels * isa::OpenCL::getConvolutionGFLOP(width, height, filterWidth, filterHeight, 1);
+  const double gbs = isa::utils::giga(static_cast< long long unsigned int >(nrChannels) * ((width + (filterWidth - 1)) * (height + (filterHeight - 1)) + (width * height)) * sizeof(dataType));
+  isa::OpenCL::ConvolutionLayout bestLayout = layouts.front();
+  isa::OpenCL::ConvolutionConf bestConf;
+  double bestTime = 0.0;
+
+	std::cout << std::fixed << std::endl;
+	std::cout << "# width height filterWidth filterHeight channels layout local columnsPerBlock rowsPerBlock columnsPerThread rowsPerThread GFLOP/s GB/s frames/s time stdDeviation COV" << std::endl << std::endl;
+
+  for ( std::vector< isa::OpenCL::ConvolutionLayout >::const_iterator layout = layouts.begin(); layout != layouts.end(); ++layout ) {
+    // Every layout has its own images, the interleaved one is a nrChannels times wider image
+    std::vector< dataType > input = std::vector< dataType >(isa::OpenCL::getChannelsInputSize(*layout, nrChannels, padding, width, height, filterWidth, filterHeight));
+    std::fill(input.begin(), input.end(), std::rand() % 1000);
+    cl::Buffer input_d, output_d;
+    try {
+      input_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, input.size() * sizeof(dataType), 0, 0);
+      output_d = cl::Buffer(*clContext, CL_MEM_WRITE_ONLY, isa::OpenCL::getChannelsOutputSize(*layout, nrChannels, padding, width, height) * sizeof(dataType), 0, 0);
+      clQueues->at(clDeviceID)[0].enqueueWriteBuffer(input_d, CL_TRUE, 0, input.size() * sizeof(dataType), reinterpret_cast< void * >(input.data()));
+    } catch ( cl::Error & err ) {
+      std::cerr << "OpenCL error allocating memory: " << isa::utils::toString(err.err()) << "." << std::endl;
+      return 1;
+    }
+    std::vector< isa::OpenCL::ConvolutionConf > space = isa::OpenCL::getConvolutionSpace(localMem, (*layout == isa::OpenCL::INTERLEAVED) ? width * nrChannels : width, height, 1, threadUnit, minThreads, maxThreads, threadIncrement, maxColumns, maxRows, maxItems, 1);
+
+    for ( std::vector< isa::OpenCL::ConvolutionConf >::const_iterator conf = space.begin(); conf != space.end(); ++conf ) {
+      if ( isa::OpenCL::getChannelsLocalMemory(*layout, *conf, nrChannels, padding, filterWidth, filterHeight, typeName) > localMemorySize || conf->getNrColumnsPerBlock() * conf->getNrRowsPerBlock() > maxWorkGroupSize ) {
+        continue;
+      }
+      isa::utils::Timer timer;
+      cl::Event event;
+      cl::Kernel * kernel;
+      std::string code = isa::OpenCL::getConvolutionChannelsOpenCL(*layout, *conf, nrChannels, padding, width, height, filterWidth, filterHeight, typeName);
+
+      try {
+        kernel = kernelCache.getKernel("convolution", code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+      } catch ( isa::OpenCL::OpenCLError & err ) {
+        std::cerr << conf->print() << std::endl;
+        std::cerr << err.what() << std::endl;
+        continue;
+      }
+
+      cl::NDRange global(isa::OpenCL::getChannelsGlobalColumns(*layout, *conf, nrChannels, width), isa::OpenCL::getConvolutionGlobalRows(*conf, height), isa::OpenCL::getChannelsGlobalImages(*layout, nrChannels));
+      cl::NDRange local(conf->getNrColumnsPerBlock(), conf->getNrRowsPerBlock(), 1);
+
+      kernel->setArg(0, input_d);
+      kernel->setArg(1, output_d);
+      kernel->setArg(2, filter_d);
+
+      // Warm-up run, and tuning runs
+      try {
+        clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+        event.wait();
+        for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+          timer.start();
+          clQueues->at(clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local, 0, &event);
+          event.wait();
+          timer.stop();
+        }
+      } catch ( cl::Error & err ) {
+        std::cerr << conf->print() << std::endl;
+        std::cerr << "OpenCL error kernel execution: " << isa::utils::toString(err.err()) << "." << std::endl;
+        continue;
+      }
+      if ( bestTime == 0.0 || timer.getAverageTime() < bestTime ) {
+        bestLayout = *layout;
+        bestConf = *conf;
+        bestTime = timer.getAverageTime();
+      }
+
+      std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " " << nrChannels << " " << isa::OpenCL::toString(*layout) << " ";
+      std::cout << localMem << " " << conf->getNrColumnsPerBlock() << " " << conf->getNrRowsPerBlock() << " " << conf->getNrColumnsPerThread() << " " << conf->getNrRowsPerThread() << " ";
+      std::cout << std::setprecision(3);
+      std::cout << gflops / timer.getAverageTime() << " ";
+      std::cout << gbs / timer.getAverageTime() << " ";
+      std::cout << 1.0 / timer.getAverageTime() << " ";
+      std::cout << std::setprecision(6);
+      std::cout << timer.getAverageTime() << " " << timer.getStandardDeviation() << " ";
+      std::cout << timer.getCoefficientOfVariation() << std::endl;
+    }
+  }
+
+	std::cout << std::endl;
+  if ( bestTime > 0.0 ) {
+    std::cout << "# best layout columnsPerBlock rowsPerBlock columnsPerThread rowsPerThread GFLOP/s" << std::endl;
+    std::cout << "# " << isa::OpenCL::toString(bestLayout) << " " << bestConf.getNrColumnsPerBlock() << " " << bestConf.getNrRowsPerBlock() << " " << bestConf.getNrColumnsPerThread() << " " << bestConf.getNrRowsPerThread() << " ";
+    std::cout << std::setprecision(3) << gflops / bestTime << std::endl;
+  }
+	std::cout << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,138 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iomanip>
+
+#include <ArgumentList.hpp>
+#include <Convolution.hpp>
+#include <Search.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+
+std::string typeName("float");
+
+
+int main(int argc, char * argv[]) {
+  bool localMem = false;
+  bool constant = false;
+	unsigned int nrIterations = 0;
+  unsigned int padding = 0;
+	unsigned int minThreads = 0;
+  unsigned int maxThreads = 0;
+	unsigned int maxRows = 0;
+	unsigned int maxColumns = 0;
+  unsigned int threadUnit = 0;
+  unsigned int threadIncrement = 0;
+  unsigned int maxItems = 0;
+  unsigned int maxVectorWidth = 0;
+  // I/O size
+  unsigned int width = 0;
+  unsigned int height = 0;
+  unsigned int filterWidth = 0;
+  unsigned int filterHeight = 0;
+  unsigned int nrFilters = 0;
+
+	try {
+    isa::utils::ArgumentList args(argc, argv);
+
+    localMem = args.getSwitch("-local");
+    constant = args.getSwitch("-constant");
+		nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    threadUnit = args.getSwitchArgument< unsigned int >("-thread_unit");
+		minThreads = args.getSwitchArgument< unsigned int >("-min_threads");
+		maxThreads = args.getSwitchArgument< unsigned int >("-max_threads");
+		maxRows = args.getSwitchArgument< unsigned int >("-max_rows");
+		maxColumns = args.getSwitchArgument< unsigned int >("-max_columns");
+    threadIncrement = args.getSwitchArgument< unsigned int >("-thread_increment");
+		maxItems = args.getSwitchArgument< unsigned int >("-max_items");
+    maxVectorWidth = args.getSwitchArgument< unsigned int >("-max_vector");
+    width = args.getSwitchArgument< unsigned int >("-width");
+    height = args.getSwitchArgument< unsigned int >("-height");
+    filterWidth = args.getSwitchArgument< unsigned int >("-filter_width");
+    filterHeight = args.getSwitchArgument< unsigned int >("-filter_height");
+    nrFilters = args.getSwitchArgument< unsigned int >("-filters");
+	} catch ( isa::utils::EmptyCommandLine & err ) {
+		std::cerr << argv[0] << " -iterations ... [-local] [-constant] -padding ... -thread_unit ... -min_threads ... -max_threads ... -max_items ... -max_columns ... -max_rows ... -thread_increment ... -max_vector ... -width ... -height ... -filter_width ... -filter_height ... -filters ..." << std::endl;
+		return 1;
+	} catch ( std::exception & err ) {
+		std::cerr << err.what() << std::endl;
+		return 1;
+	}
+  if ( nrIterations == 0 ) {
+    std::cerr << "At least one iteration is necessary." << std::endl;
+    return 1;
+  }
+
+  const unsigned int inputImageStride = isa::OpenCL::getInputImageSize(padding, width, height, filterWidth, filterHeight);
+  const unsigned int outputImageStride = isa::OpenCL::getOutputImageSize(padding, width, height);
+  std::vector< double > coefficients;
+  std::vector< isa::OpenCL::ConvolutionConf > space = isa::OpenCL::getConvolutionSpace(localMem, width, height, nrFilters, threadUnit, minThreads, maxThreads, threadIncrement, maxColumns, maxRows, maxItems, maxVectorWidth);
+  if ( constant ) {
+    std::vector< isa::OpenCL::ConvolutionConf > bank;
+
+    coefficients = std::vector< double >(nrFilters * filterWidth * filterHeight);
+    for ( unsigned int i = 0; i < coefficients.size(); i++ ) {
+      coefficients[i] = (i % 100) + 1;
+    }
+    // Constant kernels compute all the filters in every work-item
+    for ( std::vector< isa::OpenCL::ConvolutionConf >::const_iterator conf = space.begin(); conf != space.end(); ++conf ) {
+      if ( conf->getNrFiltersPerThread() == nrFilters ) {
+        bank.push_back(*conf);
+      }
+    }
+    space = bank;
+  }
+  isa::utils::Timer totalTimer;
+  long long unsigned int totalSize = 0;
+
+  std::cout << std::fixed << std::endl;
+  std::cout << "# width height filterWidth filterHeight filters local columnsPerBlock rowsPerBlock columnsPerThread rowsPerThread filtersPerThread vectorWidth size(B) time(us) stdDeviation(us) MB/s" << std::endl << std::endl;
+  for ( std::vector< isa::OpenCL::ConvolutionConf >::const_iterator conf = space.begin(); conf != space.end(); ++conf ) {
+    isa::utils::Timer timer;
+    size_t size = 0;
+
+    for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+      timer.start();
+      std::string code = isa::OpenCL::getConvolutionOpenCLSource(*conf, padding, width, height, filterWidth, filterHeight, nrFilters, inputImageStride, outputImageStride, typeName, coefficients);
+      timer.stop();
+      size = code.size();
+    }
+    totalTimer.start();
+    isa::OpenCL::getConvolutionOpenCLSource(*conf, padding, width, height, filterWidth, filterHeight, nrFilters, inputImageStride, outputImageStride, typeName, coefficients);
+    totalTimer.stop();
+    totalSize += size;
+    std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " " << nrFilters << " ";
+    std::cout << conf->print() << " ";
+    std::cout << size << " ";
+    std::cout << std::setprecision(3);
+    std::cout << timer.getAverageTime() * 1.0e6 << " " << timer.getStandardDeviation() * 1.0e6 << " ";
+    std::cout << isa::utils::mega(size) / timer.getAverageTime() << std::endl;
+  }
+  std::cout << std::endl;
+  std::cout << "# configurations size(B) time(s) MB/s" << std::endl;
+  std::cout << space.size() << " " << totalSize << " ";
+  std::cout << std::setprecision(6);
+  std::cout << totalTimer.getTotalTime() << " ";
+  std::cout << std::setprecision(3);
+  std::cout << isa::utils::mega(totalSize) / totalTimer.getTotalTime() << std::endl;
+  std::cout << std::endl;
+
+	return 0;
+}
+
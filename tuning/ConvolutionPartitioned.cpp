@@ -0,0 +1,240 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
+#include <algorithm>
+
+#include <ArgumentList.hpp>
+#include <InitializeOpenCL.hpp>
+#include <Kernel.hpp>
+#include <Convolution.hpp>
+#include <TuningDatabase.hpp>
+#include <Partition.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+
+typedef float dataType;
+std::string typeName("float");
+
+// Optional arguments keep their default value when missing
+template< typename T > void getOptionalArgument(isa::utils::ArgumentList & args, const std::string & option, T & value);
+// Items of a comma separated list
+std::vector< std::string > getNames(const std::string & list);
+
+int main(int argc, char * argv[]) {
+  bool localMem = false;
+	unsigned int nrIterations = 0;
+  unsigned int padding = 0;
+	unsigned int clPlatformID = 0;
+  std::string deviceList;
+  unsigned int nrComputeUnits = 0;
+  std::string databaseName;
+  isa::OpenCL::ConvolutionConf conf;
+  long long unsigned int wrongItems = 0;
+  // I/O size
+  unsigned int width = 0;
+  unsigned int height = 0;
+  unsigned int filterWidth = 0;
+  unsigned int filterHeight = 0;
+
+	try {
+    isa::utils::ArgumentList args(argc, argv);
+
+    localMem = args.getSwitch("-local");
+		nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
+		clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
+    deviceList = args.getSwitchArgument< std::string >("-opencl_devices");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    conf.setNrColumnsPerBlock(args.getSwitchArgument< unsigned int >("-cb"));
+    conf.setNrRowsPerBlock(args.getSwitchArgument< unsigned int >("-rb"));
+    conf.setNrColumnsPerThread(args.getSwitchArgument< unsigned int >("-ct"));
+    conf.setNrRowsPerThread(args.getSwitchArgument< unsigned int >("-rt"));
+    width = args.getSwitchArgument< unsigned int >("-width");
+    height = args.getSwitchArgument< unsigned int >("-height");
+    filterWidth = args.getSwitchArgument< unsigned int >("-filter_width");
+    filterHeight = args.getSwitchArgument< unsigned int >("-filter_height");
+    // With -sub_devices the first device is split in sub-devices of that many compute units, and the other devices are ignored
+    getOptionalArgument(args, "-sub_devices", nrComputeUnits);
+    // Tuned devices use their configuration from the database, and are weighted by its performance
+    getOptionalArgument(args, "-database", databaseName);
+	} catch ( isa::utils::EmptyCommandLine & err ) {
+		std::cerr << argv[0] << " -iterations ... [-local] [-sub_devices ...] [-database ...] -opencl_platform ... -opencl_devices ... -padding ... -cb ... -rb ... -ct ... -rt ... -width ... -height ... -filter_width ... -filter_height ..." << std::endl;
+		return 1;
+	} catch ( std::exception & err ) {
+		std::cerr << err.what() << std::endl;
+		return 1;
+	}
+  conf.setLocalMemory(localMem);
+  std::vector< std::string > deviceNames = getNames(deviceList);
+  if ( deviceNames.empty() ) {
+    std::cerr << "At least one device is necessary." << std::endl;
+    return 1;
+  }
+
+	// Initialize OpenCL
+	cl::Context * clContext = new cl::Context();
+	std::vector< cl::Platform > * clPlatforms = new std::vector< cl::Platform >();
+	std::vector< cl::Device > * clDevices = new std::vector< cl::Device >();
+	std::vector< std::vector< cl::CommandQueue > > * clQueues = new std::vector< std::vector < cl::CommandQueue > >();
+
+  isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, clContext, clDevices, clQueues);
+  std::vector< cl::Device > devices;
+  try {
+    for ( unsigned int device = 0; device < deviceNames.size(); device++ ) {
+      devices.push_back(clDevices->at(std::atoi(deviceNames[device].c_str())));
+    }
+    // Sub-devices need a context of their own
+    if ( nrComputeUnits > 0 ) {
+      devices = isa::OpenCL::getConvolutionSubDevices(devices.front(), nrComputeUnits);
+      delete clContext;
+      clContext = new cl::Context(devices);
+    }
+  } catch ( std::out_of_range & err ) {
+    std::cerr << "No OpenCL device " << deviceList << "." << std::endl;
+    return 1;
+  } catch ( cl::Error & err ) {
+    std::cerr << "OpenCL error creating the context: " << isa::utils::toString(err.err()) << "." << std::endl;
+    return 1;
+  } catch ( std::runtime_error & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  // Configurations and weights of the devices
+  isa::OpenCL::TuningDatabase database;
+  if ( !databaseName.empty() && std::ifstream(databaseName.c_str()) ) {
+    try {
+      database.read(databaseName);
+    } catch ( std::runtime_error & err ) {
+      std::cerr << err.what() << std::endl;
+      return 1;
+    }
+  }
+  std::vector< std::string > names(devices.size());
+  std::vector< isa::OpenCL::ConvolutionConf > confs(devices.size(), conf);
+  for ( unsigned int device = 0; device < devices.size(); device++ ) {
+    devices[device].getInfo(CL_DEVICE_NAME, &(names[device]));
+    try {
+      confs[device] = database.getConf(names[device], typeName, width, height, filterWidth, filterHeight, 1, false);
+    } catch ( std::out_of_range & err ) {
+      confs[device] = conf;
+    }
+  }
+  std::vector< double > weights = isa::OpenCL::getConvolutionWeights(database, names, typeName, width, height, filterWidth, filterHeight);
+
+	// Allocate host memory
+  std::vector< dataType > input = std::vector< dataType >(isa::OpenCL::getInputImageSize(padding, width, height, filterWidth, filterHeight));
+  std::vector< dataType > output = std::vector< dataType >(isa::OpenCL::getOutputImageSize(padding, width, height));
+  std::vector< dataType > output_c = std::vector< dataType >(isa::OpenCL::getOutputImageSize(padding, width, height));
+  std::vector< dataType > filter = std::vector< dataType >(filterWidth * filterHeight);
+  std::srand(time(0));
+  for ( unsigned int i = 0; i < filter.size(); i++ ) {
+    filter[i] = std::rand() % 100;
+  }
+  for ( unsigned int i = 0; i < input.size(); i++ ) {
+    input[i] = std::rand() % 1000;
+  }
+
+  isa::utils::Timer singleTimer;
+  isa::utils::Timer partitionedTimer;
+  std::vector< isa::OpenCL::ConvolutionPartition > partitions;
+
+  try {
+    // The baseline runs the whole image on the first device
+    std::vector< cl::Device > firstDevice(1, devices.front());
+    isa::OpenCL::PartitionedConvolver< dataType > single(*clContext, firstDevice, std::vector< isa::OpenCL::ConvolutionConf >(1, confs.front()), std::vector< double >(1, 1.0), padding, width, height, filterWidth, filterHeight, filter, typeName);
+    isa::OpenCL::PartitionedConvolver< dataType > partitioned(*clContext, devices, confs, weights, padding, width, height, filterWidth, filterHeight, filter, typeName);
+
+    partitions = partitioned.getPartitions();
+    // Warm-up runs
+    single.convolve(input, output);
+    partitioned.convolve(input, output);
+    // Benchmark runs
+    for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+      singleTimer.start();
+      single.convolve(input, output);
+      singleTimer.stop();
+      std::fill(output.begin(), output.end(), 0);
+      partitionedTimer.start();
+      partitioned.convolve(input, output);
+      partitionedTimer.stop();
+    }
+  } catch ( std::exception & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  // Check the output of the last partitioned run
+  isa::OpenCL::convolutionBatched< dataType >(1, input.size(), output.size(), padding, width, height, filterWidth, filterHeight, input, output_c, filter);
+  for ( unsigned int y = 0; y < height; y++ ) {
+    for ( unsigned int x = 0; x < width; x++ ) {
+      if ( !isa::utils::same(output[(y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+        wrongItems++;
+      }
+    }
+  }
+  if ( wrongItems > 0 ) {
+    std::cout << "Wrong items: " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height) << "%)." << std::endl;
+    return 1;
+  }
+
+	std::cout << std::fixed << std::endl;
+  std::cout << "# device name weight firstRow rows columnsPerBlock rowsPerBlock columnsPerThread rowsPerThread" << std::endl;
+  for ( unsigned int device = 0; device < devices.size(); device++ ) {
+    std::cout << "# " << device << " \"" << names[device] << "\" " << std::setprecision(3) << weights[device] << " " << partitions[device].firstRow << " " << partitions[device].nrRows << " ";
+    std::cout << confs[device].getNrColumnsPerBlock() << " " << confs[device].getNrRowsPerBlock() << " " << confs[device].getNrColumnsPerThread() << " " << confs[device].getNrRowsPerThread() << std::endl;
+  }
+  std::cout << std::endl;
+  std::cout << "# width height filterWidth filterHeight devices single(frames/s) partitioned(frames/s) speedup" << std::endl << std::endl;
+  std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " " << devices.size() << " ";
+  std::cout << std::setprecision(3);
+  std::cout << 1.0 / singleTimer.getAverageTime() << " ";
+  std::cout << 1.0 / partitionedTimer.getAverageTime() << " ";
+  std::cout << singleTimer.getAverageTime() / partitionedTimer.getAverageTime() << std::endl;
+	std::cout << std::endl;
+
+	return 0;
+}
+
+template< typename T > void getOptionalArgument(isa::utils::ArgumentList & args, const std::string & option, T & value) {
+  try {
+    value = args.getSwitchArgument< T >(option);
+  } catch ( isa::utils::SwitchNotFound & err ) {
+  }
+}
+
+std::vector< std::string > getNames(const std::string & list) {
+  std::vector< std::string > names;
+  size_t begin = 0;
+
+  while ( begin <= list.size() ) {
+    size_t end = list.find(',', begin);
+
+    if ( end == std::string::npos ) {
+      end = list.size();
+    }
+    if ( end > begin ) {
+      names.push_back(list.substr(begin, end - begin));
+    }
+    begin = end + 1;
+  }
+  return names;
+}
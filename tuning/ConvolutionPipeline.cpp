@@ -0,0 +1,178 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iomanip>
+#include <ctime>
+#include <algorithm>
+
+#include <ArgumentList.hpp>
+#include <InitializeOpenCL.hpp>
+#include <Kernel.hpp>
+#include <KernelCache.hpp>
+#include <Convolution.hpp>
+#include <Pipeline.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+
+typedef float dataType;
+std::string typeName("float");
+
+
+int main(int argc, char * argv[]) {
+  bool localMem = false;
+	unsigned int nrIterations = 0;
+  unsigned int padding = 0;
+	unsigned int clPlatformID = 0;
+	unsigned int clDeviceID = 0;
+  unsigned int nrQueues = 0;
+  unsigned int nrBuffers = 0;
+  isa::OpenCL::ConvolutionConf conf;
+  long long unsigned int wrongItems = 0;
+  // I/O size
+  unsigned int width = 0;
+  unsigned int height = 0;
+  unsigned int filterWidth = 0;
+  unsigned int filterHeight = 0;
+  unsigned int nrFrames = 0;
+
+	try {
+    isa::utils::ArgumentList args(argc, argv);
+
+    localMem = args.getSwitch("-local");
+		nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
+		clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
+		clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    nrQueues = args.getSwitchArgument< unsigned int >("-queues");
+    nrBuffers = args.getSwitchArgument< unsigned int >("-buffers");
+    conf.setNrColumnsPerBlock(args.getSwitchArgument< unsigned int >("-cb"));
+    conf.setNrRowsPerBlock(args.getSwitchArgument< unsigned int >("-rb"));
+    conf.setNrColumnsPerThread(args.getSwitchArgument< unsigned int >("-ct"));
+    conf.setNrRowsPerThread(args.getSwitchArgument< unsigned int >("-rt"));
+    width = args.getSwitchArgument< unsigned int >("-width");
+    height = args.getSwitchArgument< unsigned int >("-height");
+    filterWidth = args.getSwitchArgument< unsigned int >("-filter_width");
+    filterHeight = args.getSwitchArgument< unsigned int >("-filter_height");
+    nrFrames = args.getSwitchArgument< unsigned int >("-frames");
+	} catch ( isa::utils::EmptyCommandLine & err ) {
+		std::cerr << argv[0] << " -iterations ... [-local] -opencl_platform ... -opencl_device ... -padding ... -queues ... -buffers ... -cb ... -rb ... -ct ... -rt ... -width ... -height ... -filter_width ... -filter_height ... -frames ..." << std::endl;
+		return 1;
+	} catch ( std::exception & err ) {
+		std::cerr << err.what() << std::endl;
+		return 1;
+	}
+  conf.setLocalMemory(localMem);
+
+	// Initialize OpenCL
+	cl::Context * clContext = new cl::Context();
+	std::vector< cl::Platform > * clPlatforms = new std::vector< cl::Platform >();
+	std::vector< cl::Device > * clDevices = new std::vector< cl::Device >();
+	std::vector< std::vector< cl::CommandQueue > > * clQueues = new std::vector< std::vector < cl::CommandQueue > >();
+
+  isa::OpenCL::initializeOpenCL(clPlatformID, nrQueues, clPlatforms, clContext, clDevices, clQueues);
+  isa::OpenCL::KernelCache kernelCache(std::string(), 1);
+
+	// Allocate host memory, one image per frame
+  const unsigned int inputImageStride = isa::OpenCL::getInputImageSize(padding, width, height, filterWidth, filterHeight);
+  const unsigned int outputImageStride = isa::OpenCL::getOutputImageSize(padding, width, height);
+  std::vector< dataType > input = std::vector< dataType >(nrFrames * inputImageStride);
+  std::vector< dataType > output = std::vector< dataType >(nrFrames * outputImageStride);
+  std::vector< dataType > output_c = std::vector< dataType >(nrFrames * outputImageStride);
+  std::vector< dataType > filter = std::vector< dataType >(filterWidth * filterHeight);
+  std::srand(time(0));
+  for ( unsigned int i = 0; i < filter.size(); i++ ) {
+    filter[i] = std::rand() % 100;
+  }
+  for ( unsigned int i = 0; i < input.size(); i++ ) {
+    input[i] = std::rand() % 1000;
+  }
+
+  // Generate kernel, and copy the filter to the device
+  cl::Kernel * kernel;
+  cl::Buffer filter_d;
+  std::string code = isa::OpenCL::getConvolutionOpenCLSource(conf, padding, width, height, filterWidth, filterHeight, 1, inputImageStride, outputImageStride, typeName);
+  try {
+    kernel = kernelCache.getKernel("convolution", code, "-cl-mad-enable -Werror", *clContext, clDevices->at(clDeviceID));
+    filter_d = cl::Buffer(*clContext, CL_MEM_READ_ONLY, filter.size() * sizeof(dataType), 0, 0);
+    clQueues->at(clDeviceID)[0].enqueueWriteBuffer(filter_d, CL_TRUE, 0, filter.size() * sizeof(dataType), reinterpret_cast< void * >(filter.data()));
+    kernel->setArg(2, filter_d);
+  } catch ( isa::OpenCL::OpenCLError & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  } catch ( cl::Error & err ) {
+    std::cerr << "OpenCL error: " << isa::utils::toString(err.err()) << "." << std::endl;
+    return 1;
+  }
+
+  cl::NDRange global(isa::OpenCL::getConvolutionGlobalColumns(conf, width), isa::OpenCL::getConvolutionGlobalRows(conf, height), 1);
+  cl::NDRange local(conf.getNrColumnsPerBlock(), conf.getNrRowsPerBlock(), 1);
+  isa::utils::Timer serialTimer;
+  isa::utils::Timer pipelineTimer;
+
+  try {
+    // The serial baseline has one buffer and one queue, so every frame waits for the previous one
+    std::vector< cl::CommandQueue > serialQueues(1, clQueues->at(clDeviceID)[0]);
+    isa::OpenCL::ConvolutionPipeline serial(1, inputImageStride * sizeof(dataType), outputImageStride * sizeof(dataType), *clContext, serialQueues);
+    isa::OpenCL::ConvolutionPipeline pipeline(nrBuffers, inputImageStride * sizeof(dataType), outputImageStride * sizeof(dataType), *clContext, clQueues->at(clDeviceID));
+
+    // Warm-up runs
+    serial.run(nrFrames, input.data(), output.data(), *kernel, global, local);
+    pipeline.run(nrFrames, input.data(), output.data(), *kernel, global, local);
+    // Benchmark runs
+    for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+      serialTimer.start();
+      serial.run(nrFrames, input.data(), output.data(), *kernel, global, local);
+      serialTimer.stop();
+      std::fill(output.begin(), output.end(), 0);
+      pipelineTimer.start();
+      pipeline.run(nrFrames, input.data(), output.data(), *kernel, global, local);
+      pipelineTimer.stop();
+    }
+  } catch ( std::exception & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  // Check the frames of the last pipelined run
+  isa::OpenCL::convolutionBatched< dataType >(nrFrames, inputImageStride, outputImageStride, padding, width, height, filterWidth, filterHeight, input, output_c, filter);
+  for ( unsigned int frame = 0; frame < nrFrames; frame++ ) {
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(output[(frame * outputImageStride) + (y * isa::utils::pad(width, padding)) + x], output_c[(frame * outputImageStride) + (y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
+  }
+  if ( wrongItems > 0 ) {
+    std::cout << "Wrong items: " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height * nrFrames) << "%)." << std::endl;
+    return 1;
+  }
+
+	std::cout << std::fixed << std::endl;
+  std::cout << "# width height filterWidth filterHeight frames queues buffers serial(frames/s) pipelined(frames/s) speedup" << std::endl << std::endl;
+  std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " " << nrFrames << " " << clQueues->at(clDeviceID).size() << " " << nrBuffers << " ";
+  std::cout << std::setprecision(3);
+  std::cout << nrFrames / serialTimer.getAverageTime() << " ";
+  std::cout << nrFrames / pipelineTimer.getAverageTime() << " ";
+  std::cout << serialTimer.getAverageTime() / pipelineTimer.getAverageTime() << std::endl;
+	std::cout << std::endl;
+
+	return 0;
+}
+
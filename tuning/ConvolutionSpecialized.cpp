@@ -0,0 +1,100 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iomanip>
+#include <ctime>
+#include <algorithm>
+
+#include <ArgumentList.hpp>
+#include <Convolution.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+
+typedef float dataType;
+
+
+int main(int argc, char * argv[]) {
+	unsigned int nrIterations = 0;
+  unsigned int padding = 0;
+  unsigned int nrColumnsPerTile = 0;
+  unsigned int nrRowsPerTile = 0;
+  // I/O size
+  unsigned int width = 0;
+  unsigned int height = 0;
+  const unsigned int filterSizes[] = {3, 5, 7, 11};
+
+	try {
+    isa::utils::ArgumentList args(argc, argv);
+
+		nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    width = args.getSwitchArgument< unsigned int >("-width");
+    height = args.getSwitchArgument< unsigned int >("-height");
+	} catch ( isa::utils::EmptyCommandLine & err ) {
+		std::cerr << argv[0] << " -iterations ... -padding ... -width ... -height ..." << std::endl;
+		return 1;
+	} catch ( std::exception & err ) {
+		std::cerr << err.what() << std::endl;
+		return 1;
+	}
+
+	std::cout << std::fixed << std::endl;
+	std::cout << "# width height filterWidth filterHeight columnsPerTile rowsPerTile generic(GFLOP/s) specialized(GFLOP/s) speedup" << std::endl << std::endl;
+
+  for ( unsigned int size = 0; size < sizeof(filterSizes) / sizeof(unsigned int); size++ ) {
+    const unsigned int filterWidth = filterSizes[size];
+    const unsigned int filterHeight = filterSizes[size];
+
+    // Allocate host memory
+    std::vector< dataType > input = std::vector< dataType >((height + (filterHeight - 1)) * isa::utils::pad(width + (filterWidth - 1), padding));
+    std::vector< dataType > output = std::vector< dataType >(height * isa::utils::pad(width, padding));
+    std::vector< dataType > filter = std::vector< dataType >(filterWidth * filterHeight);
+    std::srand(time(0));
+    std::fill(filter.begin(), filter.end(), std::rand() % 100);
+    std::fill(input.begin(), input.end(), std::rand() % 1000);
+
+    double gflops = isa::OpenCL::getConvolutionGFLOP(width, height, filterWidth, filterHeight, 1);
+    isa::utils::Timer genericTimer;
+    isa::utils::Timer specializedTimer;
+
+    isa::OpenCL::getConvolutionTile< dataType >(width, height, filterWidth, filterHeight, 32 * 1024, 256 * 1024, nrColumnsPerTile, nrRowsPerTile);
+    // Warm-up runs
+    isa::OpenCL::convolutionParallel< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+    isa::OpenCL::convolutionSpecialized< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+    // Benchmark runs
+    for ( unsigned int iteration = 0; iteration < nrIterations; iteration++ ) {
+      genericTimer.start();
+      isa::OpenCL::convolutionParallel< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+      genericTimer.stop();
+      specializedTimer.start();
+      isa::OpenCL::convolutionSpecialized< dataType >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+      specializedTimer.stop();
+    }
+
+    std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " ";
+    std::cout << nrColumnsPerTile << " " << nrRowsPerTile << " ";
+    std::cout << std::setprecision(3);
+    std::cout << gflops / genericTimer.getAverageTime() << " ";
+    std::cout << gflops / specializedTimer.getAverageTime() << " ";
+    std::cout << genericTimer.getAverageTime() / specializedTimer.getAverageTime() << std::endl;
+  }
+
+	std::cout << std::endl;
+
+	return 0;
+}
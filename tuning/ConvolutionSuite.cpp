@@ -0,0 +1,406 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <omp.h>
+
+#include <ArgumentList.hpp>
+#include <InitializeOpenCL.hpp>
+#include <Kernel.hpp>
+#include <Convolution.hpp>
+#include <ConvolutionSIMD.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+
+// Measurements of one backend, data type, image and filter
+struct SuiteResult {
+  std::string backend;
+  std::string type;
+  unsigned int width;
+  unsigned int height;
+  unsigned int filterWidth;
+  unsigned int filterHeight;
+  std::string configuration;
+  double gflop;
+  double gb;
+  bool correct;
+  // Seconds, sorted
+  std::vector< double > times;
+};
+
+// OpenCL device used by the opencl backend
+struct SuiteDevice {
+  cl::Context * clContext;
+  std::vector< cl::Device > * clDevices;
+  std::vector< std::vector< cl::CommandQueue > > * clQueues;
+  unsigned int clDeviceID;
+  bool local;
+};
+
+// Optional arguments keep their default value when missing
+template< typename T > void getOptionalArgument(isa::utils::ArgumentList & args, const std::string & option, T & value);
+// Comma separated list of "AxB" pairs
+std::vector< std::pair< unsigned int, unsigned int > > getSizes(const std::string & list);
+// Comma separated list of names
+std::vector< std::string > getNames(const std::string & list);
+// Nearest-rank percentile of sorted times
+double getPercentile(const std::vector< double > & times, const double percentile);
+// Run every backend for one data type, image and filter, appending the results
+template< typename T > void benchmark(const std::vector< std::string > & backends, std::string & typeName, const unsigned int seed, const unsigned int nrIterations, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, SuiteDevice * device, std::vector< SuiteResult > & results);
+void writeJSON(std::ostream & json, const std::vector< SuiteResult > & results, const unsigned int seed, const unsigned int nrIterations, const unsigned int padding, const std::string & deviceName);
+
+int main(int argc, char * argv[]) {
+  unsigned int nrIterations = 0;
+  unsigned int padding = 0;
+  unsigned int seed = 0;
+  bool localMem = false;
+  int clPlatformID = -1;
+  unsigned int clDeviceID = 0;
+  std::string sizeList("256x256,1024x1024");
+  std::string filterList("3x3,5x5,7x7");
+  std::string typeList("float,double,uchar");
+  std::string backendList("sequential,parallel,specialized,simd");
+  std::string outputName;
+
+  try {
+    isa::utils::ArgumentList args(argc, argv);
+
+    localMem = args.getSwitch("-local");
+    nrIterations = args.getSwitchArgument< unsigned int >("-iterations");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    getOptionalArgument(args, "-seed", seed);
+    getOptionalArgument(args, "-sizes", sizeList);
+    getOptionalArgument(args, "-filters", filterList);
+    getOptionalArgument(args, "-types", typeList);
+    getOptionalArgument(args, "-backends", backendList);
+    getOptionalArgument(args, "-output", outputName);
+    // Without a platform the OpenCL backend is not run
+    getOptionalArgument(args, "-opencl_platform", clPlatformID);
+    getOptionalArgument(args, "-opencl_device", clDeviceID);
+  } catch ( isa::utils::EmptyCommandLine & err ) {
+    std::cerr << argv[0] << " -iterations ... -padding ... [-seed ...] [-sizes WxH,...] [-filters WxH,...] [-types float,double,uchar] [-backends sequential,parallel,specialized,simd,opencl] [-output ...] [-opencl_platform ... -opencl_device ... [-local]]" << std::endl;
+    return 1;
+  } catch ( std::exception & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+  std::vector< std::pair< unsigned int, unsigned int > > sizes = getSizes(sizeList);
+  std::vector< std::pair< unsigned int, unsigned int > > filters = getSizes(filterList);
+  std::vector< std::string > types = getNames(typeList);
+  std::vector< std::string > backends = getNames(backendList);
+  if ( nrIterations == 0 ) {
+    std::cerr << "At least one iteration is necessary." << std::endl;
+    return 1;
+  } else if ( sizes.empty() || filters.empty() || types.empty() || backends.empty() ) {
+    std::cerr << "Nothing to benchmark." << std::endl;
+    return 1;
+  }
+  if ( clPlatformID >= 0 && std::find(backends.begin(), backends.end(), "opencl") == backends.end() ) {
+    backends.push_back("opencl");
+  }
+
+  SuiteDevice * device = 0;
+  std::string deviceName;
+  if ( std::find(backends.begin(), backends.end(), "opencl") != backends.end() ) {
+    if ( clPlatformID < 0 ) {
+      std::cerr << "The OpenCL backend needs -opencl_platform and -opencl_device." << std::endl;
+      return 1;
+    }
+    device = new SuiteDevice();
+    device->clContext = new cl::Context();
+    device->clDevices = new std::vector< cl::Device >();
+    device->clQueues = new std::vector< std::vector< cl::CommandQueue > >();
+    device->clDeviceID = clDeviceID;
+    device->local = localMem;
+    std::vector< cl::Platform > * clPlatforms = new std::vector< cl::Platform >();
+    isa::OpenCL::initializeOpenCL(clPlatformID, 1, clPlatforms, device->clContext, device->clDevices, device->clQueues);
+    deviceName = device->clDevices->at(clDeviceID).getInfo< CL_DEVICE_NAME >();
+    delete clPlatforms;
+  }
+
+  std::vector< SuiteResult > results;
+  try {
+    for ( unsigned int type = 0; type < types.size(); type++ ) {
+      for ( unsigned int size = 0; size < sizes.size(); size++ ) {
+        for ( unsigned int filter = 0; filter < filters.size(); filter++ ) {
+          if ( types[type] == "float" ) {
+            benchmark< float >(backends, types[type], seed, nrIterations, padding, sizes[size].first, sizes[size].second, filters[filter].first, filters[filter].second, device, results);
+          } else if ( types[type] == "double" ) {
+            benchmark< double >(backends, types[type], seed, nrIterations, padding, sizes[size].first, sizes[size].second, filters[filter].first, filters[filter].second, device, results);
+          } else if ( types[type] == "uchar" ) {
+            benchmark< unsigned char >(backends, types[type], seed, nrIterations, padding, sizes[size].first, sizes[size].second, filters[filter].first, filters[filter].second, device, results);
+          } else {
+            throw std::invalid_argument("Unknown data type: " + types[type] + ".");
+          }
+        }
+      }
+    }
+  } catch ( std::exception & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  if ( outputName.empty() ) {
+    writeJSON(std::cout, results, seed, nrIterations, padding, deviceName);
+  } else {
+    std::ofstream output(outputName.c_str());
+
+    writeJSON(output, results, seed, nrIterations, padding, deviceName);
+  }
+  // A wrong result is a failure, so that regressions in correctness are caught as well
+  for ( unsigned int result = 0; result < results.size(); result++ ) {
+    if ( !results[result].correct ) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+template< typename T > void getOptionalArgument(isa::utils::ArgumentList & args, const std::string & option, T & value) {
+  try {
+    value = args.getSwitchArgument< T >(option);
+  } catch ( isa::utils::SwitchNotFound & err ) {
+  }
+}
+
+std::vector< std::pair< unsigned int, unsigned int > > getSizes(const std::string & list) {
+  std::vector< std::pair< unsigned int, unsigned int > > sizes;
+  std::vector< std::string > names = getNames(list);
+
+  for ( unsigned int name = 0; name < names.size(); name++ ) {
+    size_t separator = names[name].find('x');
+
+    if ( separator == std::string::npos ) {
+      throw std::invalid_argument("Sizes are written as WIDTHxHEIGHT: " + names[name] + ".");
+    }
+    sizes.push_back(std::make_pair(static_cast< unsigned int >(std::atoi(names[name].substr(0, separator).c_str())), static_cast< unsigned int >(std::atoi(names[name].substr(separator + 1).c_str()))));
+    if ( sizes.back().first == 0 || sizes.back().second == 0 ) {
+      throw std::invalid_argument("Sizes must be positive: " + names[name] + ".");
+    }
+  }
+  return sizes;
+}
+
+std::vector< std::string > getNames(const std::string & list) {
+  std::vector< std::string > names;
+  size_t begin = 0;
+
+  while ( begin <= list.size() ) {
+    size_t end = list.find(',', begin);
+
+    if ( end == std::string::npos ) {
+      end = list.size();
+    }
+    if ( end > begin ) {
+      names.push_back(list.substr(begin, end - begin));
+    }
+    begin = end + 1;
+  }
+  return names;
+}
+
+double getPercentile(const std::vector< double > & times, const double percentile) {
+  unsigned int rank = static_cast< unsigned int >(std::ceil((percentile / 100.0) * times.size()));
+
+  if ( rank == 0 ) {
+    rank = 1;
+  }
+  return times[rank - 1];
+}
+
+template< typename T > void benchmark(const std::vector< std::string > & backends, std::string & typeName, const unsigned int seed, const unsigned int nrIterations, const unsigned int padding, const unsigned int width, const unsigned int height, const unsigned int filterWidth, const unsigned int filterHeight, SuiteDevice * device, std::vector< SuiteResult > & results) {
+  const unsigned int inputImageStride = isa::OpenCL::getInputImageSize(padding, width, height, filterWidth, filterHeight);
+  const unsigned int outputImageStride = isa::OpenCL::getOutputImageSize(padding, width, height);
+  std::vector< T > input = std::vector< T >(inputImageStride);
+  std::vector< T > output = std::vector< T >(outputImageStride);
+  std::vector< T > output_c = std::vector< T >(outputImageStride);
+  std::vector< T > filter = std::vector< T >(filterWidth * filterHeight);
+  unsigned int nrColumnsPerTile = 0;
+  unsigned int nrRowsPerTile = 0;
+
+  // The same seed produces the same images on every run
+  std::srand(seed);
+  for ( unsigned int i = 0; i < filter.size(); i++ ) {
+    filter[i] = std::rand() % 10;
+  }
+  for ( unsigned int i = 0; i < input.size(); i++ ) {
+    input[i] = std::rand() % 100;
+  }
+  isa::OpenCL::convolution< T >(padding, width, height, filterWidth, filterHeight, input, output_c, filter);
+  isa::OpenCL::getConvolutionTile< T >(width, height, filterWidth, filterHeight, 32 * 1024, 256 * 1024, nrColumnsPerTile, nrRowsPerTile);
+
+  for ( unsigned int backend = 0; backend < backends.size(); backend++ ) {
+    SuiteResult result;
+    isa::OpenCL::ConvolutionConf conf;
+    cl::Kernel * kernel = 0;
+    cl::Buffer input_d, output_d, filter_d;
+    cl::NDRange global, local;
+
+    result.backend = backends[backend];
+    result.type = typeName;
+    result.width = width;
+    result.height = height;
+    result.filterWidth = filterWidth;
+    result.filterHeight = filterHeight;
+    // The CPU tiles are the work-groups of the traffic model: every tile and its border are read once
+    if ( backends[backend] != "sequential" ) {
+      conf.setLocalMemory(true);
+      conf.setNrColumnsPerBlock(std::min(nrColumnsPerTile, width));
+      conf.setNrRowsPerBlock(std::min(nrRowsPerTile, height));
+    }
+    if ( backends[backend] == "opencl" ) {
+      // Work-groups of 32x8, smaller only for smaller images; the last work-groups are tails if they do not divide the image
+      conf.setLocalMemory(device->local);
+      conf.setNrColumnsPerBlock(std::min(32u, width));
+      conf.setNrRowsPerBlock(std::min(8u, height));
+      std::string code = isa::OpenCL::getConvolutionOpenCLSource(conf, padding, width, height, filterWidth, filterHeight, 1, inputImageStride, outputImageStride, typeName);
+      if ( typeName == "double" ) {
+        code = "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n" + code;
+      }
+      try {
+        kernel = isa::OpenCL::compile("convolution", code, "-cl-mad-enable -Werror", *(device->clContext), device->clDevices->at(device->clDeviceID));
+        input_d = cl::Buffer(*(device->clContext), CL_MEM_READ_ONLY, input.size() * sizeof(T), 0, 0);
+        output_d = cl::Buffer(*(device->clContext), CL_MEM_WRITE_ONLY, output.size() * sizeof(T), 0, 0);
+        filter_d = cl::Buffer(*(device->clContext), CL_MEM_READ_ONLY, filter.size() * sizeof(T), 0, 0);
+        device->clQueues->at(device->clDeviceID)[0].enqueueWriteBuffer(input_d, CL_TRUE, 0, input.size() * sizeof(T), reinterpret_cast< void * >(input.data()));
+        device->clQueues->at(device->clDeviceID)[0].enqueueWriteBuffer(filter_d, CL_TRUE, 0, filter.size() * sizeof(T), reinterpret_cast< void * >(filter.data()));
+        kernel->setArg(0, input_d);
+        kernel->setArg(1, output_d);
+        kernel->setArg(2, filter_d);
+      } catch ( isa::OpenCL::OpenCLError & err ) {
+        // A device without support for the type is skipped
+        std::cerr << typeName << ": " << err.what() << std::endl;
+        continue;
+      } catch ( cl::Error & err ) {
+        throw std::runtime_error("OpenCL error: " + isa::utils::toString(err.err()) + ".");
+      }
+      global = cl::NDRange(isa::OpenCL::getConvolutionGlobalColumns(conf, width), isa::OpenCL::getConvolutionGlobalRows(conf, height), 1);
+      local = cl::NDRange(conf.getNrColumnsPerBlock(), conf.getNrRowsPerBlock(), 1);
+    } else if ( backends[backend] != "sequential" && backends[backend] != "parallel" && backends[backend] != "specialized" && backends[backend] != "simd" ) {
+      throw std::invalid_argument("Unknown backend: " + backends[backend] + ".");
+    }
+    result.configuration = conf.print();
+    result.gflop = isa::OpenCL::getConvolutionGFLOP(width, height, filterWidth, filterHeight, 1);
+    result.gb = isa::OpenCL::getConvolutionGB(conf, width, height, filterWidth, filterHeight, 1, sizeof(T));
+
+    // One warm-up run, excluded from the measurements
+    for ( unsigned int iteration = 0; iteration <= nrIterations; iteration++ ) {
+      isa::utils::Timer timer;
+
+      std::fill(output.begin(), output.end(), 0);
+      timer.start();
+      if ( backends[backend] == "sequential" ) {
+        isa::OpenCL::convolution< T >(padding, width, height, filterWidth, filterHeight, input, output, filter);
+      } else if ( backends[backend] == "parallel" ) {
+        isa::OpenCL::convolutionParallel< T >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+      } else if ( backends[backend] == "specialized" ) {
+        isa::OpenCL::convolutionSpecialized< T >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+      } else if ( backends[backend] == "simd" ) {
+        isa::OpenCL::convolutionSIMD< T >(padding, width, height, filterWidth, filterHeight, nrColumnsPerTile, nrRowsPerTile, input, output, filter);
+      } else {
+        try {
+          device->clQueues->at(device->clDeviceID)[0].enqueueNDRangeKernel(*kernel, cl::NullRange, global, local);
+          device->clQueues->at(device->clDeviceID)[0].finish();
+        } catch ( cl::Error & err ) {
+          delete kernel;
+          throw std::runtime_error("OpenCL error: " + isa::utils::toString(err.err()) + ".");
+        }
+      }
+      timer.stop();
+      if ( iteration > 0 ) {
+        result.times.push_back(timer.getTotalTime());
+      }
+    }
+    if ( backends[backend] == "opencl" ) {
+      device->clQueues->at(device->clDeviceID)[0].enqueueReadBuffer(output_d, CL_TRUE, 0, output.size() * sizeof(T), reinterpret_cast< void * >(output.data()));
+      delete kernel;
+    }
+    std::sort(result.times.begin(), result.times.end());
+
+    result.correct = true;
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        const T item = output[(y * isa::utils::pad(width, padding)) + x];
+        const T control = output_c[(y * isa::utils::pad(width, padding)) + x];
+
+        if ( std::numeric_limits< T >::is_integer ? item != control : !isa::utils::same(item, control) ) {
+          result.correct = false;
+        }
+      }
+    }
+    results.push_back(result);
+  }
+}
+
+void writeJSON(std::ostream & json, const std::vector< SuiteResult > & results, const unsigned int seed, const unsigned int nrIterations, const unsigned int padding, const std::string & deviceName) {
+  json << std::setprecision(9);
+  json << "{" << std::endl;
+  json << "  \"benchmark\": \"ConvolutionSuite\"," << std::endl;
+  json << "  \"seed\": " << seed << "," << std::endl;
+  json << "  \"iterations\": " << nrIterations << "," << std::endl;
+  json << "  \"padding\": " << padding << "," << std::endl;
+  json << "  \"threads\": " << omp_get_max_threads() << "," << std::endl;
+  json << "  \"isa\": \"" << isa::OpenCL::toString(isa::OpenCL::getConvolutionISA()) << "\"," << std::endl;
+  json << "  \"device\": \"" << deviceName << "\"," << std::endl;
+  json << "  \"results\": [";
+  for ( unsigned int item = 0; item < results.size(); item++ ) {
+    const SuiteResult & result = results[item];
+    double mean = 0.0;
+    double variance = 0.0;
+
+    for ( unsigned int time = 0; time < result.times.size(); time++ ) {
+      mean += result.times[time];
+    }
+    mean /= result.times.size();
+    for ( unsigned int time = 0; time < result.times.size(); time++ ) {
+      variance += (result.times[time] - mean) * (result.times[time] - mean);
+    }
+    variance /= result.times.size();
+    // The fastest runs can be below the resolution of the timer
+    const double median = std::max(getPercentile(result.times, 50), std::numeric_limits< double >::min());
+
+    if ( item > 0 ) {
+      json << ",";
+    }
+    json << std::endl;
+    json << "    {" << std::endl;
+    json << "      \"backend\": \"" << result.backend << "\"," << std::endl;
+    json << "      \"type\": \"" << result.type << "\"," << std::endl;
+    json << "      \"width\": " << result.width << "," << std::endl;
+    json << "      \"height\": " << result.height << "," << std::endl;
+    json << "      \"filterWidth\": " << result.filterWidth << "," << std::endl;
+    json << "      \"filterHeight\": " << result.filterHeight << "," << std::endl;
+    json << "      \"configuration\": \"" << result.configuration << "\"," << std::endl;
+    json << "      \"correct\": " << (result.correct ? "true" : "false") << "," << std::endl;
+    // Rates use the median, that is not moved by a few slow runs
+    json << "      \"GFLOP/s\": " << result.gflop / median << "," << std::endl;
+    json << "      \"GB/s\": " << result.gb / median << "," << std::endl;
+    json << "      \"time\": {\"mean\": " << mean << ", \"stdDeviation\": " << std::sqrt(variance) << ", \"min\": " << result.times.front() << ", \"p50\": " << getPercentile(result.times, 50) << ", \"p90\": " << getPercentile(result.times, 90) << ", \"p99\": " << getPercentile(result.times, 99) << ", \"max\": " << result.times.back() << "}" << std::endl;
+    json << "    }";
+  }
+  json << std::endl;
+  json << "  ]" << std::endl;
+  json << "}" << std::endl;
+}
+
@@ -0,0 +1,157 @@
+// Copyright 2014 Alessio Sclocco <a.sclocco@vu.nl>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <exception>
+#include <iomanip>
+#include <ctime>
+#include <future>
+#include <algorithm>
+
+#include <ArgumentList.hpp>
+#include <Convolution.hpp>
+#include <Convolver.hpp>
+#include <utils.hpp>
+#include <Timer.hpp>
+
+typedef float dataType;
+std::string typeName("float");
+
+
+int main(int argc, char * argv[]) {
+  bool localMem = false;
+  bool profile = false;
+  unsigned int padding = 0;
+	unsigned int clPlatformID = 0;
+	unsigned int clDeviceID = 0;
+  unsigned int nrInFlight = 0;
+  isa::OpenCL::ConvolutionConf conf;
+  long long unsigned int wrongItems = 0;
+  // I/O size
+  unsigned int width = 0;
+  unsigned int height = 0;
+  unsigned int filterWidth = 0;
+  unsigned int filterHeight = 0;
+  unsigned int nrFrames = 0;
+
+	try {
+    isa::utils::ArgumentList args(argc, argv);
+
+    localMem = args.getSwitch("-local");
+    profile = args.getSwitch("-profile");
+		clPlatformID = args.getSwitchArgument< unsigned int >("-opencl_platform");
+		clDeviceID = args.getSwitchArgument< unsigned int >("-opencl_device");
+    padding = args.getSwitchArgument< unsigned int >("-padding");
+    nrInFlight = args.getSwitchArgument< unsigned int >("-in_flight");
+    conf.setNrColumnsPerBlock(args.getSwitchArgument< unsigned int >("-cb"));
+    conf.setNrRowsPerBlock(args.getSwitchArgument< unsigned int >("-rb"));
+    conf.setNrColumnsPerThread(args.getSwitchArgument< unsigned int >("-ct"));
+    conf.setNrRowsPerThread(args.getSwitchArgument< unsigned int >("-rt"));
+    width = args.getSwitchArgument< unsigned int >("-width");
+    height = args.getSwitchArgument< unsigned int >("-height");
+    filterWidth = args.getSwitchArgument< unsigned int >("-filter_width");
+    filterHeight = args.getSwitchArgument< unsigned int >("-filter_height");
+    nrFrames = args.getSwitchArgument< unsigned int >("-frames");
+	} catch ( isa::utils::EmptyCommandLine & err ) {
+		std::cerr << argv[0] << " [-local] [-profile] -opencl_platform ... -opencl_device ... -padding ... -in_flight ... -cb ... -rb ... -ct ... -rt ... -width ... -height ... -filter_width ... -filter_height ... -frames ..." << std::endl;
+		return 1;
+	} catch ( std::exception & err ) {
+		std::cerr << err.what() << std::endl;
+		return 1;
+	}
+  conf.setLocalMemory(localMem);
+
+  // Allocate host memory, one input and output image for every frame in flight
+  const unsigned int inputImageStride = isa::OpenCL::getInputImageSize(padding, width, height, filterWidth, filterHeight);
+  const unsigned int outputImageStride = isa::OpenCL::getOutputImageSize(padding, width, height);
+  std::vector< std::vector< dataType > > inputs = std::vector< std::vector< dataType > >(nrInFlight, std::vector< dataType >(inputImageStride));
+  std::vector< std::vector< dataType > > outputs = std::vector< std::vector< dataType > >(nrInFlight, std::vector< dataType >(outputImageStride));
+  std::vector< std::future< void > > results = std::vector< std::future< void > >(nrInFlight);
+  std::vector< dataType > output_c = std::vector< dataType >(outputImageStride);
+  std::vector< dataType > filter = std::vector< dataType >(filterWidth * filterHeight);
+  std::srand(time(0));
+  for ( unsigned int i = 0; i < filter.size(); i++ ) {
+    filter[i] = std::rand() % 100;
+  }
+  for ( unsigned int frame = 0; frame < nrInFlight; frame++ ) {
+    for ( unsigned int i = 0; i < inputImageStride; i++ ) {
+      inputs[frame][i] = std::rand() % 1000;
+    }
+  }
+
+  isa::utils::Timer timer;
+  try {
+    isa::OpenCL::Convolver< dataType > convolver(clPlatformID, clDeviceID, conf, padding, width, height, filterWidth, filterHeight, filter, typeName, nrInFlight, profile);
+
+    timer.start();
+    for ( unsigned int frame = 0; frame < nrFrames; frame++ ) {
+      const unsigned int item = frame % nrInFlight;
+
+      // The host buffers of a frame are reused once its result is ready
+      if ( results[item].valid() ) {
+        results[item].get();
+      }
+      results[item] = convolver.submit(inputs[item], outputs[item]);
+    }
+    for ( unsigned int item = 0; item < nrInFlight; item++ ) {
+      if ( results[item].valid() ) {
+        results[item].get();
+      }
+    }
+    timer.stop();
+
+    std::cout << std::fixed << std::endl;
+    std::cout << "# width height filterWidth filterHeight frames inFlight frames/s submit(us) stdDeviation(us)" << std::endl << std::endl;
+    std::cout << width << " " << height << " " << filterWidth << " " << filterHeight << " " << nrFrames << " " << nrInFlight << " ";
+    std::cout << std::setprecision(3);
+    std::cout << nrFrames / timer.getTotalTime() << " ";
+    std::cout << convolver.getSubmitTimer().getAverageTime() * 1.0e6 << " " << convolver.getSubmitTimer().getStandardDeviation() * 1.0e6 << std::endl;
+    std::cout << std::endl;
+    if ( profile ) {
+      isa::OpenCL::ConvolutionProfiler profiler = convolver.getProfiler();
+
+      std::cout << "# phase commands queued(us) submit(us) execution(us)" << std::endl;
+      for ( unsigned int phase = isa::OpenCL::UPLOAD; phase <= isa::OpenCL::DOWNLOAD; phase++ ) {
+        std::cout << isa::OpenCL::toString(static_cast< isa::OpenCL::ConvolutionPhase >(phase)) << " " << profiler.getNrCommands(static_cast< isa::OpenCL::ConvolutionPhase >(phase)) << " ";
+        std::cout << profiler.getQueuedTime(static_cast< isa::OpenCL::ConvolutionPhase >(phase)) * 1.0e6 << " " << profiler.getSubmitTime(static_cast< isa::OpenCL::ConvolutionPhase >(phase)) * 1.0e6 << " " << profiler.getExecutionTime(static_cast< isa::OpenCL::ConvolutionPhase >(phase)) * 1.0e6 << std::endl;
+      }
+      std::cout << "# bound: " << profiler.getBound() << std::endl;
+      std::cout << std::endl;
+    }
+  } catch ( std::exception & err ) {
+    std::cerr << err.what() << std::endl;
+    return 1;
+  }
+
+  // Check the last output of every frame in flight
+  for ( unsigned int item = 0; item < std::min(nrInFlight, nrFrames); item++ ) {
+    isa::OpenCL::convolution< dataType >(padding, width, height, filterWidth, filterHeight, inputs[item], output_c, filter);
+    for ( unsigned int y = 0; y < height; y++ ) {
+      for ( unsigned int x = 0; x < width; x++ ) {
+        if ( !isa::utils::same(outputs[item][(y * isa::utils::pad(width, padding)) + x], output_c[(y * isa::utils::pad(width, padding)) + x]) ) {
+          wrongItems++;
+        }
+      }
+    }
+  }
+  if ( wrongItems > 0 ) {
+    std::cout << "Wrong items: " << wrongItems << " (" << (wrongItems * 100.0) / (static_cast< long long unsigned int >(width) * height * std::min(nrInFlight, nrFrames)) << "%)." << std::endl;
+    return 1;
+  }
+
+	return 0;
+}
+